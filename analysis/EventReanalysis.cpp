@@ -0,0 +1,290 @@
+// Daniel Michelin
+
+#include "EventReanalysis.hpp"
+#include "../generation/Particle.hpp"
+#include "../generation/PairKernel.hpp"
+#include <iostream>
+#include <thread>
+#include <cmath>
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+EventReanalysis::EventReanalysis(EventStoreReader const& store) :
+    f_Store(store),
+    f_NumEvents{0}
+    {}
+
+int EventReanalysis::AddSet(ReanalysisSet const& set)
+{
+    if((int)f_Sets.size() >= MaxReanalysisSets)
+    {
+        std::cout << "Cannot add set \"" << set.name << "\": at most " << MaxReanalysisSets << " sets can be filled at once\n";
+        return -1;
+    }
+    if(set.nbins <= 0 || !(set.xmin < set.xmax))
+    {
+        std::cout << "Cannot add set \"" << set.name << "\": the binning must have at least a bin and xmin < xmax\n";
+        return -1;
+    }
+    if(!(set.windowMin < set.windowMax))
+    {
+        std::cout << "Cannot add set \"" << set.name << "\": the mass window is empty\n";
+        return -1;
+    }
+
+    f_Sets.push_back(set);
+    f_Histograms.push_back(std::vector<FastHistogram>(NumInvMassFamilies, FastHistogram{set.nbins, set.xmin, set.xmax}));
+
+    return f_Sets.size() - 1;
+}
+
+bool EventReanalysis::Run(int threadsNum)
+{
+    if(!f_Store.isOpen())
+    {
+        std::cout << "No events to analyse: the event store isn't open\n";
+        return false;
+    }
+    if(f_Sets.empty())
+    {
+        std::cout << "No histograms to fill: add a set first\n";
+        return false;
+    }
+    if(!CheckParticleTable()) { return false; }
+
+    for(std::vector<FastHistogram>& set : f_Histograms)
+    {
+        for(FastHistogram& histo : set) { histo.Reset(); }
+    }
+
+    PairCategoryTable const pairCategories; //built once from the particle table; only read during the analysis
+    BlockSum<ChunkHistograms> chunkHistos{f_Store.getNumChunks(), ChunkHistograms{f_Histograms}};
+    std::atomic<int> nextChunk{0};
+
+    if(threadsNum <= 1)
+    {
+        AnalyseChunks(pairCategories, chunkHistos, nextChunk);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadsNum; ++t)
+        {
+            threads.emplace_back(&EventReanalysis::AnalyseChunks, this, std::cref(pairCategories), std::ref(chunkHistos), std::ref(nextChunk));
+        }
+        for(std::thread& thread : threads) { thread.join(); }
+    }
+
+    f_Histograms = chunkHistos.getSum().sets;
+    f_NumEvents = f_Store.getNumEvents();
+
+    return true;
+}
+
+int EventReanalysis::getNumSets() const { return f_Sets.size(); }
+ReanalysisSet const& EventReanalysis::getSet(int set) const { return f_Sets[set]; }
+
+std::vector<HistogramDefinition> EventReanalysis::getDefinitions(int set) const
+{
+    std::vector<HistogramDefinition> const generationDefinitions = GetHistogramDefinitions();
+    ReanalysisSet const& reanalysisSet = f_Sets[set];
+
+    // Same names and titles as the invariant mass histograms of the generation, with the name of the set
+    std::vector<HistogramDefinition> definitions;
+    for(int h = 0; h < NumInvMassFamilies; ++h)
+    {
+        HistogramDefinition const& family = generationDefinitions[Histo_InvariantMass + h];
+        definitions.push_back(HistogramDefinition{family.name + "_" + reanalysisSet.name, family.title + " (" + reanalysisSet.name + ")",
+                                                  reanalysisSet.nbins, reanalysisSet.xmin, reanalysisSet.xmax});
+    }
+
+    return definitions;
+}
+
+std::vector<FastHistogram> const& EventReanalysis::getHistograms(int set) const { return f_Histograms[set]; }
+std::uint64_t EventReanalysis::getNumEvents() const { return f_NumEvents; }
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+// The species IDs in the store are indexes in the particle table the events were generated with
+bool EventReanalysis::CheckParticleTable() const
+{
+    std::vector<StoredSpecies> const& species = f_Store.getSpecies();
+
+    bool isSame = (int)species.size() == Particle::getNumParticleType();
+    for(int i = 0; isSame && i < (int)species.size(); ++i)
+    {
+        isSame = species[i].name == Particle::getParticleType(i) && species[i].mass == Particle::getParticleTypeMass(i)
+                 && species[i].charge == Particle::getParticleTypeCharge(i) && species[i].width == Particle::getParticleTypeWidth(i);
+    }
+
+    if(!isSame)
+    {
+        std::cout << "The events were generated with a different particle table:\n";
+        for(StoredSpecies const& type : species)
+        {
+            std::cout << "  " << type.name << ": mass " << type.mass << ", charge " << type.charge << ", width " << type.width << '\n';
+        }
+    }
+
+    return isSame;
+}
+
+void EventReanalysis::ChunkHistograms::Add(ChunkHistograms const& other)
+{
+    for(unsigned s = 0; s < sets.size(); ++s)
+    {
+        for(unsigned h = 0; h < sets[s].size(); ++h) { sets[s][h].Add(other.sets[s][h]); }
+    }
+}
+
+// Takes the next chunk not yet analysed until there are none left, and fills histograms of its own with the pairs of
+// its events, handed over to 'chunkHistos'
+// Used by every analysis thread
+void EventReanalysis::AnalyseChunks(PairCategoryTable const& pairCategories, BlockSum<ChunkHistograms>& chunkHistos, std::atomic<int>& nextChunk) const
+{
+    int const setsNum = f_Sets.size();
+    int const numSpecies = pairCategories.getNumSpecies();
+
+    std::vector<double> typeMass(numSpecies);
+    std::vector<bool> isResonance(numSpecies);
+    for(int id = 0; id < numSpecies; ++id)
+    {
+        typeMass[id] = Particle::getParticleTypeMass(id);
+        isResonance[id] = Particle::getParticleTypeWidth(id) > 0.;
+    }
+
+    // Weights of an importance sampled generation (see EventStore.hpp); the fills of an unweighted one stay unweighted
+    bool const weighted = f_Store.isWeighted();
+    std::vector<double> speciesWeight(numSpecies, 1.);
+    for(int id = 0; id < numSpecies && id < (int)f_Store.getSpecies().size(); ++id) { speciesWeight[id] = f_Store.getSpecies()[id].weight; }
+
+    // Columns of the current event, in double precision, as the pair kernel wants them; they only grow
+    std::vector<double> px, py, pz, energy;
+    std::vector<int> speciesID;
+    std::vector<unsigned> passedCuts; //bit s: the particle passes the cuts of set s
+    std::vector<double> weight; //decay products weigh what their mother weighs
+
+    double invMasses[PairBlockSize];
+    int pairCodes[PairBlockSize];
+
+    for(int c = nextChunk++; c < f_Store.getNumChunks(); c = nextChunk++)
+    {
+        EventChunkView const chunk = f_Store.getChunk(c);
+        ChunkHistograms* const chunkSets = chunkHistos.Take();
+        std::vector<std::vector<FastHistogram>>& histos = chunkSets->sets;
+
+        for(int e = 0; e < chunk.eventsNum; ++e)
+        {
+            int const first = chunk.eventOffsets[e];
+            int const size = chunk.eventOffsets[e+1] - first;
+
+            if((int)px.size() < size)
+            {
+                px.resize(size);
+                py.resize(size);
+                pz.resize(size);
+                energy.resize(size);
+                speciesID.resize(size);
+                passedCuts.resize(size);
+                weight.resize(size);
+            }
+
+            std::int32_t const* mother = chunk.mother + first;
+
+            for(int i = 0; i < size; ++i)
+            {
+                px[i] = chunk.px[first + i];
+                py[i] = chunk.py[first + i];
+                pz[i] = chunk.pz[first + i];
+                speciesID[i] = chunk.speciesID[first + i];
+                weight[i] = speciesWeight[chunk.speciesID[first + ((mother[i] >= 0) ? mother[i] : i)]];
+
+                double const mass = typeMass[speciesID[i]];
+                double const P2 = px[i]*px[i] + py[i]*py[i] + pz[i]*pz[i];
+                energy[i] = sqrt(mass*mass + P2);
+
+                double const P = sqrt(P2);
+                double const PTransverse = sqrt(px[i]*px[i] + py[i]*py[i]);
+                double const pseudorapidity = 0.5 * log((P + pz[i]) / (P - pz[i])); //infinite along the beam axis
+
+                unsigned mask = 0;
+                for(int s = 0; s < setsNum; ++s)
+                {
+                    ParticleCuts const& cuts = f_Sets[s].cuts;
+                    bool const passes = P >= cuts.minImpulse && P < cuts.maxImpulse && PTransverse >= cuts.minTransverseImpulse
+                                        && PTransverse < cuts.maxTransverseImpulse && !(std::fabs(pseudorapidity) > cuts.maxAbsPseudorapidity);
+                    if(passes) { mask |= 1u << s; }
+                }
+                passedCuts[i] = mask;
+            }
+
+            FourMomentumColumns const columns{px.data(), py.data(), pz.data(), energy.data(), speciesID.data(), size};
+
+            // Pairs of particles, as in the generation: resonances don't enter (their pair category masks are 0)
+            for(int i = 0; i < size-1; ++i)
+            {
+                if(isResonance[speciesID[i]] || passedCuts[i] == 0) { continue; }
+
+                for(int blockStart = i+1; blockStart < size; blockStart += PairBlockSize)
+                {
+                    int const blockEnd = (blockStart + PairBlockSize < size) ? blockStart + PairBlockSize : size;
+                    InvMassBlock(columns, i, blockStart, blockEnd, numSpecies, invMasses, pairCodes);
+
+                    for(int k = 0; k < blockEnd - blockStart; ++k)
+                    {
+                        unsigned const categories = pairCategories.getMask(pairCodes[k]);
+                        unsigned const sets = passedCuts[i] & passedCuts[blockStart + k];
+                        if(categories == 0 || sets == 0) { continue; }
+
+                        double const mass = invMasses[k];
+                        int const j = blockStart + k;
+                        double const pairWeight = (mother[i] >= 0 && mother[i] == mother[j]) ? weight[i] : weight[i] * weight[j]; //one draw for a single decay
+                        for(int s = 0; s < setsNum; ++s)
+                        {
+                            if(!(sets & (1u << s)) || mass < f_Sets[s].windowMin || !(mass < f_Sets[s].windowMax)) { continue; }
+
+                            for(int h = 0; h < NumPairCategories; ++h)
+                            {
+                                if(!(categories & (1u << h))) { continue; }
+
+                                if(weighted) { histos[s][h].Fill(mass, pairWeight); }
+                                else { histos[s][h].Fill(mass); }
+                            }
+                        }
+                    }
+                }
+            }
+
+            // Products of the same decay, which the generation puts next to each other
+            for(int i = 0; i < size-1; ++i)
+            {
+                if(mother[i] < 0 || mother[i+1] != mother[i]) { continue; }
+
+                double const sumOfE = energy[i] + energy[i+1];
+                double const sumOfPx = px[i] + px[i+1];
+                double const sumOfPy = py[i] + py[i+1];
+                double const sumOfPz = pz[i] + pz[i+1];
+                double const mass = sqrt(sumOfE*sumOfE - (sumOfPx*sumOfPx + sumOfPy*sumOfPy + sumOfPz*sumOfPz));
+
+                unsigned const sets = passedCuts[i] & passedCuts[i+1];
+                for(int s = 0; s < setsNum; ++s)
+                {
+                    if((sets & (1u << s)) && mass >= f_Sets[s].windowMin && mass < f_Sets[s].windowMax)
+                    {
+                        if(weighted) { histos[s][Family_SameDecayProducts].Fill(mass, weight[i]); }
+                        else { histos[s][Family_SameDecayProducts].Fill(mass); }
+                    }
+                }
+
+                ++i; //the pair is done
+            }
+        }
+
+        chunkHistos.Add(c, chunkSets);
+    }
+}
@@ -0,0 +1,89 @@
+// Daniel Michelin
+
+#ifndef EVENTREANALYSIS_HPP
+#define EVENTREANALYSIS_HPP
+#include "../generation/EventStore.hpp"
+#include "../generation/FastHistogram.hpp"
+#include "../generation/GenerationHistograms.hpp"
+#include "../generation/PairCategoryTable.hpp"
+#include "../generation/BlockSum.hpp"
+#include <vector>
+#include <string>
+#include <limits>
+#include <atomic>
+
+//Invariant mass families rebuilt by the re-analysis: the first NumPairCategories follow the pair category bits
+//(family k is the histogram of bit k), the last one holds the pairs of products of the same decay
+int const NumInvMassFamilies = NumPairCategories + 1;
+int const Family_SameDecayProducts = NumPairCategories;
+
+int const MaxReanalysisSets = 32; //one bit per set in the per-particle masks
+
+//Kinematic cuts on the single particles: a pair is counted only if both of its particles pass them
+struct ParticleCuts
+{
+  double minImpulse = 0.;
+  double maxImpulse = std::numeric_limits<double>::infinity();
+  double minTransverseImpulse = 0.;
+  double maxTransverseImpulse = std::numeric_limits<double>::infinity();
+  double maxAbsPseudorapidity = std::numeric_limits<double>::infinity();
+};
+
+//One set of invariant mass histograms to rebuild, with its own binning, mass window and cuts
+struct ReanalysisSet
+{
+  std::string name; //appended to the names of its histograms, e.g. histo_InvMass_OppositeSign_PionKaon_<name>
+  int nbins = InvMassNbins;
+  double xmin = 0.;
+  double xmax = InvMassXmax;
+  double windowMin = 0.; //only the pairs with windowMin <= mass < windowMax are counted
+  double windowMax = std::numeric_limits<double>::infinity();
+  ParticleCuts cuts = {};
+};
+
+
+//Rebuilds the invariant mass histograms from the events of an event store, without generating them again.
+//Any number of sets (up to MaxReanalysisSets) is filled in the same pass over the data: the masses of each pair are
+//computed once, with the pair kernel of the generation, and then go into every set whose cuts and window they pass.
+//The chunks of the store are shared out between the threads as they become free; the histograms of every chunk are
+//filled apart and added along a fixed tree over the chunks (see BlockSum.hpp), so the result is the same to the last bit
+//with any number of threads.
+//The particle table must be the same one the events were generated with (it's checked against the one in the store).
+//The events of an importance sampled generation are filled with the weights of the store, as the generation fills them.
+class EventReanalysis
+{
+public:
+  EventReanalysis(EventStoreReader const& store);
+
+  int AddSet(ReanalysisSet const& set); //returns the index of the set, or -1 (printing why) if it can't be added
+  bool Run(int threadsNum = 1); //returns false, printing why, if the events can't be analysed
+
+  int getNumSets() const;
+  ReanalysisSet const& getSet(int set) const;
+  std::vector<HistogramDefinition> getDefinitions(int set) const; //names, titles and binnings of the histograms of a set
+  std::vector<FastHistogram> const& getHistograms(int set) const; //NumInvMassFamilies histograms, in family order
+  std::uint64_t getNumEvents() const; //events analysed by the last Run()
+
+
+protected:
+
+
+private:
+  EventStoreReader const& f_Store;
+  std::vector<ReanalysisSet> f_Sets;
+  std::vector<std::vector<FastHistogram>> f_Histograms;
+  std::uint64_t f_NumEvents;
+
+  //The histograms of every set, filled with the events of a chunk
+  struct ChunkHistograms
+  {
+    std::vector<std::vector<FastHistogram>> sets;
+
+    void Add(ChunkHistograms const& other);
+  };
+
+  bool CheckParticleTable() const;
+  void AnalyseChunks(PairCategoryTable const& pairCategories, BlockSum<ChunkHistograms>& chunkHistos, std::atomic<int>& nextChunk) const;
+};
+
+#endif
@@ -27,22 +27,112 @@
 // Getting the histograms
 /////////////////////////
 
-TFile* histoFile = new TFile{"./particles_output/particleHistograms.root", "READ"};
-
-TH1F* h_ParticleAbundancies = histoFile->Get<TH1F>("histo_ParticleAbundancies");
-TH1F* h_Theta = histoFile->Get<TH1F>("histo_Theta_Distribution");
-TH1F* h_Phi = histoFile->Get<TH1F>("histo_Phi_Distribution");
-TH1F* h_Impulse = histoFile->Get<TH1F>("histo_Impulse_Distribution");
-// TH1F* h_TransverseImpulse = histoFile->Get<TH1F>("histo_TransverseImpulse_Distribution"); //no analysis on transverse impulse
-// TH1F* h_Energy = histoFile->Get<TH1F>("histo_Energy_Distribution"); //no analysis on energy
-
-std::vector<TH1F*> h_InvMass{
-histoFile->Get<TH1F>("histo_InvMass_OppositeSign"),					// 0 -- histogram 1)
-histoFile->Get<TH1F>("histo_InvMass_SameSign"),						// 1 -- histogram 2)
-histoFile->Get<TH1F>("histo_InvMass_OppositeSign_PionKaon"),		// 2 -- histogram 3)
-histoFile->Get<TH1F>("histo_InvMass_SameSign_PionKaon"),			// 3 -- histogram 4)
-histoFile->Get<TH1F>("histo_InvMass_SameKProducts")					// 4 -- histogram 5)
+// The histograms are read when they're first needed, not when the macro is loaded, so that the analysis can start while
+// the generation is still going: with SetSnapshots() (or --snapshot of generate_particles) the file is replaced by a newer
+// snapshot every so often, and RefreshHistograms(), called by VerifyData() and AnalyseHistograms() too, catches up with it
+
+std::string histoFileName = "./particles_output/particleHistograms.root";
+Long_t histoFileId = -1; //of the file the histograms were last read from: a new snapshot is a new file (renamed over the old one)
+Long_t histoFileTime = -1;
+bool isUsingReanalysedHistograms = false; //set by UseReanalysedHistograms(): the invariant mass histograms aren't refreshed
+
+TH1F* h_ParticleAbundancies = nullptr;
+TH1F* h_Theta = nullptr;
+TH1F* h_Phi = nullptr;
+TH1F* h_Impulse = nullptr;
+// TH1F* h_TransverseImpulse = nullptr; //no analysis on transverse impulse
+// TH1F* h_Energy = nullptr; //no analysis on energy
+
+std::vector<std::string> const invMassNames{
+"histo_InvMass_OppositeSign",					// 0 -- histogram 1)
+"histo_InvMass_SameSign",						// 1 -- histogram 2)
+"histo_InvMass_OppositeSign_PionKaon",			// 2 -- histogram 3)
+"histo_InvMass_SameSign_PionKaon",				// 3 -- histogram 4)
+"histo_InvMass_SameKProducts"					// 4 -- histogram 5)
 };
+std::vector<TH1F*> h_InvMass(invMassNames.size(), nullptr); //same order as invMassNames
+
+bool SetGraphicsStatus = false;
+
+
+// Reads the histograms again if the file has changed since the last time (or always, with 'force'). The histograms
+// already read keep their objects, only their contents change, so that their graphics and the pads they're drawn in stay
+// Returns false, leaving the histograms as they are, if the file isn't there (yet) or doesn't have all of them
+bool RefreshHistograms(bool const force = false)
+{
+	Long_t id, flags, modificationTime;
+	Long64_t size;
+	if(gSystem->GetPathInfo(histoFileName.c_str(), &id, &size, &flags, &modificationTime) != 0)
+	{
+		std::cout << " " << histoFileName << " not found: has the generation written it (or its first snapshot) yet?\n";
+		return false;
+	}
+	if(!force && h_ParticleAbundancies != nullptr && id == histoFileId && modificationTime == histoFileTime) { return true; } //nothing new
+
+	TFile* file = new TFile{histoFileName.c_str(), "READ"};
+	if(file->IsZombie())
+	{
+		std::cout << " Cannot read " << histoFileName << '\n';
+		delete file;
+		return false;
+	}
+
+	std::vector<std::string> names{"histo_ParticleAbundancies", "histo_Theta_Distribution", "histo_Phi_Distribution", "histo_Impulse_Distribution"};
+	std::vector<TH1F**> targets{&h_ParticleAbundancies, &h_Theta, &h_Phi, &h_Impulse};
+	if(isUsingReanalysedHistograms == false)
+	{
+		for(UInt_t i = 0; i < invMassNames.size(); ++i)
+		{
+			names.push_back(invMassNames[i]);
+			targets.push_back(&h_InvMass[i]);
+		}
+	}
+
+	std::vector<TH1F*> read; //all of them first, so that a file without some of them changes nothing
+	for(UInt_t i = 0; i < names.size(); ++i)
+	{
+		TH1F* histo = file->Get<TH1F>(names[i].c_str());
+		if(histo == nullptr)
+		{
+			std::cout << " \"" << names[i] << "\" not found in " << histoFileName << '\n';
+			delete file;
+			return false;
+		}
+		read.push_back(histo);
+	}
+
+	for(UInt_t i = 0; i < read.size(); ++i)
+	{
+		TH1F*& histo = *targets[i];
+		if(histo != nullptr && histo->GetNbinsX() == read[i]->GetNbinsX())
+		{
+			histo->Reset();
+			histo->Add(read[i]);
+		}
+		else
+		{
+			histo = static_cast<TH1F*>(read[i]->Clone());
+			histo->SetDirectory(nullptr); //kept once the file is closed
+			SetGraphicsStatus = false; //the new histograms still need their graphics
+		}
+	}
+
+	delete file;
+	histoFileId = id;
+	histoFileTime = modificationTime;
+
+	std::cout << " Histograms read from " << histoFileName << ": " << (Long64_t)h_ParticleAbundancies->GetEntries() << " particles\n";
+	return true;
+}
+
+
+// Takes the histograms from 'fileName' from now on, e.g. the snapshots of a generation that is still going, which the
+// following RefreshHistograms() (also the one of VerifyData() and AnalyseHistograms()) keep up with
+bool AttachHistograms(std::string const& fileName = "./particles_output/particleHistograms.root")
+{
+	histoFileName = fileName;
+	return RefreshHistograms(true);
+}
 
 
 
@@ -50,8 +140,6 @@ histoFile->Get<TH1F>("histo_InvMass_SameKProducts")					// 4 -- histogram 5)
 // HISTOGRAMS GRAPHICS
 //////////////////////
 
-bool SetGraphicsStatus = false;
-
 void SetGraphics() //must be executed once at the start 
 {
 	gStyle->SetOptStat(11);
@@ -117,6 +205,34 @@ void SetGraphics() //must be executed once at the start
 ////////////
 
 
+// Replaces the invariant mass histograms with the ones of a set rebuilt by the re-analysis of stored events
+// (see analysis/main_EventReanalysis.cpp), so that AnalyseHistograms() works on them
+// Returns false, leaving the current histograms as they are, if the file doesn't have all the histograms of the set
+bool UseReanalysedHistograms(std::string const& setName, std::string const& fileName = "./particles_output/reanalysedHistograms.root")
+{
+	TFile* reanalysisFile = new TFile{fileName.c_str(), "READ"};
+
+	std::vector<TH1F*> histos;
+	for(UInt_t i = 0; i < invMassNames.size(); ++i)
+	{
+		TH1F* histo = reanalysisFile->Get<TH1F>((invMassNames[i] + "_" + setName).c_str());
+		if(histo == nullptr)
+		{
+			std::cout << " \"" << invMassNames[i] << "_" << setName << "\" not found in " << fileName << '\n';
+			return false;
+		}
+		histos.push_back(histo);
+	}
+
+	h_InvMass = histos;
+	isUsingReanalysedHistograms = true; //RefreshHistograms() leaves them alone from now on
+	SetGraphicsStatus = false; //the new histograms still need their graphics
+
+	std::cout << " Using the invariant mass histograms of set \"" << setName << "\".\n";
+	return true;
+}
+
+
 struct AxisEdges
 {
 	Double_t low;
@@ -149,6 +265,7 @@ bool OverlapCheck(Double_t const val1, Double_t const err1, Double_t const val2,
 
 void VerifyAbundancies()
 {	
+	if(h_ParticleAbundancies == nullptr && RefreshHistograms() == false) { return; } //called on its own, before anything was read
 	Double_t const barWidth = 0.8;
 	h_ParticleAbundancies->SetBarWidth(barWidth);
 	h_ParticleAbundancies->SetBarOffset((1 - barWidth)/2);
@@ -408,6 +525,7 @@ TF1* AnalyseHisto_SameKProducts(TH1* histo_sKp, bool const zoomAroundMax = false
 // Analyse & print the invariant mass histograms
 void AnalyseHistograms(bool const zoomAroundMax = false)
 {
+	if(RefreshHistograms() == false) { return; } //the latest snapshot, if the generation is still going
 	if(SetGraphicsStatus == false) { SetGraphics(); }
 
 	gSystem->cd("particles_output");
@@ -517,6 +635,7 @@ void AnalyseHistograms(bool const zoomAroundMax = false)
 // Checks data consistency for the other histograms
 void VerifyData()
 {
+	if(RefreshHistograms() == false) { return; } //the latest snapshot, if the generation is still going
 	if(SetGraphicsStatus == false) { SetGraphics(); }
 
 	gSystem->cd("particles_output");
@@ -0,0 +1,295 @@
+// Daniel Michelin
+
+// Re-analysis of stored events: rebuilds the invariant mass histograms with new binnings, mass windows and cuts,
+// reading an event store written by the generation (see generation/EventStore.hpp) instead of generating the events again
+// Build it with 'make' (add WITH_ROOT=1 to also be able to write ROOT files), run './build/reanalyse_events --help'
+
+#include "EventReanalysis.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/HistogramIO.hpp"
+#ifdef GASHEIEP_WITH_ROOT
+#include "../generation/RootOutput.hpp"
+#endif
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <cstdlib>
+
+
+//Everything that can be set from the command line or from a configuration file
+struct ReanalysisOptions
+{
+  std::string eventsFile = "./particles_output/particleEvents.evts";
+  int threadsNum = 1;
+  std::string outputFile; //empty = ./particles_output/reanalysedHistograms.<format extension>
+  std::string format;
+  std::vector<ReanalysisSet> sets;
+};
+
+
+void PrintUsage(char const* programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "Options:\n"
+              << "  --events-file FILE  event store to analyse (default: ./particles_output/particleEvents.evts)\n"
+              << "  --threads N         analysis threads (default: 1)\n"
+              << "  --output FILE       output file (default: ./particles_output/reanalysedHistograms.root or .hist)\n"
+              << "  --format FORMAT     'native' or, if built with ROOT, 'root' (default: root if available, else native)\n"
+              << "  --config FILE       reads the options from FILE, one 'name = value' per line; a line '[NAME]' starts a new set\n"
+              << "Sets of histograms (all of them are filled in the same pass over the events):\n"
+              << "  --set NAME          starts a new set; the following options apply to it (default set: 'reanalysis')\n"
+              << "  --bins N            number of bins (default: " << InvMassNbins << ")\n"
+              << "  --min X, --max X    range of the histograms, in GeV/c^2 (default: 0--" << InvMassXmax << ")\n"
+              << "  --window-min X, --window-max X      mass window: only the pairs inside it are counted (default: none)\n"
+              << "  --min-impulse X, --max-impulse X    cut on the impulse of both particles of a pair, in GeV/c\n"
+              << "  --min-transverse-impulse X, --max-transverse-impulse X    same, on the transverse impulse\n"
+              << "  --max-abs-pseudorapidity X          same, on |pseudorapidity|\n"
+              << "  --help              prints this message\n";
+}
+
+
+// Reads a number; returns false if 'value' isn't one
+bool ParseNumber(std::string const& value, double& result)
+{
+    char* end = nullptr;
+    result = std::strtod(value.c_str(), &end);
+    return !value.empty() && *end == '\0';
+}
+
+
+// Returns the set the set options apply to, making the default one if no set has been started yet
+ReanalysisSet& CurrentSet(ReanalysisOptions& options)
+{
+    if(options.sets.empty()) { options.sets.push_back(ReanalysisSet{"reanalysis"}); }
+    return options.sets.back();
+}
+
+
+// Sets the option 'name' (without the leading "--") to 'value'; returns false, printing why, if it can't
+bool SetOption(ReanalysisOptions& options, std::string const& name, std::string const& value)
+{
+    double number;
+
+    if(name == "events-file") { options.eventsFile = value; }
+    else if(name == "output") { options.outputFile = value; }
+    else if(name == "format")
+    {
+        if(value != "native" && value != "root")
+        {
+            std::cout << "<!> Unknown format \"" << value << "\": must be 'native' or 'root'\n";
+            return false;
+        }
+        options.format = value;
+    }
+    else if(name == "set")
+    {
+        if(value.empty())
+        {
+            std::cout << "<!> A set must have a name\n";
+            return false;
+        }
+        options.sets.push_back(ReanalysisSet{value});
+    }
+    else if(!ParseNumber(value, number))
+    {
+        std::cout << "<!> Incorrect value for " << name << ": must enter a number\n";
+        return false;
+    }
+    else if(name == "threads" || name == "bins")
+    {
+        if(!(number > 0) || number != (int)number)
+        {
+            std::cout << "<!> Incorrect value for " << name << ": must enter a positive integer\n";
+            return false;
+        }
+        if(name == "threads") { options.threadsNum = number; }
+        else { CurrentSet(options).nbins = number; }
+    }
+    else if(name == "min") { CurrentSet(options).xmin = number; }
+    else if(name == "max") { CurrentSet(options).xmax = number; }
+    else if(name == "window-min") { CurrentSet(options).windowMin = number; }
+    else if(name == "window-max") { CurrentSet(options).windowMax = number; }
+    else if(name == "min-impulse") { CurrentSet(options).cuts.minImpulse = number; }
+    else if(name == "max-impulse") { CurrentSet(options).cuts.maxImpulse = number; }
+    else if(name == "min-transverse-impulse") { CurrentSet(options).cuts.minTransverseImpulse = number; }
+    else if(name == "max-transverse-impulse") { CurrentSet(options).cuts.maxTransverseImpulse = number; }
+    else if(name == "max-abs-pseudorapidity") { CurrentSet(options).cuts.maxAbsPseudorapidity = number; }
+    else
+    {
+        std::cout << "<!> Unknown option \"" << name << "\"\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+// Reads the options from a file with lines such as "bins = 200"; '#' starts a comment and "[NAME]" starts a new set
+bool ReadConfigFile(ReanalysisOptions& options, std::string const& fileName)
+{
+    std::ifstream file{fileName};
+    if(!file)
+    {
+        std::cout << "Cannot open the configuration file \"" << fileName << "\"\n";
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::string name;
+        std::string value;
+        std::string::size_type const openBracket = line.find('[');
+        std::string::size_type const closeBracket = line.find(']');
+        if(openBracket != std::string::npos && closeBracket != std::string::npos && openBracket < closeBracket)
+        {
+            name = "set";
+            std::istringstream{line.substr(openBracket + 1, closeBracket - openBracket - 1)} >> value;
+        }
+        else
+        {
+            std::string::size_type const equalSign = line.find('=');
+            std::istringstream{line.substr(0, equalSign)} >> name;
+            if(name.empty()) { continue; } //blank line or comment
+            if(equalSign != std::string::npos) { std::istringstream{line.substr(equalSign + 1)} >> value; }
+        }
+
+        if(!SetOption(options, name, value))
+        {
+            std::cout << " in \"" << fileName << "\", line " << lineNumber << '\n';
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    ReanalysisOptions options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string const argument = argv[i];
+
+        if(argument == "--help" || argument == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(argument.compare(0, 2, "--") != 0 || i + 1 >= argc)
+        {
+            std::cout << "<!> Incorrect argument \"" << argument << "\"\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        std::string const name = argument.substr(2);
+        std::string const value = argv[++i];
+        bool const isValid = (name == "config") ? ReadConfigFile(options, value) : SetOption(options, name, value);
+        if(!isValid) { return 1; }
+    }
+
+    if(options.format.empty())
+    {
+#ifdef GASHEIEP_WITH_ROOT
+        options.format = "root";
+#else
+        options.format = "native";
+#endif
+    }
+#ifndef GASHEIEP_WITH_ROOT
+    if(options.format == "root")
+    {
+        std::cout << "<!> This program has been built without ROOT: only the 'native' format is available\n";
+        return 1;
+    }
+#endif
+
+    if(options.outputFile.empty())
+    {
+        options.outputFile = "./particles_output/reanalysedHistograms." + std::string{options.format == "root" ? "root" : "hist"};
+    }
+    CurrentSet(options); //the default set, if none was given
+
+    FillDefaultParticleTable();
+
+    std::unique_ptr<EventStoreReader const> store;
+    try { store = std::make_unique<EventStoreReader const>(options.eventsFile); }
+    catch(std::runtime_error const& error)
+    {
+        std::cout << "<!> " << error.what() << '\n';
+        return 1;
+    }
+    if(!store->isOpen()) { return 1; }
+
+    EventReanalysis reanalysis{*store};
+    for(ReanalysisSet const& set : options.sets)
+    {
+        if(reanalysis.AddSet(set) < 0) { return 1; }
+    }
+
+    std::cout << "\nEvents: " << store->getNumEvents() << " (seed " << store->getSeed() << "), sets: " << reanalysis.getNumSets() << ", threads: " << options.threadsNum;
+    std::cout << "\nAnalysing events";
+    std::cout.flush();
+
+    auto const start = std::chrono::steady_clock::now();
+    if(!reanalysis.Run(options.threadsNum)) { return 1; }
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "...DONE\n";
+    std::cout << "Analysis time: " << elapsed.count() << " s (" << reanalysis.getNumEvents() / elapsed.count() << " events/s)\n";
+
+    // Summary: entries of every histogram and, as a first look at the signal, the difference between
+    // the discordant and concordant charge Pion-Kaon pairs
+    std::vector<HistogramDefinition> definitions;
+    std::vector<FastHistogram> histos;
+    for(int s = 0; s < reanalysis.getNumSets(); ++s)
+    {
+        std::vector<HistogramDefinition> const setDefinitions = reanalysis.getDefinitions(s);
+        std::vector<FastHistogram> const& setHistos = reanalysis.getHistograms(s);
+
+        std::cout << "\n = Set " << reanalysis.getSet(s).name << " =\n";
+        for(int h = 0; h < NumInvMassFamilies; ++h)
+        {
+            std::cout << "> " << setDefinitions[h].name << ": " << (long long)setHistos[h].getEntries() << " entries\n";
+        }
+        std::cout << "> Pion-Kaon discordant - concordant charge: "
+                  << (long long)(setHistos[Histo_InvMass_OppositeSign_PionKaon - Histo_InvariantMass].getEntries()
+                     - setHistos[Histo_InvMass_SameSign_PionKaon - Histo_InvariantMass].getEntries()) << " pairs\n";
+
+        definitions.insert(definitions.end(), setDefinitions.begin(), setDefinitions.end());
+        histos.insert(histos.end(), setHistos.begin(), setHistos.end());
+    }
+    std::cout << '\n';
+
+    std::filesystem::path const outputPath{options.outputFile};
+    if(outputPath.has_parent_path())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(outputPath.parent_path(), error);
+    }
+
+    bool isWritten;
+#ifdef GASHEIEP_WITH_ROOT
+    if(options.format == "root") { isWritten = WriteHistogramsToRoot(options.outputFile, definitions, histos); }
+    else
+#endif
+    isWritten = WriteHistograms(options.outputFile, definitions, histos);
+
+    if(!isWritten) { return 1; }
+
+    std::cout << "Histograms written to \"" << options.outputFile << "\"\n";
+    return 0;
+}
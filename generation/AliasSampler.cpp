@@ -0,0 +1,139 @@
+// Daniel Michelin
+
+#include "AliasSampler.hpp"
+#include "Particle.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+
+
+AliasSampler::AliasSampler(std::vector<SpeciesAbundance> const& abundancies)
+{
+    // An all-zero table would divide by zero below, and a negative probability break the columns: either would give
+    // thresholds that silently draw the wrong species
+    std::string const error = CheckAbundancies(abundancies);
+    if(!error.empty()) { throw std::invalid_argument{"AliasSampler: " + error}; }
+
+    int const n = abundancies.size();
+
+    double total = 0.;
+    for(int i = 0; i < n; ++i) { total += abundancies[i].probability; }
+
+    f_Threshold.assign(n, 1.);
+    f_Alias.resize(n);
+
+    // Vose's construction: every column is filled up to 1 (in units of 1/n) by borrowing from a column that has too much
+    std::vector<double> scaled(n);
+    std::vector<int> small;
+    std::vector<int> large;
+    for(int i = 0; i < n; ++i)
+    {
+        f_SpeciesID.push_back(abundancies[i].speciesID);
+        f_Probability.push_back(abundancies[i].probability / total);
+        f_Alias[i] = i;
+
+        scaled[i] = f_Probability[i] * n;
+        if(scaled[i] < 1.) { small.push_back(i); }
+        else { large.push_back(i); }
+    }
+
+    while(!small.empty() && !large.empty())
+    {
+        int const s = small.back();
+        small.pop_back();
+        int const l = large.back();
+
+        f_Threshold[s] = scaled[s];
+        f_Alias[s] = l;
+
+        scaled[l] -= 1. - scaled[s];
+        if(scaled[l] < 1.)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // whatever is left is 1 up to rounding errors, so it keeps its threshold of 1
+}
+
+int AliasSampler::Sample(double u) const
+{
+    // the integer part picks the column, the fractional part decides between the column and its alias
+    int const n = f_Threshold.size();
+    double const x = u * n;
+    int const column = (x < n) ? (int)x : n - 1; //u = 1 must not read past the table
+
+    return (x - column < f_Threshold[column]) ? f_SpeciesID[column] : f_SpeciesID[f_Alias[column]];
+}
+
+int AliasSampler::Sample(RandomStream& rng) const { return Sample(rng.Rndm()); }
+
+int AliasSampler::getNumSpecies() const { return f_SpeciesID.size(); }
+int AliasSampler::getSpeciesID(int i) const { return f_SpeciesID[i]; }
+double AliasSampler::getProbability(int i) const { return f_Probability[i]; }
+
+std::string AliasSampler::CheckAbundancies(std::vector<SpeciesAbundance> const& abundancies)
+{
+    if(abundancies.empty()) { return "the table of abundancies is empty"; }
+
+    double total = 0.;
+    for(SpeciesAbundance const& abundance : abundancies)
+    {
+        if(!(abundance.probability >= 0.) || std::isinf(abundance.probability))
+        {
+            std::ostringstream error;
+            error << "the probability of \"" << Particle::getParticleType(abundance.speciesID) << "\" (species " << abundance.speciesID
+                  << ") is " << abundance.probability << ": probabilities must be finite and not negative";
+            return error.str();
+        }
+        total += abundance.probability;
+    }
+
+    if(!(total > 0.)) { return "all the probabilities are zero"; }
+    if(std::isinf(total)) { return "the sum of the probabilities is too large"; }
+
+    return "";
+}
+
+std::vector<SpeciesAbundance> AliasSampler::ReadAbundancies(std::string const& fileName)
+{
+    std::vector<SpeciesAbundance> abundancies;
+
+    std::ifstream file{fileName};
+    if(!file)
+    {
+        std::cout << "Cannot read abundancies: file \"" << fileName << "\" not found\n";
+        return abundancies;
+    }
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        line = line.substr(0, line.find('#')); //removing comments
+
+        std::istringstream fields{line};
+        std::string name;
+        double probability;
+        if(!(fields >> name >> probability)) { continue; } //empty line
+
+        int const index = Particle::FindParticle_public(name);
+        if(index < 0)
+        {
+            std::cout << "Abundancies: particle \"" << name << "\" is not present in the table, skipping it\n";
+            continue;
+        }
+
+        abundancies.push_back(SpeciesAbundance{index, probability});
+    }
+
+    std::string const error = CheckAbundancies(abundancies);
+    if(!error.empty())
+    {
+        std::cout << "Abundancies in \"" << fileName << "\" rejected: " << error << '\n';
+        abundancies.clear();
+    }
+
+    return abundancies;
+}
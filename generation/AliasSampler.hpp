@@ -0,0 +1,49 @@
+// Daniel Michelin
+
+#ifndef ALIASSAMPLER_HPP
+#define ALIASSAMPLER_HPP
+#include "RandomStream.hpp"
+#include <vector>
+#include <string>
+
+struct SpeciesAbundance
+{
+  int speciesID; //index in the particle table
+  double probability; //doesn't need to be normalised
+};
+
+//Draws particle types according to a table of abundances, through Walker's alias method:
+//each draw costs one uniform random number, one table look-up and no allocation, however many types there are.
+class AliasSampler
+{
+public:
+  //Parametric constructor; throws std::invalid_argument, with the reason of CheckAbundancies(), if the table can't be sampled
+  AliasSampler(std::vector<SpeciesAbundance> const& abundancies);
+
+  int Sample(double u) const; //u uniform in [0,1); returns a species ID
+  int Sample(RandomStream& rng) const;
+
+  int getNumSpecies() const;
+  int getSpeciesID(int i) const;
+  double getProbability(int i) const; //normalised probability of the i-th entry of the table
+
+  //Why 'abundancies' can't be sampled: empty, a probability negative or not finite, or all of them zero; empty if it can
+  static std::string CheckAbundancies(std::vector<SpeciesAbundance> const& abundancies);
+
+  //Reads a table of abundances from a text file: one "<particle name> <probability>" per line, '#' starts a comment.
+  //Unknown particle names are reported and skipped. A table that can't be sampled (see CheckAbundancies()) is reported
+  //and rejected: the returned table is then empty.
+  static std::vector<SpeciesAbundance> ReadAbundancies(std::string const& fileName);
+
+
+protected:
+
+
+private:
+  std::vector<int> f_SpeciesID;
+  std::vector<double> f_Probability;
+  std::vector<double> f_Threshold; //probability of keeping column k instead of jumping to its alias
+  std::vector<int> f_Alias;
+};
+
+#endif
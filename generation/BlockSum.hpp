@@ -0,0 +1,111 @@
+// Daniel Michelin
+
+#ifndef BLOCKSUM_HPP
+#define BLOCKSUM_HPP
+#include <vector>
+#include <memory>
+#include <mutex>
+
+//Sum of partial results, one per block of a fixed partition of some work (the events of a batch cut into blocks of a
+//fixed number of events, the chunks of an event store), that doesn't depend on which thread computed which block nor in
+//which order: the partials are added along a fixed binary tree over the block indexes (block 2k plus block 2k+1, then
+//node 2k plus node 2k+1 of the level above, and so on, a node without a right sibling going up as it is), so every floating
+//point addition has the same operands in every run, and the sum is the same to the last bit with any number of threads.
+//A thread takes an empty partial with Take(), fills it with the work of one block, then hands it over with Add(); the
+//nodes whose two halves are done are added at once, and the partials they free are given out again by Take(), so only
+//a few partials per thread are alive at a time. The ones a single thread needs are allocated by the constructor; more
+//threads may need a few more, allocated once and then given out again too.
+//Partial must be copy-assignable and have Add(Partial const&).
+template<typename Partial>
+class BlockSum
+{
+public:
+  BlockSum(int blocksNum, Partial const& empty) : f_Empty(empty), f_Levels{0}, f_Done(1)
+  {
+    while((1 << f_Levels) < blocksNum) { ++f_Levels; }
+
+    f_Done.resize(f_Levels + 1);
+    for(int level = 0; level <= f_Levels; ++level) { f_Done[level].assign(NodesNum(blocksNum, level), nullptr); }
+
+    //A single thread going through the blocks in order has at most one node waiting per level, plus the block it fills
+    f_Storage.reserve(2 * (f_Levels + 1));
+    f_Spare.reserve(2 * (f_Levels + 1));
+    for(int i = 0; i <= f_Levels; ++i)
+    {
+      f_Storage.push_back(std::make_unique<Partial>(f_Empty));
+      f_Spare.push_back(f_Storage.back().get());
+    }
+  }
+
+  BlockSum(BlockSum const&) = delete;
+  BlockSum& operator=(BlockSum const&) = delete;
+
+  //An empty partial, as the one passed to the constructor
+  Partial* Take()
+  {
+    Partial* partial;
+    {
+      std::lock_guard<std::mutex> lock{f_Mutex};
+      if(f_Spare.empty())
+      {
+        f_Storage.push_back(std::make_unique<Partial>(f_Empty));
+        return f_Storage.back().get();
+      }
+      partial = f_Spare.back();
+      f_Spare.pop_back();
+    }
+    *partial = f_Empty; //same capacity, so no allocation
+    return partial;
+  }
+
+  //Hands over the partial of block 'block', taken with Take(); thread-safe. The additions are made out of the lock
+  void Add(int block, Partial* partial)
+  {
+    std::unique_lock<std::mutex> lock{f_Mutex};
+    int index = block;
+    for(int level = 0; level < f_Levels; ++level, index /= 2)
+    {
+      int const sibling = index ^ 1;
+      if(sibling >= (int)f_Done[level].size()) { continue; } //last node of the level, without a right sibling
+
+      Partial* const other = f_Done[level][sibling];
+      if(other == nullptr) //the other half isn't done yet: whoever finishes it goes on from here
+      {
+        f_Done[level][index] = partial;
+        return;
+      }
+      f_Done[level][sibling] = nullptr;
+
+      lock.unlock();
+      Partial* const left = (index & 1) ? other : partial;
+      Partial* const right = (index & 1) ? partial : other;
+      left->Add(*right);
+      lock.lock();
+
+      f_Spare.push_back(right);
+      partial = left;
+    }
+    f_Done[f_Levels][0] = partial;
+  }
+
+  Partial const& getEmpty() const { return f_Empty; }
+
+  //Once every block has been added: the sum of all of them (the empty partial if there are no blocks)
+  Partial const& getSum() const { return (f_Done[f_Levels].empty() || f_Done[f_Levels][0] == nullptr) ? f_Empty : *f_Done[f_Levels][0]; }
+
+
+protected:
+
+
+private:
+  Partial const f_Empty;
+  int f_Levels; //the root is at level f_Levels, the blocks at level 0
+  std::vector<std::vector<Partial*>> f_Done; //nodes done, waiting for their sibling, by level and index
+  std::vector<std::unique_ptr<Partial>> f_Storage;
+  std::vector<Partial*> f_Spare;
+  std::mutex f_Mutex;
+
+  static int NodesNum(int blocksNum, int level) { return (blocksNum + (1 << level) - 1) >> level; }
+};
+
+#endif
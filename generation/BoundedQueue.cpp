@@ -0,0 +1,194 @@
+// Daniel Michelin
+
+#include "BoundedQueue.hpp"
+#include <chrono>
+#include <thread>
+#include <iomanip>
+#include <sstream>
+
+
+void AddQueueStats(QueueStats& stats, QueueStats const& other)
+{
+    if(stats.name.empty()) { stats.name = other.name; }
+    if(other.capacity > stats.capacity) { stats.capacity = other.capacity; }
+    stats.pushesNum += other.pushesNum;
+    stats.depthSum += other.depthSum;
+    if(other.maxDepth > stats.maxDepth) { stats.maxDepth = other.maxDepth; }
+    stats.fullStallsNum += other.fullStallsNum;
+    stats.fullStallSeconds += other.fullStallSeconds;
+    stats.emptyStallsNum += other.emptyStallsNum;
+    stats.emptyStallSeconds += other.emptyStallSeconds;
+}
+
+void PrintQueueStats(std::ostream& output, std::vector<QueueStats> const& stats)
+{
+    std::ios_base::fmtflags const flags = output.flags();
+    std::streamsize const precision = output.precision();
+
+    output << "\n = Pipeline queues =\n"
+           << std::left << std::setw(22) << "queue" << std::right << std::setw(12) << "mean depth" << std::setw(12) << "max depth"
+           << std::setw(22) << "full (producer waits)" << std::setw(23) << "empty (consumer waits)" << '\n';
+
+    for(QueueStats const& queue : stats)
+    {
+        double const meanDepth = (queue.pushesNum > 0) ? queue.depthSum / queue.pushesNum : 0.;
+
+        std::ostringstream maxDepth, full, empty;
+        maxDepth << queue.maxDepth << '/' << queue.capacity;
+        full << queue.fullStallsNum << " (" << std::fixed << std::setprecision(3) << queue.fullStallSeconds << " s)";
+        empty << queue.emptyStallsNum << " (" << std::fixed << std::setprecision(3) << queue.emptyStallSeconds << " s)";
+
+        output << std::left << std::setw(22) << queue.name << std::right << std::fixed << std::setprecision(1) << std::setw(12) << meanDepth
+               << std::setw(12) << maxDepth.str() << std::setw(22) << full.str() << std::setw(23) << empty.str() << '\n';
+    }
+    output.flags(flags);
+    output.precision(precision);
+}
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+// Smallest power of 2 that is at least 'capacity' (and at least 2)
+static std::size_t RoundCapacity(int capacity)
+{
+    std::size_t rounded = 2;
+    while(rounded < (std::size_t)capacity) { rounded *= 2; }
+    return rounded;
+}
+
+BoundedQueue::BoundedQueue(std::string const& name, int capacity) :
+    f_Name{name},
+    f_Mask{RoundCapacity(capacity) - 1},
+    f_Cells{new Cell[f_Mask + 1]},
+    f_PushPosition{0},
+    f_PopPosition{0},
+    f_PushesNum{0},
+    f_DepthSum{0},
+    f_MaxDepth{0},
+    f_FullStallsNum{0},
+    f_FullStallNanoseconds{0},
+    f_EmptyStallsNum{0},
+    f_EmptyStallNanoseconds{0}
+{
+    for(std::size_t i = 0; i <= f_Mask; ++i) { f_Cells[i].sequence.store(i, std::memory_order_relaxed); } //cell i is free for push i
+}
+
+bool BoundedQueue::TryPush(int value)
+{
+    std::size_t position = f_PushPosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    for(;;)
+    {
+        cell = &f_Cells[position & f_Mask];
+        std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t const difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)position;
+
+        if(difference == 0) //the cell is free for this turn: take the position, unless another producer took it first
+        {
+            if(f_PushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { break; }
+        }
+        else if(difference < 0) { return false; } //the cell still holds the value of the previous turn: full
+        else { position = f_PushPosition.load(std::memory_order_relaxed); } //another producer got there first
+    }
+
+    cell->value = value;
+    cell->sequence.store(position + 1, std::memory_order_release); //ready for the pop of this turn
+    CountPush();
+    return true;
+}
+
+bool BoundedQueue::TryPop(int& value)
+{
+    std::size_t position = f_PopPosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    for(;;)
+    {
+        cell = &f_Cells[position & f_Mask];
+        std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t const difference = (std::ptrdiff_t)sequence - (std::ptrdiff_t)(position + 1);
+
+        if(difference == 0) //the cell holds the value of this turn
+        {
+            if(f_PopPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { break; }
+        }
+        else if(difference < 0) { return false; } //nothing pushed there yet: empty
+        else { position = f_PopPosition.load(std::memory_order_relaxed); }
+    }
+
+    value = cell->value;
+    cell->sequence.store(position + f_Mask + 1, std::memory_order_release); //free for the push of the next turn
+    return true;
+}
+
+void BoundedQueue::Push(int value)
+{
+    if(TryPush(value)) { return; }
+
+    auto const start = std::chrono::steady_clock::now();
+    for(int attempt = 0; !TryPush(value); ++attempt) { Wait(attempt); }
+    std::chrono::nanoseconds const waited = std::chrono::steady_clock::now() - start;
+
+    f_FullStallsNum.fetch_add(1, std::memory_order_relaxed);
+    f_FullStallNanoseconds.fetch_add(waited.count(), std::memory_order_relaxed);
+}
+
+int BoundedQueue::Pop()
+{
+    int value;
+    if(TryPop(value)) { return value; }
+
+    auto const start = std::chrono::steady_clock::now();
+    for(int attempt = 0; !TryPop(value); ++attempt) { Wait(attempt); }
+    std::chrono::nanoseconds const waited = std::chrono::steady_clock::now() - start;
+
+    f_EmptyStallsNum.fetch_add(1, std::memory_order_relaxed);
+    f_EmptyStallNanoseconds.fetch_add(waited.count(), std::memory_order_relaxed);
+    return value;
+}
+
+int BoundedQueue::getCapacity() const { return f_Mask + 1; }
+
+int BoundedQueue::getSize() const
+{
+    std::size_t const pushed = f_PushPosition.load(std::memory_order_relaxed);
+    std::size_t const popped = f_PopPosition.load(std::memory_order_relaxed);
+    return (pushed > popped) ? pushed - popped : 0;
+}
+
+QueueStats BoundedQueue::getStats() const
+{
+    QueueStats stats;
+    stats.name = f_Name;
+    stats.capacity = getCapacity();
+    stats.pushesNum = f_PushesNum.load(std::memory_order_relaxed);
+    stats.depthSum = f_DepthSum.load(std::memory_order_relaxed);
+    stats.maxDepth = f_MaxDepth.load(std::memory_order_relaxed);
+    stats.fullStallsNum = f_FullStallsNum.load(std::memory_order_relaxed);
+    stats.fullStallSeconds = 1e-9 * f_FullStallNanoseconds.load(std::memory_order_relaxed);
+    stats.emptyStallsNum = f_EmptyStallsNum.load(std::memory_order_relaxed);
+    stats.emptyStallSeconds = 1e-9 * f_EmptyStallNanoseconds.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+void BoundedQueue::CountPush()
+{
+    int const depth = getSize();
+    f_PushesNum.fetch_add(1, std::memory_order_relaxed);
+    f_DepthSum.fetch_add(depth, std::memory_order_relaxed);
+
+    int maxDepth = f_MaxDepth.load(std::memory_order_relaxed);
+    while(depth > maxDepth && !f_MaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) {}
+}
+
+// Spinning would take the CPU from the very thread being waited for when there are more threads than cores:
+// the first attempts only yield, then the waiting thread sleeps a little
+void BoundedQueue::Wait(int attempt)
+{
+    if(attempt < 64) { std::this_thread::yield(); }
+    else { std::this_thread::sleep_for(std::chrono::microseconds(50)); }
+}
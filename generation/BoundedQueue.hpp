@@ -0,0 +1,86 @@
+// Daniel Michelin
+
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//What a queue between two stages of a pipelined generation went through (see EventGenerator.hpp):
+//how full it was whenever something was pushed, and how often and for how long the stages on either side had to wait
+struct QueueStats
+{
+  std::string name;
+  int capacity = 0;
+  long long pushesNum = 0;
+  double depthSum = 0.; //sum of the depths right after every push: depthSum/pushesNum is the mean depth
+  int maxDepth = 0;
+  long long fullStallsNum = 0; //pushes that found the queue full, and how long they waited: the stage downstream is too slow
+  double fullStallSeconds = 0.;
+  long long emptyStallsNum = 0; //pops that found the queue empty, and how long they waited: the stage upstream is too slow
+  double emptyStallSeconds = 0.;
+};
+
+//Adds the counts of 'other', e.g. of another batch of events, to 'stats'
+void AddQueueStats(QueueStats& stats, QueueStats const& other);
+
+//One line per queue: mean and maximum depth against the capacity, stalls of the producers and of the consumers
+void PrintQueueStats(std::ostream& output, std::vector<QueueStats> const& stats);
+
+
+//Bounded lock-free queue of ints (e.g. indexes of preallocated events), for any number of producer and consumer threads.
+//It's a ring of cells, each with a sequence number telling whether it's free for the push of a given turn round the ring
+//or holds the value for the pop of that turn: a push or a pop only takes its position with a compare-and-swap, then
+//works on its cell alone, so the threads never wait for each other unless the queue is full or empty.
+//Push() and Pop() wait in those cases, yielding the CPU and then sleeping briefly, and keep count of the waits.
+class BoundedQueue
+{
+public:
+  BoundedQueue(std::string const& name, int capacity); //the capacity is rounded up to a power of 2
+
+  BoundedQueue(BoundedQueue const&) = delete;
+  BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+  bool TryPush(int value); //false if the queue is full
+  bool TryPop(int& value); //false if the queue is empty
+  void Push(int value); //waits while the queue is full
+  int Pop(); //waits while the queue is empty
+
+  int getCapacity() const;
+  int getSize() const; //only a snapshot while other threads are using the queue
+  QueueStats getStats() const;
+
+
+protected:
+
+
+private:
+  struct Cell
+  {
+    std::atomic<std::size_t> sequence;
+    int value;
+  };
+
+  std::string const f_Name;
+  std::size_t const f_Mask; //capacity - 1
+  std::unique_ptr<Cell[]> f_Cells;
+
+  alignas(64) std::atomic<std::size_t> f_PushPosition; //each on its own cache line, as producers and consumers update them
+  alignas(64) std::atomic<std::size_t> f_PopPosition;
+
+  alignas(64) std::atomic<long long> f_PushesNum;
+  std::atomic<long long> f_DepthSum;
+  std::atomic<int> f_MaxDepth;
+  std::atomic<long long> f_FullStallsNum;
+  std::atomic<long long> f_FullStallNanoseconds;
+  std::atomic<long long> f_EmptyStallsNum;
+  std::atomic<long long> f_EmptyStallNanoseconds;
+
+  void CountPush();
+  static void Wait(int attempt); //between two attempts of a stalled Push() or Pop()
+};
+
+#endif
@@ -0,0 +1,198 @@
+// Daniel Michelin
+
+#include "DecayBatch.hpp"
+#include <iostream>
+#include <cmath> //also for M_PI
+
+
+DecayBatch::DecayBatch(DecayChannel const& channel, EventArena* arena) :
+    f_Channel(channel),
+    f_Arena{arena},
+    f_MotherMass{Particle::getParticleTypeMass(channel.motherID)},
+    f_MotherWidth{Particle::getParticleTypeWidth(channel.motherID)},
+    f_Daughter1Mass{Particle::getParticleTypeMass(channel.daughter1ID[0]), Particle::getParticleTypeMass(channel.daughter1ID[1])},
+    f_Daughter2Mass{Particle::getParticleTypeMass(channel.daughter2ID[0]), Particle::getParticleTypeMass(channel.daughter2ID[1])},
+    f_MotherIndex(ArenaAllocator<int>{arena}),
+    f_Px(ArenaAllocator<double>{arena}), f_Py(ArenaAllocator<double>{arena}), f_Pz(ArenaAllocator<double>{arena}),
+    f_U1(ArenaAllocator<double>{arena}), f_U2(ArenaAllocator<double>{arena}), f_UPhi(ArenaAllocator<double>{arena}), f_UTheta(ArenaAllocator<double>{arena}),
+    f_Option(ArenaAllocator<int>{arena}),
+    f_Mass(ArenaAllocator<double>{arena}), f_MassDau1(ArenaAllocator<double>{arena}), f_MassDau2(ArenaAllocator<double>{arena}),
+    f_Pout(ArenaAllocator<double>{arena}),
+    f_Dx(ArenaAllocator<double>{arena}), f_Dy(ArenaAllocator<double>{arena}), f_Dz(ArenaAllocator<double>{arena}),
+    f_D1x(ArenaAllocator<double>{arena}), f_D1y(ArenaAllocator<double>{arena}), f_D1z(ArenaAllocator<double>{arena}), f_D1E(ArenaAllocator<double>{arena}),
+    f_D2x(ArenaAllocator<double>{arena}), f_D2y(ArenaAllocator<double>{arena}), f_D2z(ArenaAllocator<double>{arena}), f_D2E(ArenaAllocator<double>{arena})
+    {}
+
+int DecayBatch::Decay(EventBuffer& particles, int size, RandomStream& rng)
+{
+    if(f_MotherMass == 0.0)
+    {
+        std::cout << "\nDecayment cannot be performed if mass is zero\n";
+        return 0;
+    }
+
+    // Gathering the mothers
+    int const* speciesID = particles.getSpeciesID();
+    int n = 0;
+    for(int i = 0; i < size; ++i)
+    {
+        if(speciesID[i] == f_Channel.motherID) { ++n; }
+    }
+    if(n == 0) { return 0; }
+
+    Resize(n);
+
+    int m = 0;
+    for(int i = 0; i < size; ++i)
+    {
+        if(speciesID[i] == f_Channel.motherID)
+        {
+            f_MotherIndex[m] = i;
+            f_Px[m] = particles.getPx()[i];
+            f_Py[m] = particles.getPy()[i];
+            f_Pz[m] = particles.getPz()[i];
+            ++m;
+        }
+    }
+
+    // Random numbers, drawn in a fixed order so that the event stays reproducible
+    for(int k = 0; k < n; ++k)
+    {
+        f_Option[k] = rng.Rndm() < 0.50 ? 0 : 1;
+        f_U1[k] = rng.Rndm();
+        f_U2[k] = rng.Rndm();
+        f_UPhi[k] = rng.Rndm();
+        f_UTheta[k] = rng.Rndm();
+    }
+
+    // Masses of the daughters of every mother, so that the loops below read columns instead of looking them up by option
+    double const dau1Mass0 = f_Daughter1Mass[0], dau1Mass1 = f_Daughter1Mass[1];
+    double const dau2Mass0 = f_Daughter2Mass[0], dau2Mass1 = f_Daughter2Mass[1];
+#pragma GCC ivdep
+    for(int k = 0; k < n; ++k)
+    {
+        f_MassDau1[k] = (f_Option[k] == 0) ? dau1Mass0 : dau1Mass1;
+        f_MassDau2[k] = (f_Option[k] == 0) ? dau2Mass0 : dau2Mass1;
+    }
+
+    // Width effect: gaussian smearing of the mass (Box-Muller, which unlike the polar method has no rejection loop).
+    // log() and cos() stay calls to the C library, one mother at a time, so the masses are those of Decay2Body to the last bit
+    for(int k = 0; k < n; ++k)
+    {
+        f_Mass[k] = f_MotherMass + f_MotherWidth * sqrt(-2.0 * log(f_U1[k])) * cos(2 * M_PI * f_U2[k]);
+    }
+
+    // The next loops are branch-free over the columns, which never overlap (ivdep), so that the compiler vectorises them;
+    // with -fno-math-errno (see the Makefile) sqrt() is a single instruction, which gives the same bits as the library call
+
+    // Impulse of the daughters in the mother's frame; 0 when the smeared mass is below the threshold
+#pragma GCC ivdep
+    for(int k = 0; k < n; ++k)
+    {
+        double const massDau1 = f_MassDau1[k];
+        double const massDau2 = f_MassDau2[k];
+        double const massMot = f_Mass[k];
+
+        double const sum2 = (massDau1 + massDau2) * (massDau1 + massDau2);
+        double const diff2 = (massDau1 - massDau2) * (massDau1 - massDau2);
+        double const product = (massMot*massMot - sum2) * (massMot*massMot - diff2);
+
+        bool const allowed = massMot >= massDau1 + massDau2;
+        double const pout = sqrt(product) / massMot*0.5; //NaN when not allowed, and then not kept
+        f_Pout[k] = allowed ? pout : 0.;
+    }
+
+    // Directions, with the same angles as Decay2Body; sin() and cos() are library calls, as for the masses
+    for(int k = 0; k < n; ++k)
+    {
+        double const phi = f_UPhi[k] * 2 * M_PI;
+        double const theta = f_UTheta[k] * M_PI - M_PI/2.;
+        double const sinTheta = sin(theta);
+
+        f_Dx[k] = sinTheta * cos(phi);
+        f_Dy[k] = sinTheta * sin(phi);
+        f_Dz[k] = cos(theta);
+    }
+
+    // Boost of both daughters into the laboratory frame (same formula as Particle::Boost)
+#pragma GCC ivdep
+    for(int k = 0; k < n; ++k)
+    {
+        double const massDau1 = f_MassDau1[k];
+        double const massDau2 = f_MassDau2[k];
+        double const pout = f_Pout[k];
+
+        double const px1 = pout * f_Dx[k];
+        double const py1 = pout * f_Dy[k];
+        double const pz1 = pout * f_Dz[k];
+        double const energy1 = sqrt(massDau1*massDau1 + pout*pout);
+        double const energy2 = sqrt(massDau2*massDau2 + pout*pout);
+
+        double const energyMot = sqrt(f_Px[k]*f_Px[k] + f_Py[k]*f_Py[k] + f_Pz[k]*f_Pz[k] + f_Mass[k]*f_Mass[k]);
+        double const bx = f_Px[k] / energyMot;
+        double const by = f_Py[k] / energyMot;
+        double const bz = f_Pz[k] / energyMot;
+
+        double const b2 = bx*bx + by*by + bz*bz;
+        double const gamma = 1.0 / sqrt(1.0 - b2);
+        double const gamma2 = b2 > 0 ? (gamma - 1.0)/b2 : 0.0;
+
+        // daughter 1 has impulse +p, daughter 2 has -p
+        double const bp1 = bx*px1 + by*py1 + bz*pz1;
+        double const bp2 = -bp1;
+
+        f_D1x[k] = px1 + gamma2*bp1*bx + gamma*bx*energy1;
+        f_D1y[k] = py1 + gamma2*bp1*by + gamma*by*energy1;
+        f_D1z[k] = pz1 + gamma2*bp1*bz + gamma*bz*energy1;
+        f_D1E[k] = gamma*(energy1 + bp1);
+
+        f_D2x[k] = -px1 + gamma2*bp2*bx + gamma*bx*energy2;
+        f_D2y[k] = -py1 + gamma2*bp2*by + gamma*by*energy2;
+        f_D2z[k] = -pz1 + gamma2*bp2*bz + gamma*bz*energy2;
+        f_D2E[k] = gamma*(energy2 + bp2);
+    }
+
+    // Writing the daughters into the event; those of a failed decay keep a zero impulse, as with Decay2Body
+    int failures = 0;
+    for(int k = 0; k < n; ++k)
+    {
+        int const option = f_Option[k];
+
+        if(f_Mass[k] >= f_Daughter1Mass[option] + f_Daughter2Mass[option])
+        {
+            particles.Add(f_Channel.daughter1ID[option], FourVector{f_D1x[k], f_D1y[k], f_D1z[k], f_D1E[k]}, f_MotherIndex[k]);
+            particles.Add(f_Channel.daughter2ID[option], FourVector{f_D2x[k], f_D2y[k], f_D2z[k], f_D2E[k]}, f_MotherIndex[k]);
+        }
+        else
+        {
+            std::cout << "\nDecayment cannot be performed because mass is too low in this channel\n";
+            ++failures;
+            particles.Add(f_Channel.daughter1ID[option], FourVector{0., 0., 0., f_Daughter1Mass[option]}, f_MotherIndex[k]);
+            particles.Add(f_Channel.daughter2ID[option], FourVector{0., 0., 0., f_Daughter2Mass[option]}, f_MotherIndex[k]);
+        }
+    }
+
+    return failures;
+}
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+void DecayBatch::Resize(int n)
+{
+    // On the heap resize() only allocates when n is bigger than ever before;
+    // from an arena the arrays of the previous call are gone with its Reset(), so new ones are taken
+    for(ArenaVector<double>* column : {&f_Px, &f_Py, &f_Pz, &f_U1, &f_U2, &f_UPhi, &f_UTheta, &f_Mass, &f_MassDau1, &f_MassDau2, &f_Pout,
+                                       &f_Dx, &f_Dy, &f_Dz, &f_D1x, &f_D1y, &f_D1z, &f_D1E, &f_D2x, &f_D2y, &f_D2z, &f_D2E})
+    {
+        if(f_Arena != nullptr) { *column = ArenaVector<double>(n, 0., ArenaAllocator<double>{f_Arena}); }
+        else { column->resize(n); }
+    }
+
+    for(ArenaVector<int>* column : {&f_Option, &f_MotherIndex})
+    {
+        if(f_Arena != nullptr) { *column = ArenaVector<int>(n, 0, ArenaAllocator<int>{f_Arena}); }
+        else { column->resize(n); }
+    }
+}
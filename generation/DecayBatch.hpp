@@ -0,0 +1,64 @@
+// Daniel Michelin
+
+#ifndef DECAYBATCH_HPP
+#define DECAYBATCH_HPP
+#include "EventBuffer.hpp"
+#include "RandomStream.hpp"
+#include "EventArena.hpp"
+#include <vector>
+
+//Two body decay of a resonance into one of two equally likely pairs of daughters,
+//e.g. K* --> Pion(+) Kaon(-) or Pion(-) Kaon(+)
+struct DecayChannel
+{
+  int motherID;
+  int daughter1ID[2]; //daughter1ID[c] and daughter2ID[c] are the products of the c-th option
+  int daughter2ID[2];
+};
+
+//Decays every resonance of an event at once, instead of one Particle::Decay2Body() call per mother.
+//The mothers are gathered in a structure of arrays, then mass smearing, angles, impulses and boosts are each
+//computed in a loop over all the mothers. The impulses and boosts are branch-free loops, which the compiler vectorises
+//with the flags of the Makefile; the smearing and the angles call log(), sin() and cos() one mother at a time, as
+//Decay2Body does, so that the daughters are the same to the last bit.
+//The daughters go straight into the event buffer, two by two, in the order of their mothers, with their mother's position.
+//The scratch arrays are kept between calls, so once they've grown no more memory is allocated; if given an arena,
+//they're taken from it at every call instead, which must then come after the arena's Reset() for that event.
+class DecayBatch
+{
+public:
+  DecayBatch(DecayChannel const& channel, EventArena* arena = nullptr); //parametric constructor
+
+  //Decays every particle of type channel.motherID among the first 'size' ones of the buffer, appending the daughters;
+  //returns the number of mothers whose smeared mass was too low to decay (their daughters are added with zero impulse, as Decay2Body does)
+  int Decay(EventBuffer& particles, int size, RandomStream& rng);
+
+
+protected:
+
+
+private:
+  DecayChannel const f_Channel;
+  EventArena* f_Arena;
+
+  double const f_MotherMass;
+  double const f_MotherWidth;
+  double const f_Daughter1Mass[2];
+  double const f_Daughter2Mass[2];
+
+  // Scratch, one element per mother
+  ArenaVector<int> f_MotherIndex; //position of the mother in the buffer
+  ArenaVector<double> f_Px, f_Py, f_Pz; //impulse of the mother
+  ArenaVector<double> f_U1, f_U2, f_UPhi, f_UTheta; //uniform random numbers
+  ArenaVector<int> f_Option; //which pair of daughters
+  ArenaVector<double> f_Mass; //smeared mass of the mother
+  ArenaVector<double> f_MassDau1, f_MassDau2; //masses of the daughters of the chosen pair
+  ArenaVector<double> f_Pout; //impulse of the daughters in the mother's frame
+  ArenaVector<double> f_Dx, f_Dy, f_Dz; //direction of daughter 1 in the mother's frame
+  ArenaVector<double> f_D1x, f_D1y, f_D1z, f_D1E; //daughters in the laboratory frame
+  ArenaVector<double> f_D2x, f_D2y, f_D2z, f_D2E;
+
+  void Resize(int n);
+};
+
+#endif
@@ -0,0 +1,73 @@
+// Daniel Michelin
+
+#include "EventArena.hpp"
+#include <cstdlib>
+
+
+EventArena::EventArena(std::size_t blockSize) : f_Offset{0}, f_BytesUsed{0}, f_HeapAllocations{0}
+{
+    NewBlock(blockSize);
+}
+
+EventArena::~EventArena()
+{
+    for(Block const& block : f_Blocks)
+    {
+        std::free(block.memory);
+    }
+}
+
+void* EventArena::Allocate(std::size_t bytes, std::size_t alignment)
+{
+    std::size_t start = (f_Offset + alignment - 1) / alignment * alignment;
+
+    if(start + bytes > f_Blocks.back().size) //doesn't fit: a new block, at least twice as big as the last one
+    {
+        std::size_t size = 2 * f_Blocks.back().size;
+        while(size < bytes + alignment) { size *= 2; }
+
+        NewBlock(size);
+        start = 0;
+    }
+
+    f_Offset = start + bytes;
+    f_BytesUsed += bytes;
+
+    return f_Blocks.back().memory + start;
+}
+
+void EventArena::Reset()
+{
+    if(f_Blocks.size() > 1)
+    {
+        // The last event didn't fit in one block: they're all replaced by one big enough for everything
+        std::size_t total = 0;
+        for(Block const& block : f_Blocks)
+        {
+            total += block.size;
+            std::free(block.memory);
+        }
+        f_Blocks.clear();
+        NewBlock(total);
+    }
+
+    f_Offset = 0;
+    f_BytesUsed = 0;
+}
+
+std::size_t EventArena::getHeapAllocations() const { return f_HeapAllocations; }
+std::size_t EventArena::getBytesUsed() const { return f_BytesUsed; }
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+void EventArena::NewBlock(std::size_t size)
+{
+    char* memory = static_cast<char*>(std::malloc(size));
+    if(memory == nullptr) { throw std::bad_alloc{}; }
+
+    f_Blocks.push_back(Block{memory, size});
+    f_Offset = 0;
+    ++f_HeapAllocations;
+}
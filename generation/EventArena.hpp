@@ -0,0 +1,85 @@
+// Daniel Michelin
+
+#ifndef EVENTARENA_HPP
+#define EVENTARENA_HPP
+#include <cstddef>
+#include <vector>
+#include <new>
+
+//Bump allocator for whatever lives only as long as one event: allocating is moving an offset forward, freeing is a no-op,
+//and Reset() makes all of its memory available again at once. After Reset() it keeps a single block as big as everything
+//the previous event needed, so once the events stop growing the arena never goes back to the heap.
+//One arena per thread: it isn't thread-safe, but threads never compete for it either.
+class EventArena
+{
+public:
+  EventArena(std::size_t blockSize = 1 << 16); //size in bytes of the first block
+  ~EventArena();
+
+  EventArena(EventArena const&) = delete;
+  EventArena& operator=(EventArena const&) = delete;
+
+  void* Allocate(std::size_t bytes, std::size_t alignment);
+  void Reset(); //every pointer given so far becomes invalid
+
+  std::size_t getHeapAllocations() const; //number of blocks taken from the heap so far
+  std::size_t getBytesUsed() const; //since the last Reset()
+
+
+protected:
+
+
+private:
+  struct Block
+  {
+    char* memory;
+    std::size_t size;
+  };
+
+  std::vector<Block> f_Blocks; //the last one is the one being filled
+  std::size_t f_Offset; //first free byte of the last block
+  std::size_t f_BytesUsed;
+  std::size_t f_HeapAllocations;
+
+  void NewBlock(std::size_t size);
+};
+
+
+//Standard allocator drawing from an EventArena, so that std::vector and the like can live in it.
+//Without an arena it falls back to the heap, like std::allocator.
+template<typename T>
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  ArenaAllocator(EventArena* arena = nullptr) : f_Arena{arena} {}
+  template<typename U> ArenaAllocator(ArenaAllocator<U> const& other) : f_Arena{other.getArena()} {}
+
+  T* allocate(std::size_t n)
+  {
+    if(f_Arena == nullptr) { return static_cast<T*>(::operator new(n * sizeof(T))); }
+    return static_cast<T*>(f_Arena->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* pointer, std::size_t)
+  {
+    if(f_Arena == nullptr) { ::operator delete(pointer); }
+    //memory from the arena is given back all at once by EventArena::Reset()
+  }
+
+  EventArena* getArena() const { return f_Arena; }
+
+  template<typename U> bool operator==(ArenaAllocator<U> const& other) const { return f_Arena == other.getArena(); }
+  template<typename U> bool operator!=(ArenaAllocator<U> const& other) const { return f_Arena != other.getArena(); }
+
+
+private:
+  EventArena* f_Arena;
+};
+
+//Vector whose memory comes from an EventArena
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
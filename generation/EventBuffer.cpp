@@ -0,0 +1,119 @@
+// Daniel Michelin
+
+#include "EventBuffer.hpp"
+#include <cmath>
+
+
+EventBuffer::EventBuffer(int capacity, EventArena* arena) :
+    f_Arena{arena},
+    f_Capacity{capacity},
+    f_Px(ArenaAllocator<double>{arena}),
+    f_Py(ArenaAllocator<double>{arena}),
+    f_Pz(ArenaAllocator<double>{arena}),
+    f_Energy(ArenaAllocator<double>{arena}),
+    f_Mass(ArenaAllocator<double>{arena}),
+    f_Charge(ArenaAllocator<int>{arena}),
+    f_SpeciesID(ArenaAllocator<int>{arena}),
+    f_Mother(ArenaAllocator<int>{arena})
+{
+    Reserve(capacity);
+}
+
+void EventBuffer::Clear()
+{
+    if(getSize() > f_Capacity) { f_Capacity = getSize(); }
+
+    if(f_Arena == nullptr)
+    {
+        // std::vector::clear() doesn't release memory, so the next event reuses it
+        f_Px.clear();
+        f_Py.clear();
+        f_Pz.clear();
+        f_Energy.clear();
+        f_Mass.clear();
+        f_Charge.clear();
+        f_SpeciesID.clear();
+        f_Mother.clear();
+    }
+    else
+    {
+        // the old arrays were in memory the arena has just taken back: new ones are made, without freeing anything
+        f_Px = ArenaVector<double>(ArenaAllocator<double>{f_Arena});
+        f_Py = ArenaVector<double>(ArenaAllocator<double>{f_Arena});
+        f_Pz = ArenaVector<double>(ArenaAllocator<double>{f_Arena});
+        f_Energy = ArenaVector<double>(ArenaAllocator<double>{f_Arena});
+        f_Mass = ArenaVector<double>(ArenaAllocator<double>{f_Arena});
+        f_Charge = ArenaVector<int>(ArenaAllocator<int>{f_Arena});
+        f_SpeciesID = ArenaVector<int>(ArenaAllocator<int>{f_Arena});
+        f_Mother = ArenaVector<int>(ArenaAllocator<int>{f_Arena});
+        Reserve(f_Capacity);
+    }
+}
+
+void EventBuffer::Reserve(int capacity)
+{
+    f_Px.reserve(capacity);
+    f_Py.reserve(capacity);
+    f_Pz.reserve(capacity);
+    f_Energy.reserve(capacity);
+    f_Mass.reserve(capacity);
+    f_Charge.reserve(capacity);
+    f_SpeciesID.reserve(capacity);
+    f_Mother.reserve(capacity);
+}
+
+int EventBuffer::Add(Particle const& particle)
+{
+    FourVector const P = particle.getFourVector();
+
+    f_Px.push_back(P.px);
+    f_Py.push_back(P.py);
+    f_Pz.push_back(P.pz);
+    f_Energy.push_back(P.E);
+    f_Mass.push_back(particle.getMass());
+    f_Charge.push_back(particle.getCharge());
+    f_SpeciesID.push_back(particle.getIndex());
+    f_Mother.push_back(-1);
+
+    return getSize() - 1;
+}
+
+int EventBuffer::Add(int speciesID, FourVector const& P, int mother)
+{
+    f_Px.push_back(P.px);
+    f_Py.push_back(P.py);
+    f_Pz.push_back(P.pz);
+    f_Energy.push_back(P.E);
+    f_Mass.push_back(Particle::getParticleTypeMass(speciesID));
+    f_Charge.push_back(Particle::getParticleTypeCharge(speciesID));
+    f_SpeciesID.push_back(speciesID);
+    f_Mother.push_back(mother);
+
+    return getSize() - 1;
+}
+
+int EventBuffer::getSize() const { return f_SpeciesID.size(); }
+
+Particle EventBuffer::getParticle(int i) const
+{
+    return Particle{f_SpeciesID[i], f_Px[i], f_Py[i], f_Pz[i]};
+}
+
+double EventBuffer::InvMass(int i, int j) const
+{
+    double const sumOfE = f_Energy[i] + f_Energy[j];
+    double const sumOfPx = f_Px[i] + f_Px[j];
+    double const sumOfPy = f_Py[i] + f_Py[j];
+    double const sumOfPz = f_Pz[i] + f_Pz[j];
+
+    return sqrt(sumOfE*sumOfE - (sumOfPx*sumOfPx + sumOfPy*sumOfPy + sumOfPz*sumOfPz));
+}
+
+double const* EventBuffer::getPx() const { return f_Px.data(); }
+double const* EventBuffer::getPy() const { return f_Py.data(); }
+double const* EventBuffer::getPz() const { return f_Pz.data(); }
+double const* EventBuffer::getEnergy() const { return f_Energy.data(); }
+double const* EventBuffer::getMass() const { return f_Mass.data(); }
+int const* EventBuffer::getCharge() const { return f_Charge.data(); }
+int const* EventBuffer::getSpeciesID() const { return f_SpeciesID.data(); }
+int const* EventBuffer::getMother() const { return f_Mother.data(); }
@@ -0,0 +1,56 @@
+// Daniel Michelin
+
+#ifndef EVENTBUFFER_HPP
+#define EVENTBUFFER_HPP
+#include "Particle.hpp"
+#include "EventArena.hpp"
+#include <vector>
+
+//Particles of a single event, stored as a structure of arrays: one contiguous array per quantity.
+//The buffer is meant to be reused from one event to the next: Clear() empties it but keeps the capacity.
+//If given an arena, the arrays are allocated from it: then Clear() has to be called right after the arena's Reset(),
+//and it takes new arrays from the arena, as big as the biggest event seen so far.
+class EventBuffer
+{
+public:
+  EventBuffer(int capacity = 0, EventArena* arena = nullptr); //reserves room for 'capacity' particles
+
+  void Clear(); //removes every particle, keeping the capacity
+  void Reserve(int capacity);
+  int Add(Particle const& particle); //copies the particle at the end of the buffer and returns its position
+  int Add(int speciesID, FourVector const& P, int mother = -1); //same, straight from the type index and the four-momentum, without making a Particle
+  int getSize() const;
+
+  Particle getParticle(int i) const; //rebuilds the particle at position i, for the parts of the code that still need a Particle
+
+  double InvMass(int i, int j) const; //same as Particle::InvMass, computed from the stored four-momenta
+
+  // Columns; each one is getSize() long
+  double const* getPx() const;
+  double const* getPy() const;
+  double const* getPz() const;
+  double const* getEnergy() const;
+  double const* getMass() const;
+  int const* getCharge() const;
+  int const* getSpeciesID() const; //index in the particle table, i.e. Particle::getIndex()
+  int const* getMother() const; //position in the buffer of the particle that decayed into this one, -1 if it doesn't come from a decay
+
+
+protected:
+
+
+private:
+  EventArena* f_Arena; //nullptr if the arrays are on the heap
+  int f_Capacity; //biggest size reached so far
+
+  ArenaVector<double> f_Px;
+  ArenaVector<double> f_Py;
+  ArenaVector<double> f_Pz;
+  ArenaVector<double> f_Energy;
+  ArenaVector<double> f_Mass;
+  ArenaVector<int> f_Charge;
+  ArenaVector<int> f_SpeciesID;
+  ArenaVector<int> f_Mother;
+};
+
+#endif
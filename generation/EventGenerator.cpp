@@ -0,0 +1,884 @@
+// Daniel Michelin
+
+#include "EventGenerator.hpp"
+#include "Particle.hpp"
+#include "RandomStream.hpp"
+#include "EventArena.hpp"
+#include "EventBuffer.hpp"
+#include "PairKernel.hpp"
+#include "DecayBatch.hpp"
+#include "TiledPairLoop.hpp"
+#include "StageProfiler.hpp"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <cmath> //also for M_PI
+
+
+int FillDefaultParticleTable()
+{
+    if(Particle::getNumParticleType() == 0)
+    {
+        std::cout << '\n';
+
+        //add new types here
+        Particle::AddParticleType("Pion(+)", 0.13957, 1);
+        Particle::AddParticleType("Pion(-)", 0.13957, -1);
+        Particle::AddParticleType("Kaon(+)", 0.49367, 1);
+        Particle::AddParticleType("Kaon(-)", 0.49367, -1);
+        Particle::AddParticleType("Proton(+)", 0.93827, 1);
+        Particle::AddParticleType("Proton(-)", 0.93827, -1);
+        Particle::AddParticleType("K*", 0.89166, 0, 0.050);
+    }
+
+    return Particle::getNumParticleType();
+}
+
+std::vector<SpeciesAbundance> DefaultAbundancies()
+{
+    return std::vector<SpeciesAbundance>{
+        {Particle::FindParticle_public("Pion(+)"), 0.40},   //Pions 80%
+        {Particle::FindParticle_public("Pion(-)"), 0.40},
+        {Particle::FindParticle_public("Kaon(+)"), 0.05},   //Kaons 10%
+        {Particle::FindParticle_public("Kaon(-)"), 0.05},
+        {Particle::FindParticle_public("Proton(+)"), 0.045},   //Protons 9%
+        {Particle::FindParticle_public("Proton(-)"), 0.045},
+        {Particle::FindParticle_public("K*"), 0.01}   //K* 1%
+    };
+}
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+static std::mutex progressBarMutex; //std::cout is shared by every generator
+
+EventGenerator::EventGenerator(GenerationConfig const& config, AliasSampler const& sampler) :
+    f_Config(config),
+    f_Sampler{MakeEnhancedSampler(sampler, config.resonanceEnhancement)},
+    f_SpeciesWeights(Particle::getNumParticleType(), 1.),
+    f_PairCategories{}, //built once from the particle table; only read during the generation
+    f_StealsNum{0},
+    f_Profiler{nullptr},
+    f_SnapshotWriter{WriteHistograms},
+    f_GeneratedEventsNum{0},
+    f_ShardFirstEvent{0},
+    f_ShardLastEvent{0},
+    f_FirstEvent{0},
+    f_StartedEventsNum{0},
+    f_InitialHistos{},
+    f_KaonStarFit{},
+    f_KaonStarID{Particle::FindParticle_public("K*")},
+    f_QueueStats{},
+    f_PairHelpers{}
+{
+    if(f_Config.seed == 0) { f_Config.seed = RandomStream::MakeSeed(); }
+    if(f_Config.threadsNum < 1) { f_Config.threadsNum = 1; }
+    if(!(f_Config.resonanceEnhancement > 0.)) { f_Config.resonanceEnhancement = 1.; }
+    if(f_Config.batchEventsNum < 1) { f_Config.batchEventsNum = 1; }
+    if(f_Config.samplingThreadsNum < 1) { f_Config.samplingThreadsNum = 1; }
+    if(f_Config.decayThreadsNum < 1) { f_Config.decayThreadsNum = 1; }
+    if(f_Config.pairStageThreadsNum < 1) { f_Config.pairStageThreadsNum = 1; }
+    if(f_Config.queueDepth < 1) { f_Config.queueDepth = 1; }
+    if(f_Config.shardsNum < 1) { f_Config.shardsNum = 1; }
+    if(f_Config.shardIndex < 0 || f_Config.shardIndex >= f_Config.shardsNum) { f_Config.shardIndex = 0; }
+
+    // Equal slices of the events, the first ones an event shorter when they don't divide evenly
+    f_ShardFirstEvent = (long long)f_Config.eventsNum * f_Config.shardIndex / f_Config.shardsNum;
+    f_ShardLastEvent = (long long)f_Config.eventsNum * (f_Config.shardIndex + 1) / f_Config.shardsNum;
+    f_FirstEvent = f_ShardFirstEvent;
+
+    // The helpers of the pair loop, shared by the threads that fill the pairs, each of which queues at most pairThreadsNum - 1 parts at a time
+    if(f_Config.pairThreadsNum > 1)
+    {
+        int const pairLoopsNum = f_Config.pipelined ? f_Config.pairStageThreadsNum : f_Config.threadsNum;
+        f_PairHelpers = std::make_unique<PairHelperPool>(f_Config.pairThreadsNum - 1, pairLoopsNum * (f_Config.pairThreadsNum - 1));
+    }
+
+    // p/q for every species that can be drawn: the true probability over the one of the enhanced sampler
+    if(isWeighted())
+    {
+        for(int i = 0; i < sampler.getNumSpecies(); ++i)
+        {
+            f_SpeciesWeights[sampler.getSpeciesID(i)] = sampler.getProbability(i) / f_Sampler.getProbability(i);
+        }
+    }
+}
+
+GenerationHistograms EventGenerator::Run()
+{
+    f_StartedEventsNum = f_FirstEvent - f_ShardFirstEvent; //the progress bar goes on from the checkpoint
+    f_StealsNum = 0;
+    f_GeneratedEventsNum = f_FirstEvent - f_ShardFirstEvent;
+    f_KaonStarFit = GaussianFitResult{};
+    f_QueueStats.clear();
+
+    int const eventsNum = f_ShardLastEvent; //the events of the shard are [f_ShardFirstEvent, f_ShardLastEvent)
+    bool const isAdaptive = f_Config.targetPrecision > 0.;
+    bool const isBatched = isAdaptive || !f_Config.checkpointFile.empty() || !f_Config.snapshotFile.empty();
+    int const batchEventsNum = isBatched ? f_Config.batchEventsNum : eventsNum;
+
+    // Optional event store, shared by all the threads
+    EventStoreWriter* store = nullptr;
+    if(!f_Config.eventStoreFile.empty())
+    {
+        store = new EventStoreWriter{f_Config.eventStoreFile, f_Config.seed, f_Config.particlesPerEvent, f_SpeciesWeights};
+        if(!store->isOpen())
+        {
+            std::cout << "The events won't be stored\n";
+            delete store;
+            store = nullptr;
+        }
+    }
+
+    GenerationHistograms histos = f_InitialHistos;
+
+    for(int firstEvent = f_FirstEvent; firstEvent < eventsNum; firstEvent += batchEventsNum)
+    {
+        int const lastEvent = (eventsNum - firstEvent > batchEventsNum) ? firstEvent + batchEventsNum : eventsNum;
+        GenerateBatch(firstEvent, lastEvent, histos, store);
+        f_GeneratedEventsNum = lastEvent - f_ShardFirstEvent;
+
+        if(!f_Config.checkpointFile.empty())
+        {
+            ScopedStageTimer timer{(f_Profiler != nullptr) ? f_Profiler->getThreadProfile(0) : nullptr, Stage_OutputWrite};
+            WriteCheckpoint(f_Config.checkpointFile, MakeCheckpoint(histos, lastEvent)); //if it fails, the run goes on without it
+        }
+        if(!f_Config.snapshotFile.empty())
+        {
+            ScopedStageTimer timer{(f_Profiler != nullptr) ? f_Profiler->getThreadProfile(0) : nullptr, Stage_OutputWrite};
+            histos.getRuns().push_back(MakeRun(lastEvent)); //a complete output file, so with this run too
+            WriteHistogramsAtomically(f_Config.snapshotFile, histos, f_SnapshotWriter); //same as the checkpoint
+            histos.getRuns().pop_back();
+        }
+
+        if(!isAdaptive) { continue; }
+
+        f_KaonStarFit = FitKaonStarPeak(histos);
+        if(f_Config.showProgress)
+        {
+            std::cout << "\n " << lastEvent << " events: ";
+            if(f_KaonStarFit.isValid)
+            {
+                std::cout << "K* mass " << f_KaonStarFit.mean << " +/- " << f_KaonStarFit.meanError
+                          << ", width " << f_KaonStarFit.sigma << " +/- " << f_KaonStarFit.sigmaError;
+            }
+            else { std::cout << "no K* peak yet"; }
+            std::cout.flush();
+        }
+
+        if(isTargetPrecisionReached()) { break; }
+    }
+
+    if(store != nullptr)
+    {
+        ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(0) : nullptr;
+        ScopedStageTimer timer{profile, Stage_EventStore};
+        store->Close();
+        delete store;
+    }
+
+    histos.getRuns().push_back(MakeRun(f_ShardFirstEvent + f_GeneratedEventsNum));
+
+    return histos;
+}
+
+std::uint64_t EventGenerator::getSeed() const { return f_Config.seed; }
+GenerationConfig const& EventGenerator::getConfig() const { return f_Config; }
+int EventGenerator::getStealsNum() const { return f_StealsNum; }
+std::vector<QueueStats> const& EventGenerator::getQueueStats() const { return f_QueueStats; }
+void EventGenerator::setProfiler(StageProfiler* profiler) { f_Profiler = profiler; }
+void EventGenerator::setSnapshotWriter(HistogramFileWriter writer) { f_SnapshotWriter = writer; }
+bool EventGenerator::isWeighted() const { return f_Config.resonanceEnhancement != 1.; }
+std::vector<double> const& EventGenerator::getSpeciesWeights() const { return f_SpeciesWeights; }
+bool EventGenerator::Resume(GenerationCheckpoint const& checkpoint)
+{
+    GenerationCheckpoint const current = MakeCheckpoint(GenerationHistograms{}, 0);
+
+    bool isSameSampling = current.abundancies.size() == checkpoint.abundancies.size();
+    for(unsigned i = 0; isSameSampling && i < current.abundancies.size(); ++i)
+    {
+        isSameSampling = current.abundancies[i].speciesID == checkpoint.abundancies[i].speciesID
+                         && std::fabs(current.abundancies[i].probability - checkpoint.abundancies[i].probability) < 1e-12;
+    }
+
+    if(!isSameSampling || current.particlesPerEvent != checkpoint.particlesPerEvent || current.multiplicity != checkpoint.multiplicity
+       || (current.multiplicity == Multiplicity_NegativeBinomial && current.multiplicityShape != checkpoint.multiplicityShape)
+       || current.resonanceEnhancement != checkpoint.resonanceEnhancement)
+    {
+        std::cout << "The checkpoint was written by a run with different particles per event, multiplicity, abundancies or resonance enhancement:\n"
+                  << "  particles per event " << checkpoint.particlesPerEvent << ", multiplicity " << checkpoint.multiplicity
+                  << " (shape " << checkpoint.multiplicityShape << "), resonance enhancement " << checkpoint.resonanceEnhancement << '\n';
+        return false;
+    }
+
+    if(checkpoint.firstEvent != f_ShardFirstEvent)
+    {
+        std::cout << "The checkpoint starts from event " << checkpoint.firstEvent << ", the shard from event " << f_ShardFirstEvent
+                  << ": the shards of a run can't be resumed with a different number of events or of shards\n";
+        return false;
+    }
+
+    f_Config.seed = checkpoint.seed;
+    f_FirstEvent = checkpoint.nextEvent;
+    f_InitialHistos = checkpoint.histos;
+
+    return true;
+}
+
+bool EventGenerator::setInitialHistograms(GenerationHistograms const& histos)
+{
+    for(GenerationRun const& run : histos.getRuns())
+    {
+        if(run.seed == f_Config.seed)
+        {
+            std::cout << "The histograms already have the events [" << run.firstEvent << ", " << run.lastEvent << ") of a run with seed "
+                      << run.seed << ": the same seed would generate the same events again\n";
+            return false;
+        }
+    }
+
+    f_InitialHistos = histos;
+    return true;
+}
+
+GenerationCheckpoint EventGenerator::MakeCheckpoint(GenerationHistograms const& histos, int nextEvent) const
+{
+    GenerationCheckpoint checkpoint;
+    checkpoint.seed = f_Config.seed;
+    checkpoint.firstEvent = f_ShardFirstEvent;
+    checkpoint.nextEvent = nextEvent;
+    checkpoint.particlesPerEvent = f_Config.particlesPerEvent;
+    checkpoint.multiplicity = f_Config.multiplicity;
+    checkpoint.multiplicityShape = f_Config.multiplicityShape;
+    checkpoint.resonanceEnhancement = f_Config.resonanceEnhancement;
+    for(int i = 0; i < f_Sampler.getNumSpecies(); ++i)
+    {
+        checkpoint.abundancies.push_back(SpeciesAbundance{f_Sampler.getSpeciesID(i), f_Sampler.getProbability(i)});
+    }
+    checkpoint.histos = histos;
+
+    return checkpoint;
+}
+
+int EventGenerator::getFirstEventNum() const { return f_FirstEvent; }
+int EventGenerator::getGeneratedEventsNum() const { return f_GeneratedEventsNum; }
+int EventGenerator::getNewEventsNum() const { return f_GeneratedEventsNum - (f_FirstEvent - f_ShardFirstEvent); }
+int EventGenerator::getShardFirstEvent() const { return f_ShardFirstEvent; }
+int EventGenerator::getShardLastEvent() const { return f_ShardLastEvent; }
+GaussianFitResult const& EventGenerator::getKaonStarFit() const { return f_KaonStarFit; }
+
+bool EventGenerator::isTargetPrecisionReached() const
+{
+    double const target = f_Config.targetPrecision;
+    return f_KaonStarFit.isValid && f_KaonStarFit.meanError < target * std::fabs(f_KaonStarFit.mean)
+           && f_KaonStarFit.sigmaError < target * f_KaonStarFit.sigma;
+}
+
+GaussianFitResult EventGenerator::FitKaonStarPeak(GenerationHistograms const& histos)
+{
+    return FitGaussian(histos[Histo_InvMass_OppositeSign_PionKaon], &histos[Histo_InvMass_SameSign_PionKaon]);
+}
+
+int EventGenerator::SampleMultiplicity(GenerationConfig const& config, RandomStream& rng)
+{
+    switch(config.multiplicity)
+    {
+        case Multiplicity_Poisson:
+            return rng.Poisson(config.particlesPerEvent);
+
+        case Multiplicity_NegativeBinomial: //a Poisson whose mean follows a gamma distribution
+            return rng.Poisson(rng.Gamma(config.multiplicityShape, config.particlesPerEvent / config.multiplicityShape));
+
+        default:
+            return config.particlesPerEvent;
+    }
+}
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+// The events [firstEvent, lastEvent) of a batch cut into blocks, each filled into its own histograms (see BlockSum.hpp).
+// The size of the blocks only depends on the number of events, never on the threads: at most MaxBlocksNum blocks, so that
+// the sums stay cheap next to the events, of at least MinBlockSize events, so that the scheduler can still share out the
+// last ones between the threads
+struct EventGenerator::EventBlocks
+{
+    static int const MaxBlocksNum = 4096;
+    static int const MinBlockSize = 4;
+
+    int firstEvent;
+    int lastEvent;
+    int blockSize;
+
+    EventBlocks(int first, int last) :
+        firstEvent{first},
+        lastEvent{last},
+        blockSize{MinBlockSize}
+    {
+        int const eventsNum = (last > first) ? last - first : 0;
+        if((eventsNum + MaxBlocksNum - 1) / MaxBlocksNum > blockSize) { blockSize = (eventsNum + MaxBlocksNum - 1) / MaxBlocksNum; }
+    }
+
+    int getBlocksNum() const { return (lastEvent > firstEvent) ? (lastEvent - firstEvent + blockSize - 1) / blockSize : 0; }
+    int getFirstEvent(int block) const { return firstEvent + block * blockSize; }
+    int getLastEvent(int block) const { return (lastEvent - getFirstEvent(block) > blockSize) ? getFirstEvent(block) + blockSize : lastEvent; }
+    int getBlock(int event) const { return (event - firstEvent) / blockSize; }
+};
+
+// Generates the events [firstEvent, lastEvent), spread over the threads, and adds them to 'histos'
+void EventGenerator::GenerateBatch(int firstEvent, int lastEvent, GenerationHistograms& histos, EventStoreWriter* store)
+{
+    if(f_Config.pipelined)
+    {
+        GeneratePipelinedBatch(firstEvent, lastEvent, histos, store);
+        return;
+    }
+
+    // The histograms are filled a block of events at a time and summed block by block (see BlockSum.hpp): the same blocks,
+    // and so the same sums, with any number of threads
+    int const threadsNum = f_Config.threadsNum;
+    EventBlocks const blocks{firstEvent, lastEvent};
+    BlockSum<GenerationHistograms> blockHistos{blocks.getBlocksNum(), GenerationHistograms{}};
+
+    WorkStealingScheduler scheduler{threadsNum, 0, blocks.getBlocksNum()};
+
+    if(f_Profiler != nullptr) { f_Profiler->Resize(threadsNum); } //before the threads take their profiles
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(0) : nullptr; //for the merge, once thread 0 is done
+
+    if(threadsNum == 1)
+    {
+        GenerateEvents(blocks, blockHistos, store, scheduler, 0);
+    }
+    else
+    {
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadsNum; ++t)
+        {
+            threads.emplace_back(&EventGenerator::GenerateEvents, this, std::cref(blocks), std::ref(blockHistos), store, std::ref(scheduler), t);
+        }
+        for(std::thread& thread : threads) { thread.join(); }
+    }
+
+    {
+        ScopedStageTimer timer{profile, Stage_HistogramFilling};
+        histos.Add(blockHistos.getSum());
+    }
+
+    f_StealsNum += scheduler.getStealsNum();
+}
+
+// Same table as 'sampler', with the probabilities of the resonances multiplied by 'enhancement'; 'sampler' itself if it's 1
+AliasSampler EventGenerator::MakeEnhancedSampler(AliasSampler const& sampler, double enhancement)
+{
+    if(enhancement == 1. || !(enhancement > 0.)) { return sampler; }
+
+    std::vector<SpeciesAbundance> abundancies;
+    for(int i = 0; i < sampler.getNumSpecies(); ++i)
+    {
+        int const speciesID = sampler.getSpeciesID(i);
+        double const factor = (Particle::getParticleTypeWidth(speciesID) > 0.) ? enhancement : 1.;
+        abundancies.push_back(SpeciesAbundance{speciesID, sampler.getProbability(i) * factor});
+    }
+
+    return AliasSampler{abundancies};
+}
+
+// Generates the blocks of events the scheduler gives to worker 'worker', until there are none left, and hands the histograms
+// of every block over to 'blockHistos'
+// If 'store' isn't nullptr, the events are also written to it, a chunk at a time
+void EventGenerator::GenerateEvents(EventBlocks const& blocks, BlockSum<GenerationHistograms>& blockHistos, EventStoreWriter* store, WorkStealingScheduler& scheduler, int worker) const
+{
+    int const partPerEventNum = f_Config.particlesPerEvent;
+
+    // Everything that lives for one event only is allocated from the thread's arena, reset at the start of every event:
+    // after the first events have sized it, the event cycle doesn't allocate memory any more
+    EventArena arena;
+
+    DecayBatch kaonStarDecay{MakeKaonStarChannel(), &arena}; //K* --> Pion(+) Kaon(-) or Pion(-) Kaon(+)
+
+    EventBuffer particles{partPerEventNum, &arena}; //filled and emptied every event cycle
+
+    TiledPairLoop pairLoop{f_PairCategories, f_Config.pairTileSize, f_Config.pairThreadsNum, f_PairHelpers.get(), &blockHistos.getEmpty().getHistograms()[Histo_InvariantMass]};
+
+    std::vector<SampledValues> sampledValues;
+    sampledValues.reserve(partPerEventNum);
+
+    std::vector<double> particleWeights; //weights of the particles of the event, primary and decay products, if weighted
+    particleWeights.reserve(partPerEventNum);
+
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(worker) : nullptr; //nullptr = no profiling
+    if(profile != nullptr) { profile->AttachHardwareCounters(); } //only if the profiler asks for them
+
+    EventChunkBuilder storeChunk; //events waiting to be written to the store
+
+    int firstBlock;
+    int lastBlock;
+    while(scheduler.NextChunk(worker, firstBlock, lastBlock))
+    {
+        for(int block = firstBlock; block < lastBlock; ++block)
+        {
+            GenerationHistograms* const histos = blockHistos.Take();
+
+            for(int eventIndex = blocks.getFirstEvent(block); eventIndex < blocks.getLastEvent(block); ++eventIndex) //event cycle
+            {
+                ShowProgress();
+
+                RandomStream rng{f_Config.seed, (std::uint64_t)eventIndex};
+
+                arena.Reset();
+                particles.Clear();
+
+                int const p = SampleEvent(rng, particles, sampledValues, profile); //p == number of particles present before any decayment
+                FillParticleHistograms(particles, sampledValues, *histos, profile);
+                DecayEvent(kaonStarDecay, particles, p, rng, particleWeights, profile);
+                if(store != nullptr) { StoreEvent(eventIndex, particles, store, storeChunk, profile); }
+                FillPairHistograms(pairLoop, particles, p, particleWeights, *histos, profile);
+            } //END OF EVENTS GENERATION; END OF THE for loop
+
+            ScopedStageTimer timer{profile, Stage_HistogramFilling};
+            blockHistos.Add(block, histos);
+        }
+    } //END OF THE CHUNKS GIVEN BY THE SCHEDULER
+
+    if(store != nullptr) //the last events, if they didn't fill a chunk
+    {
+        ScopedStageTimer timer{profile, Stage_EventStore};
+        store->WriteChunk(storeChunk.getView());
+    }
+
+    if(profile != nullptr) { profile->DetachHardwareCounters(); }
+}
+
+// K* --> Pion(+) Kaon(-) or Pion(-) Kaon(+), with the indexes of the particle table
+GenerationRun EventGenerator::MakeRun(int lastEvent) const
+{
+    return GenerationRun{f_Config.seed, f_Config.shardIndex, f_Config.shardsNum, std::uint64_t(f_ShardFirstEvent), std::uint64_t(lastEvent)};
+}
+
+DecayChannel EventGenerator::MakeKaonStarChannel()
+{
+    int const K_ID = Particle::FindParticle_public("K*");
+    int const PionPlus_ID = Particle::FindParticle_public("Pion(+)");
+    int const PionMinus_ID = Particle::FindParticle_public("Pion(-)");
+    int const KaonPlus_ID = Particle::FindParticle_public("Kaon(+)");
+    int const KaonMinus_ID = Particle::FindParticle_public("Kaon(-)");
+
+    return DecayChannel{K_ID, {PionPlus_ID, PionMinus_ID}, {KaonMinus_ID, KaonPlus_ID}};
+}
+
+// Live progress bar: counts an event as started, and shows the percentage every 5% of the events
+void EventGenerator::ShowProgress() const
+{
+    int const eventsNum = f_ShardLastEvent - f_ShardFirstEvent;
+    int const progressStep = ((int)(0.05 * eventsNum)) > 0 ? (int)(0.05 * eventsNum) : 1;
+
+    int const eventCounter = f_StartedEventsNum++;
+    if(f_Config.showProgress && eventCounter % progressStep == 0)
+    {
+        double fraction = ((double)eventCounter / (double)eventsNum) * 100;
+        std::lock_guard<std::mutex> lock{progressBarMutex};
+        std::cout << "..." << (int)fraction << "%";
+        std::cout.flush();
+    }
+}
+
+// Draws the multiplicity, then type and impulse of every primary particle into 'particles' (which must be empty), keeping
+// the values that go into the histograms but not into the buffer in 'sampledValues'; returns the number of particles
+int EventGenerator::SampleEvent(RandomStream& rng, EventBuffer& particles, std::vector<SampledValues>& sampledValues, ThreadProfile* profile) const
+{
+    int eventParticlesNum;
+    {
+        ScopedStageTimer timer{profile, Stage_Sampling};
+
+        eventParticlesNum = SampleMultiplicity(f_Config, rng); //drawn first, so a fixed multiplicity leaves the events as they were
+        sampledValues.clear();
+
+        for(int particleCounter = 0; particleCounter < eventParticlesNum; ++particleCounter) //batch of particles cycle
+        {
+            int const particleID = f_Sampler.Sample(rng);
+    
+            double theta = rng.Rndm() * M_PI; //azimutal coordinate
+            double phi = rng.Rndm() * 2 * M_PI; //polar coordinate
+            double P = rng.Exp(1.); //impulse
+    
+            // Calculating impulse components through spherical coordinates
+            double Px = P * sin(theta) * cos(phi);
+            double Py = P * sin(theta) * sin(phi);
+            double Pz = P * cos(theta);
+            double PTransverse = sqrt(Px*Px + Py*Py);
+
+            sampledValues.push_back(SampledValues{theta, phi, P, PTransverse});
+            particles.Add(Particle{particleID, Px, Py, Pz}); //puts the "chosen" particle into the buffer
+        }
+    }
+    if(profile != nullptr) { profile->Count(Stage_Sampling, eventParticlesNum); }
+
+    return particles.getSize();
+}
+
+// Single particle histograms of the primary particles, i.e. all the ones in the buffer before the decays
+void EventGenerator::FillParticleHistograms(EventBuffer const& particles, std::vector<SampledValues> const& sampledValues, GenerationHistograms& histos, ThreadProfile* profile) const
+{
+    int const p = sampledValues.size();
+    {
+        ScopedStageTimer timer{profile, Stage_HistogramFilling};
+
+        int const* speciesID = particles.getSpeciesID();
+        double const* energy = particles.getEnergy();
+        if(!isWeighted())
+        {
+            for(int i = 0; i < p; ++i)
+            {
+                histos[Histo_ParticleAbundancies].FillBin(speciesID[i] + 1); //FILLING PARTICLE ABUNDANCIES HISTOGRAM in the bin labelled with the particle's name
+                histos[Histo_Theta].Fill(sampledValues[i].theta);
+                histos[Histo_Phi].Fill(sampledValues[i].phi);
+                histos[Histo_Impulse].Fill(sampledValues[i].P);
+                histos[Histo_TransverseImpulse].Fill(sampledValues[i].PTransverse);
+                histos[Histo_Energy].Fill(energy[i]);
+            }
+        }
+        else //the same, with the weight of each particle's species
+        {
+            for(int i = 0; i < p; ++i)
+            {
+                double const w = f_SpeciesWeights[speciesID[i]];
+                histos[Histo_ParticleAbundancies].FillBin(speciesID[i] + 1, w);
+                histos[Histo_Theta].Fill(sampledValues[i].theta, w);
+                histos[Histo_Phi].Fill(sampledValues[i].phi, w);
+                histos[Histo_Impulse].Fill(sampledValues[i].P, w);
+                histos[Histo_TransverseImpulse].Fill(sampledValues[i].PTransverse, w);
+                histos[Histo_Energy].Fill(energy[i], w);
+            }
+        }
+    }
+    if(profile != nullptr) { profile->Count(Stage_HistogramFilling, 6LL * p); }
+}
+
+// Makes every K* among the first 'primariesNum' particles decay and adds its products at the end of the buffer, two by two;
+// if weighted, also sets the weight of every particle of the event in 'particleWeights'
+void EventGenerator::DecayEvent(DecayBatch& decay, EventBuffer& particles, int primariesNum, RandomStream& rng, std::vector<double>& particleWeights, ThreadProfile* profile) const
+{
+    {
+        ScopedStageTimer timer{profile, Stage_Decay};
+        decay.Decay(particles, primariesNum, rng);
+    }
+
+    int const p2 = particles.getSize(); //p2 == number of particles present after all decayments
+    if(profile != nullptr) { profile->Count(Stage_Decay, (p2 - primariesNum) / 2); }
+
+    // A decay product weighs what the particle it comes from weighs
+    if(isWeighted())
+    {
+        int const* speciesID = particles.getSpeciesID();
+        int const* mother = particles.getMother();
+        particleWeights.resize(p2);
+        for(int i = 0; i < p2; ++i)
+        {
+            particleWeights[i] = f_SpeciesWeights[speciesID[(mother[i] >= 0) ? mother[i] : i]];
+        }
+    }
+}
+
+// Adds the event to the chunk of the thread, writing the chunk to the store when it's full or the next event doesn't follow
+void EventGenerator::StoreEvent(int eventIndex, EventBuffer const& particles, EventStoreWriter* store, EventChunkBuilder& storeChunk, ThreadProfile* profile) const
+{
+    ScopedStageTimer timer{profile, Stage_EventStore};
+    if(profile != nullptr) { profile->Count(Stage_EventStore, 1); }
+
+    if(!storeChunk.isNextEvent(eventIndex)) //the scheduler has moved on to other events
+    {
+        store->WriteChunk(storeChunk.getView());
+        storeChunk.Clear();
+    }
+
+    storeChunk.AddEvent(eventIndex, particles);
+    if(storeChunk.isFull())
+    {
+        store->WriteChunk(storeChunk.getView());
+        storeChunk.Clear();
+    }
+}
+
+// Invariant mass histograms of the event, whose first 'primariesNum' particles are the primary ones and the others the decay
+// products; 'particleWeights' is only read if weighted
+void EventGenerator::FillPairHistograms(TiledPairLoop& pairLoop, EventBuffer const& particles, int primariesNum, std::vector<double> const& particleWeights, GenerationHistograms& histos, ThreadProfile* profile) const
+{
+    int const p = primariesNum;
+    int const p2 = particles.getSize();
+    bool const weighted = isWeighted();
+    PairWeights const pairWeights{weighted ? particleWeights.data() : nullptr, particles.getMother()};
+
+    // Invariant mass calculation and correspondent histogram filling -- K* must not be considered
+    // The masses are computed a block at a time by the pair kernel, a tile of the pair triangle at a time (see TiledPairLoop.hpp),
+    // then the pair categories table tells which histograms each pair goes into (no mask at all for pairs with a K*)
+    // The columns are read only from here on; they don't move until the next Clear()
+    {
+        ScopedStageTimer timer{profile, Stage_PairLoop};
+        pairLoop.Fill(GetFourMomentumColumns(particles), f_KaonStarID, &histos.getHistograms()[Histo_InvariantMass], weighted ? &pairWeights : nullptr);
+    }
+    if(profile != nullptr) { profile->Count(Stage_PairLoop, (long long)p2 * (p2 - 1) / 2); }
+
+    // Invariant mass between decay products of the same K*
+    {
+        ScopedStageTimer timer{profile, Stage_HistogramFilling};
+        for(int k = p; k < p2; k = k+2) //because the products have been put two by two at the end of the buffer
+        {
+            double invMassDecay = particles.InvMass(k, k+1);
+    
+            if(weighted) { histos[Histo_InvMass_SameKProducts].Fill(invMassDecay, particleWeights[k]); } //one draw, the K*'s weight
+            else { histos[Histo_InvMass_SameKProducts].Fill(invMassDecay); } //FILLING INVARIANT MASS BETWEEN PRODUCTS OF THE SAME K* HISTOGRAM
+        }
+    }
+    if(profile != nullptr) { profile->Count(Stage_HistogramFilling, (p2 - p) / 2); }
+}
+
+
+// An event on its way through the stages of a pipelined run: the stages pass each other the position of its slot
+struct EventGenerator::PipelineEvent
+{
+    int eventIndex = -1;
+    std::optional<RandomStream> rng; //the stream of the event, where the sampling left it, for the decays
+    EventBuffer particles; //on the heap, not in an arena: it keeps its capacity from one event to the next
+    int primariesNum = 0;
+    std::vector<double> particleWeights;
+    int nextWaitingSlot = -1; //while the event waits for its turn in the pair stage (see PipelineBlocks)
+};
+
+// Blocks of events of a pipelined run, with their histograms (see EventBlocks). The sampling stage fills the single particle
+// histograms of a block, the pair stage its invariant mass ones, in the order of its events as GenerateEvents() does, whatever
+// the order the decay threads pass them on in: an event that comes before its turn waits in its slot, in the list of its
+// block, and the thread that fills the event before it fills it next
+struct EventGenerator::PipelineBlocks
+{
+    struct Block
+    {
+        GenerationHistograms* histos = nullptr; //taken by the sampling stage before its first event
+        int nextEvent = 0; //next event whose pairs go into the histograms
+        bool isFilling = false; //a pair stage thread is filling the block
+        int waitingSlot = -1; //first slot of the list of the events waiting for their turn, in event order
+    };
+
+    EventBlocks const events;
+    BlockSum<GenerationHistograms> histos;
+    std::vector<Block> blocks;
+    std::mutex mutex; //guards the blocks
+
+    PipelineBlocks(int firstEvent, int lastEvent) :
+        events{firstEvent, lastEvent},
+        histos{events.getBlocksNum(), GenerationHistograms{}},
+        blocks(events.getBlocksNum())
+        {}
+};
+
+// Slots of the events of a pipelined run, and the queues between the stages; the slots the pair stage is done with go
+// back to the sampling one through freeEvents, so there are never more events in flight than slots
+struct EventGenerator::PipelineQueues
+{
+    static int const EndOfEvents = -1; //popped by a stage once the one before it has finished
+
+    std::vector<PipelineEvent> events;
+    BoundedQueue freeEvents;
+    BoundedQueue sampledEvents;
+    BoundedQueue decayedEvents;
+
+    PipelineQueues(int slotsNum, int queueDepth, int particlesPerEvent) :
+        events(slotsNum),
+        freeEvents{"free events", slotsNum},
+        sampledEvents{"sampling -> decay", queueDepth},
+        decayedEvents{"decay -> pair loop", queueDepth}
+    {
+        for(int i = 0; i < slotsNum; ++i)
+        {
+            events[i].particles.Reserve(particlesPerEvent);
+            freeEvents.Push(i);
+        }
+    }
+};
+
+// Generates the events [firstEvent, lastEvent) with the stages running at the same time on their own threads,
+// and adds them to 'histos'
+void EventGenerator::GeneratePipelinedBatch(int firstEvent, int lastEvent, GenerationHistograms& histos, EventStoreWriter* store)
+{
+    int const samplingThreadsNum = f_Config.samplingThreadsNum;
+    int const decayThreadsNum = f_Config.decayThreadsNum;
+    int const pairStageThreadsNum = f_Config.pairStageThreadsNum;
+
+    // Room for full queues plus an event in the hands of every thread
+    int const slotsNum = 2 * f_Config.queueDepth + samplingThreadsNum + decayThreadsNum + pairStageThreadsNum;
+    PipelineQueues queues{slotsNum, f_Config.queueDepth, f_Config.particlesPerEvent};
+
+    // The sampling threads fill the single particle histograms of the blocks, the pair stage threads the invariant mass ones
+    PipelineBlocks blocks{firstEvent, lastEvent};
+
+    WorkStealingScheduler scheduler{samplingThreadsNum, 0, blocks.events.getBlocksNum()};
+
+    // Profiles: the sampling threads first, then the decay ones, then the pair stage ones
+    if(f_Profiler != nullptr) { f_Profiler->Resize(samplingThreadsNum + decayThreadsNum + pairStageThreadsNum); }
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(0) : nullptr; //for the merge
+
+    std::vector<std::thread> samplingThreads;
+    std::vector<std::thread> decayThreads;
+    std::vector<std::thread> pairStageThreads;
+    for(int t = 0; t < samplingThreadsNum; ++t)
+    {
+        samplingThreads.emplace_back(&EventGenerator::SamplingStage, this, std::ref(queues), std::ref(blocks), std::ref(scheduler), t);
+    }
+    for(int t = 0; t < decayThreadsNum; ++t)
+    {
+        decayThreads.emplace_back(&EventGenerator::DecayStage, this, std::ref(queues), store, samplingThreadsNum + t);
+    }
+    for(int t = 0; t < pairStageThreadsNum; ++t)
+    {
+        pairStageThreads.emplace_back(&EventGenerator::PairStage, this, std::ref(queues), std::ref(blocks), samplingThreadsNum + decayThreadsNum + t);
+    }
+
+    // Once a stage has finished, every thread of the next one gets an end mark, after the last events
+    for(std::thread& thread : samplingThreads) { thread.join(); }
+    for(int t = 0; t < decayThreadsNum; ++t) { queues.sampledEvents.Push(PipelineQueues::EndOfEvents); }
+    for(std::thread& thread : decayThreads) { thread.join(); }
+    for(int t = 0; t < pairStageThreadsNum; ++t) { queues.decayedEvents.Push(PipelineQueues::EndOfEvents); }
+    for(std::thread& thread : pairStageThreads) { thread.join(); }
+
+    {
+        ScopedStageTimer timer{profile, Stage_HistogramFilling};
+        histos.Add(blocks.histos.getSum());
+    }
+
+    f_StealsNum += scheduler.getStealsNum();
+
+    QueueStats const batchStats[] = {queues.freeEvents.getStats(), queues.sampledEvents.getStats(), queues.decayedEvents.getStats()};
+    f_QueueStats.resize(3);
+    for(int q = 0; q < 3; ++q) { AddQueueStats(f_QueueStats[q], batchStats[q]); }
+}
+
+// First stage of a pipelined run: draws the blocks of events the scheduler gives to worker 'worker' and fills their single particle histograms
+void EventGenerator::SamplingStage(PipelineQueues& queues, PipelineBlocks& blocks, WorkStealingScheduler& scheduler, int worker) const
+{
+    std::vector<SampledValues> sampledValues;
+    sampledValues.reserve(f_Config.particlesPerEvent);
+
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(worker) : nullptr;
+    if(profile != nullptr) { profile->AttachHardwareCounters(); }
+
+    int firstBlock;
+    int lastBlock;
+    while(scheduler.NextChunk(worker, firstBlock, lastBlock))
+    {
+        for(int block = firstBlock; block < lastBlock; ++block)
+        {
+            GenerationHistograms* const histos = blocks.histos.Take();
+            {
+                std::lock_guard<std::mutex> lock{blocks.mutex};
+                blocks.blocks[block].histos = histos;
+                blocks.blocks[block].nextEvent = blocks.events.getFirstEvent(block);
+            }
+
+            for(int eventIndex = blocks.events.getFirstEvent(block); eventIndex < blocks.events.getLastEvent(block); ++eventIndex)
+            {
+                ShowProgress();
+
+                int const slot = queues.freeEvents.Pop();
+                PipelineEvent& event = queues.events[slot];
+
+                event.eventIndex = eventIndex;
+                event.rng.emplace(f_Config.seed, (std::uint64_t)eventIndex);
+                event.particles.Clear();
+                event.primariesNum = SampleEvent(*event.rng, event.particles, sampledValues, profile);
+                FillParticleHistograms(event.particles, sampledValues, *histos, profile);
+
+                queues.sampledEvents.Push(slot);
+            }
+        }
+    }
+
+    if(profile != nullptr) { profile->DetachHardwareCounters(); }
+}
+
+// Second stage: decays of the resonances, weights of the particles and event store
+void EventGenerator::DecayStage(PipelineQueues& queues, EventStoreWriter* store, int worker) const
+{
+    DecayBatch kaonStarDecay{MakeKaonStarChannel()}; //scratch arrays on the heap, kept from one event to the next
+    EventChunkBuilder storeChunk;
+
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(worker) : nullptr;
+    if(profile != nullptr) { profile->AttachHardwareCounters(); }
+
+    for(int slot = queues.sampledEvents.Pop(); slot != PipelineQueues::EndOfEvents; slot = queues.sampledEvents.Pop())
+    {
+        PipelineEvent& event = queues.events[slot];
+
+        DecayEvent(kaonStarDecay, event.particles, event.primariesNum, *event.rng, event.particleWeights, profile);
+        if(store != nullptr) { StoreEvent(event.eventIndex, event.particles, store, storeChunk, profile); }
+
+        queues.decayedEvents.Push(slot);
+    }
+
+    if(store != nullptr) //the last events, if they didn't fill a chunk
+    {
+        ScopedStageTimer timer{profile, Stage_EventStore};
+        store->WriteChunk(storeChunk.getView());
+    }
+
+    if(profile != nullptr) { profile->DetachHardwareCounters(); }
+}
+
+// Last stage: pair loop and invariant mass histograms, a block at a time in the order of its events (see PipelineBlocks);
+// the slot of an event is free again once its pairs are filled, and the histograms of a block are summed once all of its are
+void EventGenerator::PairStage(PipelineQueues& queues, PipelineBlocks& blocks, int worker) const
+{
+    TiledPairLoop pairLoop{f_PairCategories, f_Config.pairTileSize, f_Config.pairThreadsNum, f_PairHelpers.get(), &blocks.histos.getEmpty().getHistograms()[Histo_InvariantMass]};
+
+    ThreadProfile* const profile = (f_Profiler != nullptr) ? f_Profiler->getThreadProfile(worker) : nullptr;
+    if(profile != nullptr) { profile->AttachHardwareCounters(); }
+
+    for(int slot = queues.decayedEvents.Pop(); slot != PipelineQueues::EndOfEvents; slot = queues.decayedEvents.Pop())
+    {
+        int const eventIndex = queues.events[slot].eventIndex;
+        int const block = blocks.events.getBlock(eventIndex);
+        PipelineBlocks::Block& state = blocks.blocks[block];
+        {
+            std::lock_guard<std::mutex> lock{blocks.mutex};
+            if(state.isFilling || eventIndex != state.nextEvent) //not its turn yet: into the list of the block, in event order
+            {
+                int* link = &state.waitingSlot;
+                while(*link >= 0 && queues.events[*link].eventIndex < eventIndex) { link = &queues.events[*link].nextWaitingSlot; }
+                queues.events[slot].nextWaitingSlot = *link;
+                *link = slot;
+                continue;
+            }
+            state.isFilling = true;
+        }
+
+        // The event, then the ones of the list that come right after it
+        bool isBlockDone = false;
+        while(slot >= 0)
+        {
+            PipelineEvent& event = queues.events[slot];
+            FillPairHistograms(pairLoop, event.particles, event.primariesNum, event.particleWeights, *state.histos, profile);
+            queues.freeEvents.Push(slot);
+
+            std::lock_guard<std::mutex> lock{blocks.mutex};
+            ++state.nextEvent;
+            slot = state.waitingSlot;
+            if(slot >= 0 && queues.events[slot].eventIndex == state.nextEvent) { state.waitingSlot = queues.events[slot].nextWaitingSlot; }
+            else
+            {
+                slot = -1;
+                state.isFilling = false;
+                isBlockDone = state.nextEvent == blocks.events.getLastEvent(block);
+            }
+        }
+
+        if(isBlockDone)
+        {
+            ScopedStageTimer timer{profile, Stage_HistogramFilling};
+            blocks.histos.Add(block, state.histos);
+        }
+    }
+
+    if(profile != nullptr) { profile->DetachHardwareCounters(); }
+}
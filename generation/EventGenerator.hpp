@@ -0,0 +1,211 @@
+// Daniel Michelin
+
+#ifndef EVENTGENERATOR_HPP
+#define EVENTGENERATOR_HPP
+#include "GenerationHistograms.hpp"
+#include "PairCategoryTable.hpp"
+#include "AliasSampler.hpp"
+#include "EventStore.hpp"
+#include "RandomStream.hpp"
+#include "WorkStealingScheduler.hpp"
+#include "TiledPairLoop.hpp"
+#include "StageProfiler.hpp"
+#include "GaussianFit.hpp"
+#include "GenerationCheckpoint.hpp"
+#include "HistogramIO.hpp"
+#include "EventBuffer.hpp"
+#include "DecayBatch.hpp"
+#include "BoundedQueue.hpp"
+#include "BlockSum.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+//Adds the default types to the particle table; does nothing if the table isn't empty, so it can be called any number of times
+//Returns the number of types in the table
+int FillDefaultParticleTable();
+
+//Default abundancies of the generated particles; the same values are in ./generation/particleAbundancies.txt
+std::vector<SpeciesAbundance> DefaultAbundancies();
+
+
+//Distribution of the number of particles generated in an event
+enum MultiplicityModel
+{
+  Multiplicity_Fixed,           //always particlesPerEvent
+  Multiplicity_Poisson,         //Poisson with mean particlesPerEvent
+  Multiplicity_NegativeBinomial //negative binomial with mean particlesPerEvent and shape multiplicityShape:
+                                //variance = mean + mean^2/shape, i.e. wider than a Poisson, the more so the smaller the shape
+};
+
+//Parameters of a generation run
+struct GenerationConfig
+{
+  int eventsNum = 100000; //the most events generated, if targetPrecision is set; of all the shards together, if shardsNum > 1
+  int particlesPerEvent = 100; //mean, if the multiplicity isn't fixed
+  MultiplicityModel multiplicity = Multiplicity_Fixed;
+  double multiplicityShape = 1.; //only for Multiplicity_NegativeBinomial
+  int threadsNum = 1;
+  int pairTileSize = DefaultPairTileSize; //particles per side of the tiles of the pair loop (see TiledPairLoop.hpp)
+  int pairThreadsNum = 1; //threads sharing the pair loop of an event bigger than a tile: each generation thread, with pairThreadsNum - 1 helpers shared by all of them
+  bool pipelined = false; //the stages of the events run at the same time, each on its own threads (see below); threadsNum is then unused
+  int samplingThreadsNum = 1; //threads of every stage, if pipelined
+  int decayThreadsNum = 1;
+  int pairStageThreadsNum = 1; //each one sharing the pair loop of an event bigger than a tile with the pairThreadsNum - 1 helpers
+  int queueDepth = 64; //events that can wait between two stages, if pipelined
+  double resonanceEnhancement = 1.; //the resonances are drawn this many times more often, and every fill weighted back (see below)
+  double targetPrecision = 0.; //if > 0, the run stops once the K* fit reaches this relative error (see below); 0 = off
+  int batchEventsNum = 100000; //events between two fits, with targetPrecision, or two checkpoints, with checkpointFile
+  int shardIndex = 0; //this run only generates the shardIndex-th of shardsNum equal slices of the events (see below)
+  int shardsNum = 1;
+  std::uint64_t seed = 0; //0 = a new seed every run; the master seed of all the shards, if shardsNum > 1
+  bool showProgress = true; //live progress bar on std::cout
+  std::string eventStoreFile; //if not empty, every particle of every event is also written to this file (see EventStore.hpp)
+  std::string checkpointFile; //if not empty, the state of the run is written there after every batch (see GenerationCheckpoint.hpp)
+  std::string snapshotFile; //if not empty, the histograms so far are written there after every batch, for a live analysis (see below)
+};
+
+
+//The event generation, with no ROOT dependency: it fills a set of GenerationHistograms, which can then be written
+//by any output backend (see HistogramIO.hpp and, with ROOT, RootOutput.hpp).
+//The events are shared out between config.threadsNum threads by a work-stealing scheduler, so that the threads stay busy
+//even when the events have very different sizes. Every event draws from its own random stream,
+//RandomStream{seed, eventIndex}, and the events of a batch are cut into fixed blocks, each filling histograms of its own
+//in event order, which are added along a fixed tree over the blocks (see BlockSum.hpp): the histograms are the same to
+//the last bit with any number of threads, with or without the pipeline, whichever thread generates which event.
+//
+//With config.resonanceEnhancement = f > 1 the generation is importance sampled: the primary particles are drawn from
+//the abundancies with the probability of every resonance multiplied by f (and the whole table normalised again), so
+//that the rare K* and their decay products are f times as many, and every fill carries the weight p/q of what it
+//is made of, p being the true probability of the species and q the one it was drawn with: a particle weighs p/q of its
+//species, a decay product the weight of the particle that decayed, a pair the product of the weights of its particles,
+//or the weight of their mother alone for two products of the same decay. The weighted histograms estimate the same
+//distributions as the unweighted generation, and keep the sums of squared weights for their errors (see FastHistogram);
+//for the K* signal they get the statistical precision of about f times the events.
+//
+//With config.targetPrecision > 0 the events are generated in batches of config.batchEventsNum, and after every batch
+//the K* peak of the opposite minus same sign Pion-Kaon invariant mass is fitted with a Gaussian (see GaussianFit.hpp),
+//as the analysis macro does: the run stops as soon as the relative errors on both the mass and the width of the fit are
+//below the target, or after config.eventsNum events. Event i is the same whatever the batches, so the histograms are
+//exactly those of a run of getGeneratedEventsNum() events.
+//
+//With config.checkpointFile, the histograms and the index of the next event are written to that file after every batch
+//and at the end, so that a run that dies loses one batch at most: Resume() makes the next Run() go on from the
+//checkpoint, up to config.eventsNum events in all, and gives the same histograms as a run that had never stopped (the
+//same goes for extending a finished run to more events). setInitialHistograms() adds a run to the histograms of another
+//one, e.g. read from its output file: with a different seed, the events of the two are independent. The histograms
+//record the seed and events of every run (see GenerationRun), so a run can't be added to histograms that already have
+//its seed, which would count the same events twice.
+//The event store of a resumed run only gets the events that the run generates itself.
+//
+//With config.snapshotFile, the histograms generated so far are also written after every batch, as a complete output file
+//(by default a native one: setSnapshotWriter() picks the backend, e.g. WriteHistogramsToRoot), so that the analysis can
+//follow the run. Every snapshot is written to a temporary file renamed over the previous one, so a reader never finds
+//a file half written; the snapshot can be the output file of the run itself.
+//
+//With config.pipelined, every event goes through three stages, each with its own pool of threads, which hand the events
+//over through bounded lock-free queues (see BoundedQueue.hpp): sampling of the primary particles and their histograms,
+//decays of the resonances (and event store), then the pair loop with the invariant mass histograms. The cheap stages
+//prepare the next events while the O(N^2) pair loop works on the current ones, and each pool can be sized on its own,
+//e.g. one sampling and one decay thread for several pair stage threads. The events live in a fixed number of slots,
+//recycled once the pair stage is done with them, so memory doesn't grow when a stage falls behind: the stage before it
+//waits instead. getQueueStats() tells how full the queues were and how long the stages waited for each other.
+//Event i is drawn from the same stream as without the pipeline, so the histograms are the same.
+//
+//A run can also be one of config.shardsNum shards of a bigger one, e.g. on different machines: shard k generates the
+//events [k*eventsNum/shardsNum, (k+1)*eventsNum/shardsNum), with the random streams of the whole run, so with the same
+//(master) seed the shards are independent of each other and their histograms, added together (see main_HistogramMerge.cpp),
+//are the ones of the whole run generated at once.
+class EventGenerator
+{
+public:
+  EventGenerator(GenerationConfig const& config, AliasSampler const& sampler); //the particle table must already be filled
+
+  GenerationHistograms Run(); //generates all the events (or, with a target precision, enough of them) and returns the merged histograms
+
+  //The next Run() starts from the checkpoint, seed included; returns false, printing why, if it was written by a run that
+  //generated different events (multiplicity, abundancies, enhancement), in which case nothing changes
+  bool Resume(GenerationCheckpoint const& checkpoint);
+  //The next Run() adds its events to these histograms; returns false, printing why, if they already have a run with the
+  //seed of this one, in which case nothing changes
+  bool setInitialHistograms(GenerationHistograms const& histos);
+  GenerationCheckpoint MakeCheckpoint(GenerationHistograms const& histos, int nextEvent) const;
+
+  std::uint64_t getSeed() const; //the seed actually used, which is picked in the constructor when config.seed is 0
+  GenerationConfig const& getConfig() const;
+  int getStealsNum() const; //events ranges moved between threads by the scheduler in the last Run()
+  std::vector<QueueStats> const& getQueueStats() const; //of the queues of the last Run(), if pipelined: free slots, sampling -> decay, decay -> pair loop
+  void setProfiler(StageProfiler* profiler); //times the stages of the next runs, thread by thread; nullptr (the default) = no profiling
+  void setSnapshotWriter(HistogramFileWriter writer); //backend of the snapshots of config.snapshotFile; WriteHistograms by default
+
+  bool isWeighted() const; //whether the fills are weighted, i.e. config.resonanceEnhancement isn't 1
+  std::vector<double> const& getSpeciesWeights() const; //weight p/q of the primary particles of every species, by species ID
+
+  int getFirstEventNum() const; //index of the first event the next Run() generates: the first of the shard, unless it resumes a checkpoint
+  int getGeneratedEventsNum() const; //events in the histograms of the last Run(), including the ones of the checkpoint it resumed
+  int getNewEventsNum() const; //events generated by the last Run() itself
+  int getShardFirstEvent() const; //the events of the shard are [getShardFirstEvent(), getShardLastEvent())
+  int getShardLastEvent() const;
+  GaussianFitResult const& getKaonStarFit() const; //last fit of the K* peak, made only with a target precision
+  bool isTargetPrecisionReached() const; //whether the last fit reached config.targetPrecision
+
+  static GaussianFitResult FitKaonStarPeak(GenerationHistograms const& histos); //Gaussian fit of opposite - same sign Pion-Kaon
+
+  static int SampleMultiplicity(GenerationConfig const& config, RandomStream& rng); //number of particles of an event
+
+
+protected:
+
+
+private:
+  GenerationConfig f_Config;
+  AliasSampler const f_Sampler; //the one passed to the constructor, or its enhanced version
+  std::vector<double> f_SpeciesWeights;
+  PairCategoryTable const f_PairCategories;
+  int f_StealsNum;
+  StageProfiler* f_Profiler;
+  HistogramFileWriter f_SnapshotWriter;
+  int f_GeneratedEventsNum;
+  int f_ShardFirstEvent;
+  int f_ShardLastEvent;
+  int f_FirstEvent;
+  mutable std::atomic<int> f_StartedEventsNum; //events started so far by the threads of this generator; used by the progress bar
+  GenerationHistograms f_InitialHistos;
+  GaussianFitResult f_KaonStarFit;
+  int const f_KaonStarID; //left out of the pair loop
+  std::vector<QueueStats> f_QueueStats;
+  std::unique_ptr<PairHelperPool> f_PairHelpers; //started with the generator, if pairThreadsNum > 1
+
+  //Values of a primary particle that go into the histograms but aren't kept by the event buffer
+  struct SampledValues { double theta; double phi; double P; double PTransverse; };
+
+  struct EventBlocks;
+  struct PipelineEvent;
+  struct PipelineBlocks;
+  struct PipelineQueues;
+
+  static AliasSampler MakeEnhancedSampler(AliasSampler const& sampler, double enhancement);
+  static DecayChannel MakeKaonStarChannel();
+
+  GenerationRun MakeRun(int lastEvent) const; //the run that generated the events of the shard up to lastEvent (excluded)
+
+  void GenerateBatch(int firstEvent, int lastEvent, GenerationHistograms& histos, EventStoreWriter* store);
+  void GenerateEvents(EventBlocks const& blocks, BlockSum<GenerationHistograms>& blockHistos, EventStoreWriter* store, WorkStealingScheduler& scheduler, int worker) const;
+
+  //The steps of an event, shared by GenerateEvents() and the stages of a pipelined run
+  void ShowProgress() const;
+  int SampleEvent(RandomStream& rng, EventBuffer& particles, std::vector<SampledValues>& sampledValues, ThreadProfile* profile) const;
+  void FillParticleHistograms(EventBuffer const& particles, std::vector<SampledValues> const& sampledValues, GenerationHistograms& histos, ThreadProfile* profile) const;
+  void DecayEvent(DecayBatch& decay, EventBuffer& particles, int primariesNum, RandomStream& rng, std::vector<double>& particleWeights, ThreadProfile* profile) const;
+  void StoreEvent(int eventIndex, EventBuffer const& particles, EventStoreWriter* store, EventChunkBuilder& storeChunk, ThreadProfile* profile) const;
+  void FillPairHistograms(TiledPairLoop& pairLoop, EventBuffer const& particles, int primariesNum, std::vector<double> const& particleWeights, GenerationHistograms& histos, ThreadProfile* profile) const;
+
+  void GeneratePipelinedBatch(int firstEvent, int lastEvent, GenerationHistograms& histos, EventStoreWriter* store);
+  void SamplingStage(PipelineQueues& queues, PipelineBlocks& blocks, WorkStealingScheduler& scheduler, int worker) const;
+  void DecayStage(PipelineQueues& queues, EventStoreWriter* store, int worker) const;
+  void PairStage(PipelineQueues& queues, PipelineBlocks& blocks, int worker) const;
+};
+
+#endif
@@ -0,0 +1,411 @@
+// Daniel Michelin
+
+#include "EventStore.hpp"
+#include "Particle.hpp"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+
+//POSIX headers, for the memory mapping
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static char const EventStoreMagic[8] = {'G', 'A', 'S', 'E', 'V', 'T', 'S', '\0'};
+static std::uint32_t const ChunkMagic = 0x4B4E4843; //"CHNK"
+static std::uint64_t const ColumnAlignment = 64;
+
+// File header; the species table follows it, then padding up to headerBytes
+struct EventStoreHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerBytes; //where the first chunk starts
+    std::uint64_t seed;
+    std::uint32_t particlesPerEvent;
+    std::uint32_t speciesNum;
+    unsigned char padding[32];
+};
+
+// Chunk header; the columns follow it, each one padded to ColumnAlignment
+struct ChunkHeader
+{
+    std::uint32_t magic;
+    std::uint32_t eventsNum;
+    std::uint32_t particlesNum;
+    std::uint32_t reserved;
+    std::uint64_t firstEvent;
+    std::uint64_t chunkBytes; //header included
+    unsigned char padding[32];
+};
+
+static_assert(sizeof(EventStoreHeader) == ColumnAlignment && sizeof(ChunkHeader) == ColumnAlignment, "headers must keep the columns aligned");
+
+// Bytes taken by a column of 'bytes' bytes, padding included
+static std::uint64_t PaddedSize(std::uint64_t bytes)
+{
+    return (bytes + ColumnAlignment - 1) / ColumnAlignment * ColumnAlignment;
+}
+
+static std::uint64_t ChunkSize(std::uint64_t eventsNum, std::uint64_t particlesNum)
+{
+    return sizeof(ChunkHeader) + PaddedSize((eventsNum + 1) * sizeof(std::uint32_t)) + 3 * PaddedSize(particlesNum * sizeof(float))
+           + PaddedSize(particlesNum * sizeof(std::uint16_t)) + PaddedSize(particlesNum * sizeof(std::int32_t));
+}
+
+// Why the columns of a chunk read from file can't be used as they are; empty if they can. The event offsets must start
+// at 0, never decrease and end within the particles of the chunk; every species ID must be one of the 'speciesNum' of
+// the file, and every mother -1 or a particle before this one in its event
+static std::string CheckChunkColumns(EventChunkView const& chunk, int speciesNum)
+{
+    std::ostringstream error;
+    if(chunk.eventOffsets[0] != 0)
+    {
+        error << "the offsets of its events start at " << chunk.eventOffsets[0] << " instead of 0";
+        return error.str();
+    }
+    for(int e = 0; e < chunk.eventsNum; ++e)
+    {
+        if(chunk.eventOffsets[e+1] < chunk.eventOffsets[e])
+        {
+            error << "the offset of its event " << e+1 << " (" << chunk.eventOffsets[e+1] << ") is below the one of the event before (" << chunk.eventOffsets[e] << ')';
+            return error.str();
+        }
+    }
+    if(chunk.eventOffsets[chunk.eventsNum] > (std::uint32_t)chunk.particlesNum)
+    {
+        error << "the offsets of its events end at " << chunk.eventOffsets[chunk.eventsNum] << ", past its " << chunk.particlesNum << " particles";
+        return error.str();
+    }
+
+    for(int e = 0; e < chunk.eventsNum; ++e)
+    {
+        std::uint32_t const first = chunk.eventOffsets[e];
+        for(int i = 0; i < (int)(chunk.eventOffsets[e+1] - first); ++i)
+        {
+            if(chunk.speciesID[first + i] >= speciesNum)
+            {
+                error << "particle " << i << " of its event " << e << " has species " << chunk.speciesID[first + i] << ", but the file has " << speciesNum << " species";
+                return error.str();
+            }
+            if(chunk.mother[first + i] < -1 || chunk.mother[first + i] >= i)
+            {
+                error << "particle " << i << " of its event " << e << " has mother " << chunk.mother[first + i] << ", neither -1 nor a particle before it";
+                return error.str();
+            }
+        }
+    }
+    return "";
+}
+
+
+///////////////////////
+// EventChunkBuilder //
+
+EventChunkBuilder::EventChunkBuilder(int eventsPerChunk) :
+    f_EventsPerChunk{eventsPerChunk > 0 ? eventsPerChunk : 1},
+    f_FirstEvent{0},
+    f_EventOffsets(1, 0)
+    {}
+
+void EventChunkBuilder::AddEvent(std::uint64_t eventIndex, EventBuffer const& particles)
+{
+    if(isEmpty()) { f_FirstEvent = eventIndex; }
+
+    int const size = particles.getSize();
+    double const* px = particles.getPx();
+    double const* py = particles.getPy();
+    double const* pz = particles.getPz();
+    int const* speciesID = particles.getSpeciesID();
+    int const* mother = particles.getMother();
+
+    for(int i = 0; i < size; ++i)
+    {
+        f_Px.push_back((float)px[i]);
+        f_Py.push_back((float)py[i]);
+        f_Pz.push_back((float)pz[i]);
+        f_SpeciesID.push_back((std::uint16_t)speciesID[i]);
+        f_Mother.push_back(mother[i]);
+    }
+
+    f_EventOffsets.push_back(f_Px.size());
+}
+
+void EventChunkBuilder::Clear()
+{
+    f_EventOffsets.resize(1);
+    f_Px.clear();
+    f_Py.clear();
+    f_Pz.clear();
+    f_SpeciesID.clear();
+    f_Mother.clear();
+}
+
+bool EventChunkBuilder::isFull() const { return (int)f_EventOffsets.size() - 1 >= f_EventsPerChunk; }
+bool EventChunkBuilder::isEmpty() const { return f_EventOffsets.size() == 1; }
+bool EventChunkBuilder::isNextEvent(std::uint64_t eventIndex) const { return isEmpty() || eventIndex == f_FirstEvent + f_EventOffsets.size() - 1; }
+
+EventChunkView EventChunkBuilder::getView() const
+{
+    return EventChunkView{f_FirstEvent, (int)f_EventOffsets.size() - 1, (int)f_Px.size(), f_EventOffsets.data(),
+                          f_Px.data(), f_Py.data(), f_Pz.data(), f_SpeciesID.data(), f_Mother.data()};
+}
+
+
+//////////////////////
+// EventStoreWriter //
+
+// Writes 'bytes' bytes followed by zeros up to the next multiple of ColumnAlignment
+static void WritePadded(std::ofstream& file, void const* data, std::uint64_t bytes)
+{
+    static char const zeros[ColumnAlignment] = {};
+
+    file.write(static_cast<char const*>(data), bytes);
+    file.write(zeros, PaddedSize(bytes) - bytes);
+}
+
+EventStoreWriter::EventStoreWriter(std::string const& fileName, std::uint64_t seed, int particlesPerEvent, std::vector<double> const& speciesWeights) :
+    f_FileName(fileName),
+    f_File{fileName, std::ios::binary | std::ios::trunc}
+{
+    if(!f_File)
+    {
+        std::cout << "Cannot open \"" << fileName << "\" for writing\n";
+        return;
+    }
+
+    // Species table: name length, name, mass, charge, width, weight for every type
+    std::string species;
+    int const speciesNum = Particle::getNumParticleType();
+    for(int i = 0; i < speciesNum; ++i)
+    {
+        std::string const name = Particle::getParticleType(i);
+        std::uint32_t const nameLength = name.size();
+        double const mass = Particle::getParticleTypeMass(i);
+        std::int32_t const charge = Particle::getParticleTypeCharge(i);
+        double const width = Particle::getParticleTypeWidth(i);
+        double const weight = (i < (int)speciesWeights.size()) ? speciesWeights[i] : 1.;
+
+        species.append(reinterpret_cast<char const*>(&nameLength), sizeof(nameLength));
+        species.append(name);
+        species.append(reinterpret_cast<char const*>(&mass), sizeof(mass));
+        species.append(reinterpret_cast<char const*>(&charge), sizeof(charge));
+        species.append(reinterpret_cast<char const*>(&width), sizeof(width));
+        species.append(reinterpret_cast<char const*>(&weight), sizeof(weight));
+    }
+
+    EventStoreHeader header{};
+    std::memcpy(header.magic, EventStoreMagic, sizeof(header.magic));
+    header.version = EventStoreVersion;
+    header.headerBytes = sizeof(EventStoreHeader) + PaddedSize(species.size());
+    header.seed = seed;
+    header.particlesPerEvent = particlesPerEvent;
+    header.speciesNum = speciesNum;
+
+    f_File.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    WritePadded(f_File, species.data(), species.size());
+}
+
+bool EventStoreWriter::isOpen() const { return f_File.is_open(); }
+
+void EventStoreWriter::WriteChunk(EventChunkView const& chunk)
+{
+    if(chunk.eventsNum == 0) { return; }
+
+    ChunkHeader header{};
+    header.magic = ChunkMagic;
+    header.eventsNum = chunk.eventsNum;
+    header.particlesNum = chunk.particlesNum;
+    header.firstEvent = chunk.firstEvent;
+    header.chunkBytes = ChunkSize(chunk.eventsNum, chunk.particlesNum);
+
+    std::uint64_t const n = chunk.particlesNum;
+
+    std::lock_guard<std::mutex> lock{f_Mutex};
+
+    f_File.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    WritePadded(f_File, chunk.eventOffsets, (chunk.eventsNum + 1) * sizeof(std::uint32_t));
+    WritePadded(f_File, chunk.px, n * sizeof(float));
+    WritePadded(f_File, chunk.py, n * sizeof(float));
+    WritePadded(f_File, chunk.pz, n * sizeof(float));
+    WritePadded(f_File, chunk.speciesID, n * sizeof(std::uint16_t));
+    WritePadded(f_File, chunk.mother, n * sizeof(std::int32_t));
+}
+
+bool EventStoreWriter::Close()
+{
+    if(!f_File.is_open()) { return false; }
+
+    f_File.close();
+    if(f_File.fail())
+    {
+        std::cout << "Error while writing \"" << f_FileName << "\"\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+//////////////////////
+// EventStoreReader //
+
+EventStoreReader::EventStoreReader(std::string const& fileName) :
+    f_Data{nullptr},
+    f_Size{0},
+    f_Seed{0},
+    f_ParticlesPerEvent{0},
+    f_NumEvents{0},
+    f_NumParticles{0}
+{
+    int const fd = open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        std::cout << "Cannot open \"" << fileName << "\"\n";
+        return;
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(EventStoreHeader))
+    {
+        std::cout << "\"" << fileName << "\" is not an event store\n";
+        close(fd);
+        return;
+    }
+
+    void* const mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); //the mapping stays valid
+    if(mapped == MAP_FAILED)
+    {
+        std::cout << "Cannot map \"" << fileName << "\" in memory\n";
+        return;
+    }
+    madvise(mapped, fileStat.st_size, MADV_SEQUENTIAL);
+
+    f_Data = static_cast<unsigned char const*>(mapped);
+    f_Size = fileStat.st_size;
+
+    EventStoreHeader header;
+    std::memcpy(&header, f_Data, sizeof(header));
+    if(std::memcmp(header.magic, EventStoreMagic, sizeof(header.magic)) != 0 || header.version < 1 || header.version > EventStoreVersion
+       || header.headerBytes > f_Size)
+    {
+        std::cout << "\"" << fileName << "\" is not an event store of version 1 to " << EventStoreVersion << '\n';
+        munmap(mapped, f_Size);
+        f_Data = nullptr;
+        return;
+    }
+
+    f_Seed = header.seed;
+    f_ParticlesPerEvent = header.particlesPerEvent;
+
+    // Species table
+    std::uint64_t position = sizeof(EventStoreHeader);
+    for(std::uint32_t i = 0; i < header.speciesNum; ++i)
+    {
+        StoredSpecies species;
+        std::uint32_t nameLength;
+        std::int32_t charge;
+
+        if(position + sizeof(nameLength) > header.headerBytes) { break; }
+        std::memcpy(&nameLength, f_Data + position, sizeof(nameLength));
+        position += sizeof(nameLength);
+        if(position + nameLength > header.headerBytes) { break; }
+        species.name.assign(reinterpret_cast<char const*>(f_Data + position), nameLength);
+        position += nameLength;
+        if(position + 2*sizeof(double) + sizeof(charge) > header.headerBytes) { break; }
+        std::memcpy(&species.mass, f_Data + position, sizeof(double));
+        position += sizeof(double);
+        std::memcpy(&charge, f_Data + position, sizeof(charge));
+        position += sizeof(charge);
+        std::memcpy(&species.width, f_Data + position, sizeof(double));
+        position += sizeof(double);
+        species.charge = charge;
+        species.weight = 1.;
+        if(header.version >= 2)
+        {
+            if(position + sizeof(double) > header.headerBytes) { break; }
+            std::memcpy(&species.weight, f_Data + position, sizeof(double));
+            position += sizeof(double);
+        }
+
+        f_Species.push_back(species);
+    }
+
+    // Chunks, one after the other; a chunk cut short (e.g. by a generation that didn't finish) ends the file
+    position = header.headerBytes;
+    while(position + sizeof(ChunkHeader) <= f_Size)
+    {
+        ChunkHeader chunkHeader;
+        std::memcpy(&chunkHeader, f_Data + position, sizeof(chunkHeader));
+
+        if(chunkHeader.magic != ChunkMagic || chunkHeader.chunkBytes != ChunkSize(chunkHeader.eventsNum, chunkHeader.particlesNum)
+           || position + chunkHeader.chunkBytes > f_Size)
+        {
+            std::cout << "\"" << fileName << "\" is truncated: reading only its first " << f_NumEvents << " events\n";
+            break;
+        }
+
+        std::uint64_t const n = chunkHeader.particlesNum;
+        unsigned char const* column = f_Data + position + sizeof(ChunkHeader);
+
+        EventChunkView chunk;
+        chunk.firstEvent = chunkHeader.firstEvent;
+        chunk.eventsNum = chunkHeader.eventsNum;
+        chunk.particlesNum = chunkHeader.particlesNum;
+        chunk.eventOffsets = reinterpret_cast<std::uint32_t const*>(column);
+        column += PaddedSize((chunkHeader.eventsNum + 1) * sizeof(std::uint32_t));
+        chunk.px = reinterpret_cast<float const*>(column);
+        column += PaddedSize(n * sizeof(float));
+        chunk.py = reinterpret_cast<float const*>(column);
+        column += PaddedSize(n * sizeof(float));
+        chunk.pz = reinterpret_cast<float const*>(column);
+        column += PaddedSize(n * sizeof(float));
+        chunk.speciesID = reinterpret_cast<std::uint16_t const*>(column);
+        column += PaddedSize(n * sizeof(std::uint16_t));
+        chunk.mother = reinterpret_cast<std::int32_t const*>(column);
+
+        // Unlike a truncated file, whose whole chunks can still be read, a chunk whose offsets, species or mothers point
+        // outside its columns or the species table would make the readers go past them: the file is corrupt, and rejected as a whole
+        std::string const columnsError = CheckChunkColumns(chunk, f_Species.size());
+        if(!columnsError.empty())
+        {
+            munmap(mapped, f_Size);
+            f_Data = nullptr;
+            throw std::runtime_error{"\"" + fileName + "\" is corrupt: in the chunk of the events from " + std::to_string(chunk.firstEvent)
+                                     + ", " + columnsError};
+        }
+
+        f_Chunks.push_back(chunk);
+        f_NumEvents += chunk.eventsNum;
+        f_NumParticles += n;
+        position += chunkHeader.chunkBytes;
+    }
+}
+
+EventStoreReader::~EventStoreReader()
+{
+    if(f_Data != nullptr) { munmap(const_cast<unsigned char*>(f_Data), f_Size); }
+}
+
+bool EventStoreReader::isOpen() const { return f_Data != nullptr; }
+std::uint64_t EventStoreReader::getSeed() const { return f_Seed; }
+int EventStoreReader::getParticlesPerEvent() const { return f_ParticlesPerEvent; }
+std::vector<StoredSpecies> const& EventStoreReader::getSpecies() const { return f_Species; }
+
+bool EventStoreReader::isWeighted() const
+{
+    for(StoredSpecies const& species : f_Species)
+    {
+        if(species.weight != 1.) { return true; }
+    }
+    return false;
+}
+
+int EventStoreReader::getNumChunks() const { return f_Chunks.size(); }
+std::uint64_t EventStoreReader::getNumEvents() const { return f_NumEvents; }
+std::uint64_t EventStoreReader::getNumParticles() const { return f_NumParticles; }
+EventChunkView EventStoreReader::getChunk(int i) const { return f_Chunks[i]; }
@@ -0,0 +1,147 @@
+// Daniel Michelin
+
+#ifndef EVENTSTORE_HPP
+#define EVENTSTORE_HPP
+#include "EventBuffer.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fstream>
+
+//Event store: every generated particle, event by event, so that new cuts and binnings don't need a new generation.
+//The file is a header followed by chunks of consecutive events; each chunk holds one column per quantity:
+// event offsets (uint32, events + 1 of them: the particles of event e are [offsets[e], offsets[e+1]) in the chunk)
+// px, py, pz (float), species ID (uint16, index in the particle table), mother (int32, position in the event
+// of the particle that decayed into this one, -1 for the particles that don't come from a decay).
+//The energy isn't stored: it follows from the mass of the species and the impulse.
+//The species table of the header gives, for every species, the weight of its primary particles, 1 unless the generation
+//was importance sampled (see GenerationConfig::resonanceEnhancement); version 1 files have no weights, read as 1.
+//Every column starts at a multiple of 64 bytes from the start of the file, so the reader can map the file in memory
+//and hand out the columns as they are, without copying or decoding anything.
+//Numbers are written in the byte order of the machine that generated the file.
+
+std::uint32_t const EventStoreVersion = 2;
+int const DefaultEventsPerChunk = 1024;
+
+//One species of the particle table, as it was when the file was written
+struct StoredSpecies
+{
+  std::string name;
+  double mass;
+  int charge;
+  double width;
+  double weight; //of the primary particles of this species; decay products weigh what their mother weighs
+};
+
+//Columns of one chunk; in a chunk read from file they point straight into the mapped file
+struct EventChunkView
+{
+  std::uint64_t firstEvent; //index of the first event of the chunk in the generation
+  int eventsNum;
+  int particlesNum;
+  std::uint32_t const* eventOffsets;
+  float const* px;
+  float const* py;
+  float const* pz;
+  std::uint16_t const* speciesID;
+  std::int32_t const* mother;
+};
+
+
+//Collects the particles of consecutive events into the columns of a chunk; every generation thread has its own
+class EventChunkBuilder
+{
+public:
+  EventChunkBuilder(int eventsPerChunk = DefaultEventsPerChunk);
+
+  void AddEvent(std::uint64_t eventIndex, EventBuffer const& particles); //events must come in consecutive order
+  void Clear(); //empties the chunk, keeping the memory
+  bool isFull() const;
+  bool isEmpty() const;
+  bool isNextEvent(std::uint64_t eventIndex) const; //whether the event can be added, i.e. it follows the last one
+
+  EventChunkView getView() const;
+
+
+protected:
+
+
+private:
+  int f_EventsPerChunk;
+  std::uint64_t f_FirstEvent;
+
+  std::vector<std::uint32_t> f_EventOffsets;
+  std::vector<float> f_Px;
+  std::vector<float> f_Py;
+  std::vector<float> f_Pz;
+  std::vector<std::uint16_t> f_SpeciesID;
+  std::vector<std::int32_t> f_Mother;
+};
+
+
+//Writes the chunks to file; WriteChunk() can be called from several threads at once
+//The chunks are written in the order they come, which with more threads isn't the order of the events:
+//every chunk knows the index of its first event, so the reader doesn't need them in order
+class EventStoreWriter
+{
+public:
+  //Writes the header, with the current particle table and the weights of its species by ID (all 1 if speciesWeights is empty)
+  EventStoreWriter(std::string const& fileName, std::uint64_t seed, int particlesPerEvent, std::vector<double> const& speciesWeights = {});
+
+  bool isOpen() const;
+  void WriteChunk(EventChunkView const& chunk);
+  bool Close(); //returns false if anything couldn't be written
+
+
+protected:
+
+
+private:
+  std::string f_FileName;
+  std::ofstream f_File;
+  std::mutex f_Mutex;
+};
+
+
+//Maps an event store in memory (read only) and gives the chunks as views into it
+class EventStoreReader
+{
+public:
+  //Check isOpen() before using it. Throws std::runtime_error if a chunk is corrupt, i.e. its event offsets don't fit its
+  //columns, a species ID isn't in the species table or a mother isn't -1 or a particle before its daughter in the event
+  //(a file cut short is read up to its last whole chunk instead)
+  EventStoreReader(std::string const& fileName);
+  ~EventStoreReader();
+
+  EventStoreReader(EventStoreReader const&) = delete;
+  EventStoreReader& operator=(EventStoreReader const&) = delete;
+
+  bool isOpen() const;
+  std::uint64_t getSeed() const;
+  int getParticlesPerEvent() const;
+  std::vector<StoredSpecies> const& getSpecies() const;
+  bool isWeighted() const; //whether any species weighs other than 1
+
+  int getNumChunks() const;
+  std::uint64_t getNumEvents() const;
+  std::uint64_t getNumParticles() const;
+  EventChunkView getChunk(int i) const;
+
+
+protected:
+
+
+private:
+  unsigned char const* f_Data; //the mapped file
+  std::uint64_t f_Size;
+
+  std::uint64_t f_Seed;
+  int f_ParticlesPerEvent;
+  std::vector<StoredSpecies> f_Species;
+  std::vector<EventChunkView> f_Chunks;
+  std::uint64_t f_NumEvents;
+  std::uint64_t f_NumParticles;
+};
+
+#endif
@@ -0,0 +1,156 @@
+// Daniel Michelin
+
+#include "FastHistogram.hpp"
+#include <cmath>
+
+
+FastHistogram::FastHistogram(int nbins, double xmin, double xmax) :
+    f_Nbins{nbins},
+    f_Xmin{xmin},
+    f_Xmax{xmax},
+    f_Scale{nbins / (xmax - xmin)},
+    f_Bins(nbins + 2, 0.),
+    f_Entries{0.},
+    f_Stats{0., 0., 0., 0.}
+    {}
+
+int FastHistogram::FindBin(double x) const
+{
+    if(x < f_Xmin) { return 0; }
+    if(!(x < f_Xmax)) { return f_Nbins + 1; }
+
+    double const position = (x - f_Xmin) * f_Scale;
+
+    // ROOT divides instead: 1 + int(nbins*(x-xmin)/(xmax-xmin)). The two can only disagree when x is within
+    // a couple of ulp from a bin edge, in which case the division is done too, so the bins are always the same
+    double const fraction = position - floor(position);
+    if(fraction < 1e-9 || fraction > 1. - 1e-9)
+    {
+        return 1 + (int)(f_Nbins * (x - f_Xmin) / (f_Xmax - f_Xmin));
+    }
+
+    return 1 + (int)position;
+}
+
+void FastHistogram::Fill(double x)
+{
+    int const bin = FindBin(x);
+
+    ++f_Entries;
+    f_Bins[bin] += 1.;
+    if(!f_Sumw2.empty()) { f_Sumw2[bin] += 1.; } //after weighted fills, as a fill of weight 1
+
+    if(bin > 0 && bin <= f_Nbins) //under/overflows don't enter the statistics, as in ROOT by default
+    {
+        f_Stats[0] += 1.;
+        f_Stats[1] += 1.;
+        f_Stats[2] += x;
+        f_Stats[3] += x*x;
+    }
+}
+
+void FastHistogram::Fill(double x, double weight)
+{
+    int const bin = FindBin(x);
+
+    if(f_Sumw2.empty()) { Sumw2(); }
+
+    ++f_Entries;
+    f_Bins[bin] += weight;
+    f_Sumw2[bin] += weight*weight;
+
+    if(bin > 0 && bin <= f_Nbins)
+    {
+        f_Stats[0] += weight;
+        f_Stats[1] += weight*weight;
+        f_Stats[2] += weight*x;
+        f_Stats[3] += weight*x*x;
+    }
+}
+
+void FastHistogram::FillBin(int bin)
+{
+    ++f_Entries;
+    f_Bins[bin] += 1.;
+    if(!f_Sumw2.empty()) { f_Sumw2[bin] += 1.; }
+
+    if(bin > 0 && bin <= f_Nbins)
+    {
+        f_Stats[0] += 1.;
+        f_Stats[1] += 1.;
+    }
+}
+
+void FastHistogram::FillBin(int bin, double weight)
+{
+    if(f_Sumw2.empty()) { Sumw2(); }
+
+    ++f_Entries;
+    f_Bins[bin] += weight;
+    f_Sumw2[bin] += weight*weight;
+
+    if(bin > 0 && bin <= f_Nbins)
+    {
+        f_Stats[0] += weight;
+        f_Stats[1] += weight*weight;
+    }
+}
+
+void FastHistogram::Add(FastHistogram const& other)
+{
+    if(other.hasSumw2() && !hasSumw2()) { Sumw2(); }
+    if(hasSumw2())
+    {
+        for(int bin = 0; bin < f_Nbins + 2; ++bin) { f_Sumw2[bin] += other.getBinSumw2(bin); }
+    }
+
+    for(int bin = 0; bin < f_Nbins + 2; ++bin)
+    {
+        f_Bins[bin] += other.f_Bins[bin];
+    }
+
+    f_Entries += other.f_Entries;
+    for(int i = 0; i < 4; ++i) { f_Stats[i] += other.f_Stats[i]; }
+}
+
+void FastHistogram::Reset()
+{
+    f_Bins.assign(f_Nbins + 2, 0.);
+    if(hasSumw2()) { f_Sumw2.assign(f_Nbins + 2, 0.); }
+    f_Entries = 0.;
+    for(int i = 0; i < 4; ++i) { f_Stats[i] = 0.; }
+}
+
+void FastHistogram::Sumw2()
+{
+    if(hasSumw2()) { return; }
+    f_Sumw2 = f_Bins; //every fill so far had weight 1
+}
+
+int FastHistogram::getNbins() const { return f_Nbins; }
+double FastHistogram::getXmin() const { return f_Xmin; }
+double FastHistogram::getXmax() const { return f_Xmax; }
+double FastHistogram::getBinContent(int bin) const { return f_Bins[bin]; }
+bool FastHistogram::hasSumw2() const { return !f_Sumw2.empty(); }
+double FastHistogram::getBinSumw2(int bin) const { return hasSumw2() ? f_Sumw2[bin] : f_Bins[bin]; }
+double FastHistogram::getBinError(int bin) const { return sqrt(getBinSumw2(bin)); }
+double FastHistogram::getEntries() const { return f_Entries; }
+
+void FastHistogram::getStats(double* stats) const
+{
+    for(int i = 0; i < 4; ++i) { stats[i] = f_Stats[i]; }
+}
+
+void FastHistogram::setBinContent(int bin, double content) { f_Bins[bin] = content; }
+void FastHistogram::setEntries(double entries) { f_Entries = entries; }
+
+void FastHistogram::setBinSumw2(int bin, double sumw2)
+{
+    Sumw2();
+    f_Sumw2[bin] = sumw2;
+}
+
+void FastHistogram::putStats(double const* stats)
+{
+    for(int i = 0; i < 4; ++i) { f_Stats[i] = stats[i]; }
+}
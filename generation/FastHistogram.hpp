@@ -0,0 +1,62 @@
+// Daniel Michelin
+
+#ifndef FASTHISTOGRAM_HPP
+#define FASTHISTOGRAM_HPP
+#include <vector>
+
+//Fixed binning 1D histogram for the generation loop.
+//Bins are numbered as in ROOT: 0 is the underflow, 1..nbins the regular bins, nbins+1 the overflow.
+//Filling costs a multiplication to find the bin and a few additions for the statistics: no axis search,
+//no label search, no virtual calls. It isn't thread-safe: every thread fills its own copy (a shard),
+//and the shards are added together with Add() at the end.
+//The contents and statistics follow TH1::Fill() to the letter, so the TH1F made from it (see CopyToTH1F() in
+//RootOutput.hpp) equals the one that filling a TH1F directly would give, up to float rounding of the final contents:
+//here they add up in double and are rounded to float once, where a TH1F rounds them at every fill.
+//Weighted fills work as in ROOT too: the entries count the fills, the contents and statistics add up the weights, and
+//the first weighted fill switches on the sum of squared weights of every bin (Sumw2()), which gives the bin errors.
+class FastHistogram
+{
+public:
+  FastHistogram(int nbins, double xmin, double xmax); //parametric constructor
+
+  int FindBin(double x) const; //same bin as TAxis::FindFixBin()
+  void Fill(double x);
+  void Fill(double x, double weight);
+  void FillBin(int bin); //as TH1::Fill(const char* label) for the bin with that label: the bin centre doesn't enter the mean
+  void FillBin(int bin, double weight);
+  void Add(FastHistogram const& other); //other must have the same binning
+  void Reset(); //keeps Sumw2() on, as ROOT does
+  void Sumw2(); //keeps the sums of squared weights from now on; the bins filled so far count as filled with weight 1
+
+  int getNbins() const;
+  double getXmin() const;
+  double getXmax() const;
+  double getBinContent(int bin) const;
+  bool hasSumw2() const;
+  double getBinSumw2(int bin) const; //sum of the squared weights; the content itself without Sumw2(), as for unweighted fills
+  double getBinError(int bin) const; //sqrt(getBinSumw2(bin))
+  double getEntries() const;
+  void getStats(double* stats) const; //sum of weights, of squared weights, of weight*x and of weight*x^2, as TH1::GetStats()
+
+  //Used to restore a histogram that has been written to file; as in ROOT, setBinContent() doesn't touch entries and statistics
+  void setBinContent(int bin, double content);
+  void setBinSumw2(int bin, double sumw2); //switches Sumw2() on
+  void setEntries(double entries);
+  void putStats(double const* stats);
+
+
+protected:
+
+
+private:
+  int f_Nbins;
+  double f_Xmin;
+  double f_Xmax;
+  double f_Scale; //nbins / (xmax - xmin)
+  std::vector<double> f_Bins; //nbins + 2 elements; counted in double, so they stay exact beyond 2^24 entries per bin
+  std::vector<double> f_Sumw2; //empty until Sumw2(), then nbins + 2 elements
+  double f_Entries;
+  double f_Stats[4];
+};
+
+#endif
@@ -0,0 +1,189 @@
+// Daniel Michelin
+
+#include "GaussianFit.hpp"
+#include <vector>
+#include <utility>
+#include <cmath>
+
+
+// One bin entering the fit
+struct FitPoint
+{
+    double x;
+    double y;
+    double weight; //1/error^2
+};
+
+// Chi-square of the parameters {constant, mean, sigma}; with 'hessian' and 'gradient', also J^T W J and J^T W r
+static double ChiSquare(std::vector<FitPoint> const& points, double const* parameters, double (*hessian)[3] = nullptr, double* gradient = nullptr)
+{
+    if(hessian != nullptr)
+    {
+        for(int a = 0; a < 3; ++a)
+        {
+            gradient[a] = 0.;
+            for(int b = 0; b < 3; ++b) { hessian[a][b] = 0.; }
+        }
+    }
+
+    double chi2 = 0.;
+    for(FitPoint const& point : points)
+    {
+        double const t = (point.x - parameters[1]) / parameters[2];
+        double const exponential = exp(-0.5 * t*t);
+        double const model = parameters[0] * exponential;
+        double const residual = point.y - model;
+        chi2 += point.weight * residual*residual;
+
+        if(hessian != nullptr)
+        {
+            double const derivatives[3] = {exponential, model * t / parameters[2], model * t*t / parameters[2]};
+            for(int a = 0; a < 3; ++a)
+            {
+                gradient[a] += point.weight * derivatives[a] * residual;
+                for(int b = 0; b < 3; ++b) { hessian[a][b] += point.weight * derivatives[a] * derivatives[b]; }
+            }
+        }
+    }
+
+    return chi2;
+}
+
+// Solves matrix * x = vector by Gaussian elimination; returns false if the matrix is singular
+static bool Solve3(double const (*matrix)[3], double const* vector, double* x)
+{
+    double m[3][4];
+    for(int a = 0; a < 3; ++a)
+    {
+        for(int b = 0; b < 3; ++b) { m[a][b] = matrix[a][b]; }
+        m[a][3] = vector[a];
+    }
+
+    for(int column = 0; column < 3; ++column)
+    {
+        int pivot = column;
+        for(int row = column + 1; row < 3; ++row)
+        {
+            if(std::fabs(m[row][column]) > std::fabs(m[pivot][column])) { pivot = row; }
+        }
+        if(!(std::fabs(m[pivot][column]) > 0.)) { return false; }
+
+        for(int b = 0; b < 4; ++b) { std::swap(m[column][b], m[pivot][b]); }
+        for(int row = column + 1; row < 3; ++row)
+        {
+            double const factor = m[row][column] / m[column][column];
+            for(int b = column; b < 4; ++b) { m[row][b] -= factor * m[column][b]; }
+        }
+    }
+
+    for(int row = 2; row >= 0; --row)
+    {
+        double sum = m[row][3];
+        for(int b = row + 1; b < 3; ++b) { sum -= m[row][b] * x[b]; }
+        x[row] = sum / m[row][row];
+    }
+
+    return true;
+}
+
+
+GaussianFitResult FitGaussian(FastHistogram const& histo, FastHistogram const* subtracted, double xmin, double xmax)
+{
+    GaussianFitResult result;
+
+    int const nbins = histo.getNbins();
+    double const binWidth = (histo.getXmax() - histo.getXmin()) / nbins;
+
+    // The bins in range, with their errors; the empty ones are left out, as TH1::Fit() does
+    std::vector<FitPoint> points;
+    int maxPoint = -1;
+    for(int bin = 1; bin <= nbins; ++bin)
+    {
+        double const x = histo.getXmin() + (bin - 0.5) * binWidth;
+        if(x < xmin || x > xmax) { continue; }
+
+        double y = histo.getBinContent(bin);
+        double variance = histo.getBinSumw2(bin);
+        if(subtracted != nullptr)
+        {
+            y -= subtracted->getBinContent(bin);
+            variance += subtracted->getBinSumw2(bin);
+        }
+        if(!(variance > 0.)) { continue; }
+
+        points.push_back(FitPoint{x, y, 1. / variance});
+        if(maxPoint < 0 || y > points[maxPoint].y) { maxPoint = points.size() - 1; }
+    }
+
+    if((int)points.size() <= 3 || !(points[maxPoint].y > 0.)) { return result; }
+
+    // Starting values: the highest bin, and the width of the peak at half its height
+    double const peak = points[maxPoint].y;
+    int left = maxPoint;
+    int right = maxPoint;
+    while(left > 0 && points[left - 1].y > 0.5 * peak) { --left; }
+    while(right < (int)points.size() - 1 && points[right + 1].y > 0.5 * peak) { ++right; }
+    double const halfWidth = 0.5 * (points[right].x - points[left].x) + 0.5 * binWidth;
+
+    double parameters[3] = {peak, points[maxPoint].x, halfWidth / 1.1774}; //FWHM = 2.3548 sigma
+
+    // Levenberg-Marquardt: Gauss-Newton steps, damped towards gradient descent while they don't lower the chi-square
+    double hessian[3][3];
+    double gradient[3];
+    double chi2 = ChiSquare(points, parameters, hessian, gradient);
+    double lambda = 1e-3;
+    bool isConverged = false;
+
+    for(int iteration = 0; iteration < 200 && !isConverged; ++iteration)
+    {
+        double damped[3][3];
+        for(int a = 0; a < 3; ++a)
+        {
+            for(int b = 0; b < 3; ++b) { damped[a][b] = hessian[a][b]; }
+            damped[a][a] *= 1. + lambda;
+        }
+
+        double step[3];
+        if(!Solve3(damped, gradient, step)) { return result; }
+
+        double const trial[3] = {parameters[0] + step[0], parameters[1] + step[1], parameters[2] + step[2]};
+        double const trialChi2 = (trial[2] != 0.) ? ChiSquare(points, trial) : chi2 + 1.;
+
+        if(trialChi2 <= chi2)
+        {
+            isConverged = chi2 - trialChi2 < 1e-9 * (1. + chi2);
+            for(int a = 0; a < 3; ++a) { parameters[a] = trial[a]; }
+            chi2 = ChiSquare(points, parameters, hessian, gradient);
+            lambda = (lambda > 1e-12) ? 0.1 * lambda : lambda;
+        }
+        else
+        {
+            lambda *= 10.;
+            isConverged = lambda > 1e12; //no step lowers the chi-square any more: this is the minimum
+        }
+    }
+
+    // Covariance matrix: the inverse of J^T W J at the minimum
+    double covariance[3][3];
+    for(int a = 0; a < 3; ++a)
+    {
+        double unit[3] = {0., 0., 0.};
+        unit[a] = 1.;
+        double column[3];
+        if(!Solve3(hessian, unit, column)) { return result; }
+        for(int b = 0; b < 3; ++b) { covariance[b][a] = column[b]; }
+    }
+
+    result.constant = parameters[0];
+    result.mean = parameters[1];
+    result.sigma = std::fabs(parameters[2]); //the model only depends on sigma^2
+    result.constantError = sqrt(covariance[0][0]);
+    result.meanError = sqrt(covariance[1][1]);
+    result.sigmaError = sqrt(covariance[2][2]);
+    result.chi2 = chi2;
+    result.ndf = points.size() - 3;
+    result.isValid = isConverged && result.constant > 0. && result.mean >= points.front().x && result.mean <= points.back().x
+                     && std::isfinite(result.meanError) && std::isfinite(result.sigmaError) && result.sigmaError > 0.;
+
+    return result;
+}
@@ -0,0 +1,32 @@
+// Daniel Michelin
+
+#ifndef GAUSSIANFIT_HPP
+#define GAUSSIANFIT_HPP
+#include "FastHistogram.hpp"
+#include <limits>
+
+//Gaussian fit of a FastHistogram, without ROOT, for checks made while the events are being generated.
+//It's the chi-square fit of "gaus" that TH1::Fit() does: constant * exp(-(x - mean)^2 / (2 sigma^2)) fitted to the bin
+//contents, each with the error sqrt(sum of squared weights), empty bins left out, minimised with Levenberg-Marquardt;
+//the errors of the parameters come from the covariance matrix at the minimum, as Minuit gives them.
+//A fit takes a few microseconds on the 80 bins of the invariant mass histograms.
+
+struct GaussianFitResult
+{
+  bool isValid = false; //false if the fit didn't converge to a peak inside the range, e.g. with too few events
+  double constant = 0.;
+  double mean = 0.;
+  double sigma = 0.;
+  double constantError = 0.;
+  double meanError = 0.;
+  double sigmaError = 0.;
+  double chi2 = 0.;
+  int ndf = 0;
+};
+
+//Fits the bins of 'histo' whose centres are in [xmin, xmax]; with 'subtracted', the difference histo - subtracted, with
+//the errors of both (as TH1::Add(histo, subtracted, 1, -1) after Sumw2()). 'subtracted' must have the same binning.
+GaussianFitResult FitGaussian(FastHistogram const& histo, FastHistogram const* subtracted = nullptr,
+                              double xmin = -std::numeric_limits<double>::infinity(), double xmax = std::numeric_limits<double>::infinity());
+
+#endif
@@ -0,0 +1,130 @@
+// Daniel Michelin
+
+#include "GenerationCheckpoint.hpp"
+#include "HistogramIO.hpp"
+#include <cstdio> //std::rename()
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+static char const CheckpointFileMagic[8] = {'G', 'A', 'S', 'C', 'K', 'P', 'T', '\0'};
+
+template <typename T>
+static void WriteValue(std::ofstream& file, T const value)
+{
+    file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool ReadValue(std::ifstream& file, T& value)
+{
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+
+bool WriteCheckpoint(std::string const& fileName, GenerationCheckpoint const& checkpoint)
+{
+    std::string const temporaryName = fileName + ".tmp";
+
+    {
+        std::ofstream file{temporaryName, std::ios::binary | std::ios::trunc};
+        if(!file)
+        {
+            std::cout << "Cannot open \"" << temporaryName << "\" for writing\n";
+            return false;
+        }
+
+        file.write(CheckpointFileMagic, sizeof(CheckpointFileMagic));
+        WriteValue<std::uint32_t>(file, CheckpointFileVersion);
+        WriteValue<std::uint64_t>(file, checkpoint.seed);
+        WriteValue<std::int64_t>(file, checkpoint.firstEvent);
+        WriteValue<std::int64_t>(file, checkpoint.nextEvent);
+        WriteValue<std::int32_t>(file, checkpoint.particlesPerEvent);
+        WriteValue<std::int32_t>(file, checkpoint.multiplicity);
+        WriteValue<double>(file, checkpoint.multiplicityShape);
+        WriteValue<double>(file, checkpoint.resonanceEnhancement);
+
+        WriteValue<std::uint32_t>(file, checkpoint.abundancies.size());
+        for(SpeciesAbundance const& abundance : checkpoint.abundancies)
+        {
+            WriteValue<std::int32_t>(file, abundance.speciesID);
+            WriteValue<double>(file, abundance.probability);
+        }
+
+        WriteHistograms(file, GetHistogramDefinitions(), checkpoint.histos.getHistograms(), checkpoint.histos.getRuns());
+
+        file.close();
+        if(!file)
+        {
+            std::cout << "Error while writing \"" << temporaryName << "\"\n";
+            std::remove(temporaryName.c_str());
+            return false;
+        }
+    }
+
+    if(std::rename(temporaryName.c_str(), fileName.c_str()) != 0)
+    {
+        std::cout << "Cannot rename \"" << temporaryName << "\" to \"" << fileName << "\"\n";
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool ReadCheckpoint(std::string const& fileName, GenerationCheckpoint& checkpoint)
+{
+    std::ifstream file{fileName, std::ios::binary};
+    if(!file)
+    {
+        std::cout << "Cannot open \"" << fileName << "\"\n";
+        return false;
+    }
+
+    char magic[sizeof(CheckpointFileMagic)];
+    std::uint32_t version;
+    if(!file.read(magic, sizeof(magic)) || std::memcmp(magic, CheckpointFileMagic, sizeof(magic)) != 0 || !ReadValue(file, version))
+    {
+        std::cout << "\"" << fileName << "\" is not a checkpoint file\n";
+        return false;
+    }
+    if(version < 1 || version > CheckpointFileVersion)
+    {
+        std::cout << "\"" << fileName << "\" has format version " << version << ", expected at most " << CheckpointFileVersion << '\n';
+        return false;
+    }
+
+    GenerationCheckpoint read; //filled on the side, so that 'checkpoint' is left as it is if something goes wrong
+    std::int64_t firstEvent = 0;
+    std::int64_t nextEvent;
+    std::int32_t particlesPerEvent;
+    std::int32_t multiplicity;
+    std::uint32_t speciesNum;
+
+    bool isValid = ReadValue(file, read.seed) && (version < 2 || ReadValue(file, firstEvent)) && ReadValue(file, nextEvent)
+                   && ReadValue(file, particlesPerEvent) && ReadValue(file, multiplicity) && ReadValue(file, read.multiplicityShape)
+                   && ReadValue(file, read.resonanceEnhancement) && ReadValue(file, speciesNum) && speciesNum < (1u << 16);
+    for(std::uint32_t i = 0; i < speciesNum && isValid; ++i)
+    {
+        std::int32_t speciesID;
+        double probability;
+        isValid = ReadValue(file, speciesID) && ReadValue(file, probability);
+        read.abundancies.push_back(SpeciesAbundance{speciesID, probability});
+    }
+    if(!isValid || firstEvent < 0 || nextEvent < firstEvent || nextEvent > 2147483647LL)
+    {
+        std::cout << "\"" << fileName << "\" is truncated\n";
+        return false;
+    }
+
+    read.firstEvent = firstEvent;
+    read.nextEvent = nextEvent;
+    read.particlesPerEvent = particlesPerEvent;
+    read.multiplicity = multiplicity;
+
+    if(!ReadHistograms(file, fileName, GetHistogramDefinitions(), read.histos.getHistograms(), &read.histos.getRuns())) { return false; }
+
+    checkpoint = read;
+    return true;
+}
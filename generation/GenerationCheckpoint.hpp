@@ -0,0 +1,45 @@
+// Daniel Michelin
+
+#ifndef GENERATIONCHECKPOINT_HPP
+#define GENERATIONCHECKPOINT_HPP
+#include "GenerationHistograms.hpp"
+#include "AliasSampler.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//State of a generation run between two batches of events, from which another run can go on (see EventGenerator::Resume()).
+//Every event draws from its own random stream, RandomStream{seed, eventIndex}, so the state of all the random streams
+//is just the seed and the index of the first event not generated yet: the events [firstEvent, nextEvent) are in the
+//histograms (firstEvent is 0 unless the run was a shard, see GenerationConfig::shardIndex).
+//The parameters that change what an event is (multiplicity, abundancies, enhancement) are kept too, so that a run with
+//different ones can't go on from the checkpoint.
+//Layout (numbers in the byte order of the machine that wrote the file):
+// "GASCKPT" + '\0', version (uint32), seed (uint64), firstEvent, nextEvent (int64), particlesPerEvent (int32), multiplicity (int32),
+// multiplicityShape, resonanceEnhancement (double), number of species (uint32), then species ID (int32) and probability
+// (double) of each, then the histograms, in the layout of HistogramIO.hpp
+//Version 1 files, which had no firstEvent, are still read, with firstEvent = 0
+
+std::uint32_t const CheckpointFileVersion = 2;
+
+struct GenerationCheckpoint
+{
+  std::uint64_t seed = 0;
+  int firstEvent = 0;
+  int nextEvent = 0;
+  int particlesPerEvent = 0;
+  int multiplicity = 0; //a MultiplicityModel
+  double multiplicityShape = 1.;
+  double resonanceEnhancement = 1.;
+  std::vector<SpeciesAbundance> abundancies; //as drawn, i.e. after the enhancement
+  GenerationHistograms histos;
+};
+
+//Writes the checkpoint to a temporary file next to 'fileName', then renames it to 'fileName': a run killed while writing
+//leaves the previous checkpoint as it was. Returns false, printing why, if the file can't be written
+bool WriteCheckpoint(std::string const& fileName, GenerationCheckpoint const& checkpoint);
+
+//Returns false, printing why and leaving 'checkpoint' untouched, if the file can't be read
+bool ReadCheckpoint(std::string const& fileName, GenerationCheckpoint& checkpoint);
+
+#endif
@@ -0,0 +1,78 @@
+// Daniel Michelin
+
+#include "GenerationHistograms.hpp"
+#include "Particle.hpp"
+#include <cmath> //also for M_PI
+
+
+std::vector<HistogramDefinition> GetHistogramDefinitions()
+{
+    std::vector<HistogramDefinition> definitions{
+        {"histo_ParticleAbundancies", "Number of particles per type", Particle::getNumParticleType(), 0, 10},
+        {"histo_Theta_Distribution", "Distribution of azimutal coordinate theta", 500, 0, M_PI}, //suggested bin #: 100--1000
+        {"histo_Phi_Distribution", "Distribution of polar coordinate phi", 500, 0, 2*M_PI}, //suggested bin #: 100--1000
+        {"histo_Impulse_Distribution", "Impulse distribution", 1000, 0, 10},
+        {"histo_TransverseImpulse_Distribution", "Transverse impulse distribution", 1000, 0, 10},
+        {"histo_Energy_Distribution", "Particle energy distribution", 1000, 0, 10},
+        //In the general InvariantMass histogram decayment products MUST NOT be included
+        {"histo_InvariantMass", "Invariant mass between every particle", InvMassNbins, 0, InvMassXmax},
+        {"histo_InvMass_SameSign", "Invariant mass: concordant charge", InvMassNbins, 0, InvMassXmax},
+        {"histo_InvMass_SameSign_PionKaon", "Invariant mass: Pion-Kaon concordant charge", InvMassNbins, 0, InvMassXmax},
+        {"histo_InvMass_OppositeSign", "Invariant mass: discordant charge", InvMassNbins, 0, InvMassXmax},
+        {"histo_InvMass_OppositeSign_PionKaon", "Invariant mass: Pion-Kaon discordant charge", InvMassNbins, 0, InvMassXmax},
+        {"histo_InvMass_SameKProducts", "Invariant mass: same K* decay products", InvMassNbins, 0, InvMassXmax}
+    };
+
+    for(int bin = 1; bin <= definitions[Histo_ParticleAbundancies].nbins; ++bin)
+    {
+        definitions[Histo_ParticleAbundancies].binLabels.push_back(GetAbundancyBinLabel(bin));
+    }
+
+    return definitions;
+}
+
+std::string GetAbundancyBinLabel(int bin)
+{
+    return Particle::getParticleType(bin - 1);
+}
+
+bool AreOverlapping(GenerationRun const& a, GenerationRun const& b)
+{
+    return a.seed == b.seed && a.firstEvent < b.lastEvent && b.firstEvent < a.lastEvent;
+}
+
+
+GenerationHistograms::GenerationHistograms()
+{
+    std::vector<HistogramDefinition> const definitions = GetHistogramDefinitions();
+    for(HistogramDefinition const& definition : definitions)
+    {
+        f_Histograms.push_back(FastHistogram{definition.nbins, definition.xmin, definition.xmax});
+    }
+}
+
+FastHistogram& GenerationHistograms::operator[](int index) { return f_Histograms[index]; }
+FastHistogram const& GenerationHistograms::operator[](int index) const { return f_Histograms[index]; }
+int GenerationHistograms::getSize() const { return f_Histograms.size(); }
+std::vector<FastHistogram>& GenerationHistograms::getHistograms() { return f_Histograms; }
+std::vector<FastHistogram> const& GenerationHistograms::getHistograms() const { return f_Histograms; }
+std::vector<GenerationRun>& GenerationHistograms::getRuns() { return f_Runs; }
+std::vector<GenerationRun> const& GenerationHistograms::getRuns() const { return f_Runs; }
+
+void GenerationHistograms::Add(GenerationHistograms const& other)
+{
+    for(int i = 0; i < getSize(); ++i)
+    {
+        f_Histograms[i].Add(other.f_Histograms[i]);
+    }
+    f_Runs.insert(f_Runs.end(), other.f_Runs.begin(), other.f_Runs.end());
+}
+
+void GenerationHistograms::Reset()
+{
+    for(FastHistogram& histo : f_Histograms)
+    {
+        histo.Reset();
+    }
+    f_Runs.clear();
+}
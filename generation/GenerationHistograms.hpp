@@ -0,0 +1,92 @@
+// Daniel Michelin
+
+#ifndef GENERATIONHISTOGRAMS_HPP
+#define GENERATIONHISTOGRAMS_HPP
+#include "FastHistogram.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+//Name, title and binning of a histogram written by the generation
+struct HistogramDefinition
+{
+  std::string name;
+  std::string title;
+  int nbins;
+  double xmin;
+  double xmax;
+  std::vector<std::string> binLabels = {}; //labels of bins 1..nbins, or empty if the bins have no labels
+};
+
+//Position of every histogram in GetHistogramDefinitions() and in GenerationHistograms
+enum HistogramIndex
+{
+  Histo_ParticleAbundancies,
+  Histo_Theta,
+  Histo_Phi,
+  Histo_Impulse,
+  Histo_TransverseImpulse,
+  Histo_Energy,
+  Histo_InvariantMass,                  //the invariant mass histograms are in the same order as the pair categories bits,
+  Histo_InvMass_SameSign,               //i.e. Histo_InvariantMass + k is the histogram of bit k
+  Histo_InvMass_SameSign_PionKaon,
+  Histo_InvMass_OppositeSign,
+  Histo_InvMass_OppositeSign_PionKaon,
+  Histo_InvMass_SameKProducts,
+  NumHistograms
+};
+
+int const InvMassNbins = 80;
+double const InvMassXmax = 2.;
+
+//Definitions of all the histograms, in HistogramIndex order; the abundancies one has a bin per type of the particle table
+std::vector<HistogramDefinition> GetHistogramDefinitions();
+
+//Label of the i-th bin (from 1) of the abundancies histogram, i.e. the name of the (i-1)-th type
+std::string GetAbundancyBinLabel(int bin);
+
+
+//A run of the generation that went into a set of histograms: its seed and the events it generated, [firstEvent, lastEvent)
+//of the random streams of that seed, which are those of shard shardIndex of shardsNum if the run was sharded
+struct GenerationRun
+{
+  std::uint64_t seed;
+  int shardIndex;
+  int shardsNum;
+  std::uint64_t firstEvent;
+  std::uint64_t lastEvent;
+};
+
+//Whether two runs generated some of the same events: same seed, and event ranges that overlap
+bool AreOverlapping(GenerationRun const& a, GenerationRun const& b);
+
+
+//One FastHistogram per definition: the histograms filled by a generation thread.
+//They also list the runs whose events they hold (none while a run fills them: EventGenerator::Run() adds its own at the
+//end), which Add() puts together, so that the files they're written to tell which seeds and events are in them.
+class GenerationHistograms
+{
+public:
+  GenerationHistograms(); //empty histograms, binned as in GetHistogramDefinitions()
+
+  FastHistogram& operator[](int index);
+  FastHistogram const& operator[](int index) const;
+  int getSize() const;
+  std::vector<FastHistogram>& getHistograms();
+  std::vector<FastHistogram> const& getHistograms() const;
+  std::vector<GenerationRun>& getRuns();
+  std::vector<GenerationRun> const& getRuns() const;
+
+  void Add(GenerationHistograms const& other); //the histograms and the runs
+  void Reset(); //empties the histograms and forgets the runs
+
+
+protected:
+
+
+private:
+  std::vector<FastHistogram> f_Histograms;
+  std::vector<GenerationRun> f_Runs;
+};
+
+#endif
@@ -0,0 +1,135 @@
+// Daniel Michelin
+
+#include "HardwareCounters.hpp"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+char const* GetHardwareCounterName(int counter)
+{
+    static char const* const names[NumHardwareCounters] = {"cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses"};
+    return (counter >= 0 && counter < NumHardwareCounters) ? names[counter] : "unknown";
+}
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+HardwareCounters::HardwareCounters() :
+    f_OpenNum{0}
+{
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        f_Fds[c] = -1;
+        f_Order[c] = -1;
+    }
+}
+
+HardwareCounters::~HardwareCounters() { Close(); }
+
+bool HardwareCounters::Open()
+{
+    Close();
+
+#ifdef __linux__
+    struct CounterConfig { std::uint32_t type; std::uint64_t config; };
+    CounterConfig const configs[NumHardwareCounters] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+
+    int leader = -1;
+    int firstErrno = 0;
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = configs[c].type;
+        attributes.config = configs[c].config;
+        attributes.disabled = (leader == -1) ? 1 : 0; //the whole group starts with the leader
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int const fd = syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0); //this thread, any CPU
+        if(fd < 0)
+        {
+            if(firstErrno == 0) { firstErrno = errno; }
+            continue;
+        }
+
+        if(leader == -1) { leader = fd; }
+        f_Fds[c] = fd;
+        f_Order[f_OpenNum++] = c;
+    }
+
+    if(leader == -1)
+    {
+        f_Error = std::string{"perf_event_open failed: "} + std::strerror(firstErrno);
+        if(firstErrno == EACCES || firstErrno == EPERM) { f_Error += " (see /proc/sys/kernel/perf_event_paranoid)"; }
+        return false;
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    f_Error.clear();
+    return true;
+#else
+    f_Error = "hardware counters are only read on Linux";
+    return false;
+#endif
+}
+
+void HardwareCounters::Close()
+{
+#ifdef __linux__
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        if(f_Fds[c] >= 0) { close(f_Fds[c]); }
+    }
+#endif
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        f_Fds[c] = -1;
+        f_Order[c] = -1;
+    }
+    f_OpenNum = 0;
+}
+
+bool HardwareCounters::isOpen() const { return f_OpenNum > 0; }
+bool HardwareCounters::isAvailable(int counter) const { return f_Fds[counter] >= 0; }
+std::string const& HardwareCounters::getError() const { return f_Error; }
+
+void HardwareCounters::Read(std::uint64_t* values, HardwareCounterTimes* times) const
+{
+    for(int c = 0; c < NumHardwareCounters; ++c) { values[c] = 0; }
+    if(times != nullptr) { *times = HardwareCounterTimes{}; }
+
+#ifdef __linux__
+    if(f_OpenNum == 0) { return; }
+
+    // PERF_FORMAT_GROUP with both times: the number of counters, the times enabled and running, then the values
+    std::uint64_t buffer[3 + NumHardwareCounters];
+    long const bytesRead = read(f_Fds[f_Order[0]], buffer, sizeof(buffer));
+    if(bytesRead < 3 * (long)sizeof(std::uint64_t)) { return; }
+
+    std::uint64_t readNum = bytesRead / sizeof(std::uint64_t) - 3; //values actually read
+    if(buffer[0] < readNum) { readNum = buffer[0]; }
+    if((std::uint64_t)f_OpenNum < readNum) { readNum = f_OpenNum; }
+    for(std::uint64_t k = 0; k < readNum; ++k) { values[f_Order[k]] = buffer[3 + k]; }
+    if(times != nullptr)
+    {
+        times->enabled = buffer[1];
+        times->running = buffer[2];
+    }
+#endif
+}
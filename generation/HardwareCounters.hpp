@@ -0,0 +1,69 @@
+// Daniel Michelin
+
+#ifndef HARDWARECOUNTERS_HPP
+#define HARDWARECOUNTERS_HPP
+#include <cstdint>
+#include <string>
+
+//CPU performance counters of the calling thread, through Linux's perf_event_open(): user space only, so that they also
+//work with the default kernel.perf_event_paranoid = 2. The counters are opened as one group, which the kernel
+//schedules on the CPU all together, and are read with a single system call (about a microsecond).
+//When more counters are asked for than the CPU has (e.g. by other tools too), the kernel multiplexes the groups: a group
+//then counts only for part of the time it's enabled, and every read also gives both times, so that the counts can be
+//scaled by enabled / running (see ThreadProfile::AddCounters()).
+//Any counter the CPU or the kernel doesn't give (e.g. in a virtual machine or a container) is just left out, and
+//if none can be opened, or the system isn't Linux, Open() returns false and getError() tells why: the caller goes on
+//without counters.
+
+enum HardwareCounter
+{
+  Counter_Cycles,
+  Counter_Instructions,
+  Counter_L1DMisses,     //level 1 data cache read misses
+  Counter_LLCMisses,     //last level cache misses
+  Counter_BranchMisses,  //mispredicted branches
+  NumHardwareCounters
+};
+
+char const* GetHardwareCounterName(int counter);
+
+//Nanoseconds since the counters were opened: enabled, and actually counting on the CPU
+struct HardwareCounterTimes
+{
+  std::uint64_t enabled = 0;
+  std::uint64_t running = 0;
+};
+
+
+class HardwareCounters
+{
+public:
+  HardwareCounters();
+  ~HardwareCounters();
+
+  HardwareCounters(HardwareCounters const&) = delete;
+  HardwareCounters& operator=(HardwareCounters const&) = delete;
+
+  bool Open(); //starts counting the calling thread; returns false, with the reason in getError(), if no counter is available
+  void Close();
+
+  bool isOpen() const;
+  bool isAvailable(int counter) const;
+  std::string const& getError() const;
+
+  //Writes the current value of every counter into values[counter] (NumHardwareCounters of them), 0 for the unavailable ones,
+  //and the times of the group into 'times', if not nullptr; the values are the raw counts, not scaled
+  void Read(std::uint64_t* values, HardwareCounterTimes* times = nullptr) const;
+
+
+protected:
+
+
+private:
+  int f_Fds[NumHardwareCounters]; //-1 = not available
+  int f_Order[NumHardwareCounters]; //counters in the order they were added to the group, i.e. the order of a group read
+  int f_OpenNum;
+  std::string f_Error;
+};
+
+#endif
@@ -0,0 +1,290 @@
+// Daniel Michelin
+
+#include "HistogramIO.hpp"
+#include <cstdint>
+#include <cstdio> //std::rename()
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <iostream>
+#include <vector>
+
+
+static char const HistogramFileMagic[8] = {'G', 'A', 'S', 'H', 'I', 'S', 'T', '\0'};
+
+// Helpers for the fixed-width fields
+template <typename T>
+static void WriteValue(std::ostream& file, T const value)
+{
+    file.write(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+static void WriteString(std::ostream& file, std::string const& string)
+{
+    WriteValue<std::uint32_t>(file, string.size());
+    file.write(string.data(), string.size());
+}
+
+template <typename T>
+static bool ReadValue(std::istream& file, T& value)
+{
+    return (bool)file.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+static bool ReadString(std::istream& file, std::string& string)
+{
+    std::uint32_t length;
+    if(!ReadValue(file, length) || length > (1u << 20)) { return false; }
+
+    string.resize(length);
+    return (bool)file.read(&string[0], length);
+}
+
+
+bool WriteHistograms(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                     std::vector<GenerationRun> const& runs)
+{
+    std::ofstream file{fileName, std::ios::binary | std::ios::trunc};
+    if(!file)
+    {
+        std::cout << "Cannot open \"" << fileName << "\" for writing\n";
+        return false;
+    }
+
+    WriteHistograms(file, definitions, histos, runs);
+    file.close();
+
+    if(!file)
+    {
+        std::cout << "Error while writing \"" << fileName << "\"\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool WriteHistograms(std::ostream& file, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                     std::vector<GenerationRun> const& runs)
+{
+    file.write(HistogramFileMagic, sizeof(HistogramFileMagic));
+    WriteValue<std::uint32_t>(file, HistogramFileVersion);
+    WriteValue<std::uint32_t>(file, histos.size());
+
+    WriteValue<std::uint32_t>(file, runs.size());
+    for(GenerationRun const& run : runs)
+    {
+        WriteValue<std::uint64_t>(file, run.seed);
+        WriteValue<std::int32_t>(file, run.shardIndex);
+        WriteValue<std::int32_t>(file, run.shardsNum);
+        WriteValue<std::uint64_t>(file, run.firstEvent);
+        WriteValue<std::uint64_t>(file, run.lastEvent);
+    }
+
+    for(unsigned i = 0; i < histos.size(); ++i)
+    {
+        FastHistogram const& histo = histos[i];
+
+        WriteString(file, definitions[i].name);
+        WriteString(file, definitions[i].title);
+        WriteValue<std::int32_t>(file, histo.getNbins());
+        WriteValue<double>(file, histo.getXmin());
+        WriteValue<double>(file, histo.getXmax());
+        WriteValue<double>(file, histo.getEntries());
+
+        double stats[4];
+        histo.getStats(stats);
+        for(int s = 0; s < 4; ++s) { WriteValue<double>(file, stats[s]); }
+
+        for(int bin = 0; bin <= histo.getNbins() + 1; ++bin)
+        {
+            WriteValue<double>(file, histo.getBinContent(bin));
+        }
+
+        WriteValue<std::uint8_t>(file, histo.hasSumw2());
+        for(int bin = 0; histo.hasSumw2() && bin <= histo.getNbins() + 1; ++bin)
+        {
+            WriteValue<double>(file, histo.getBinSumw2(bin));
+        }
+
+        WriteValue<std::uint32_t>(file, definitions[i].binLabels.size());
+        for(std::string const& label : definitions[i].binLabels)
+        {
+            WriteString(file, label);
+        }
+    }
+
+    return (bool)file;
+}
+
+bool WriteHistograms(std::string const& fileName, GenerationHistograms const& histos)
+{
+    return WriteHistograms(fileName, GetHistogramDefinitions(), histos.getHistograms(), histos.getRuns());
+}
+
+bool WriteHistogramsAtomically(std::string const& fileName, GenerationHistograms const& histos, HistogramFileWriter writer)
+{
+    std::string const temporaryName = fileName + ".tmp";
+
+    if(!writer(temporaryName, histos))
+    {
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    if(std::rename(temporaryName.c_str(), fileName.c_str()) != 0)
+    {
+        std::cout << "Cannot rename \"" << temporaryName << "\" to \"" << fileName << "\"\n";
+        std::remove(temporaryName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool ReadHistograms(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                    std::vector<GenerationRun>* runs)
+{
+    std::ifstream file{fileName, std::ios::binary};
+    if(!file)
+    {
+        std::cout << "Cannot open \"" << fileName << "\"\n";
+        return false;
+    }
+
+    return ReadHistograms(file, fileName, definitions, histos, runs);
+}
+
+bool ReadHistograms(std::istream& file, std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                    std::vector<GenerationRun>* runs)
+{
+    char magic[sizeof(HistogramFileMagic)];
+    std::uint32_t version;
+    std::uint32_t histosNum;
+    if(!file.read(magic, sizeof(magic)) || std::memcmp(magic, HistogramFileMagic, sizeof(magic)) != 0 || !ReadValue(file, version))
+    {
+        std::cout << "\"" << fileName << "\" is not a histogram file\n";
+        return false;
+    }
+    if(version < 1 || version > HistogramFileVersion)
+    {
+        std::cout << "\"" << fileName << "\" has format version " << version << ", expected at most " << HistogramFileVersion << '\n';
+        return false;
+    }
+    if(!ReadValue(file, histosNum) || histosNum != histos.size() || histosNum != definitions.size())
+    {
+        std::cout << "\"" << fileName << "\" doesn't contain the expected histograms\n";
+        return false;
+    }
+
+    // Runs, none before version 3
+    std::vector<GenerationRun> readRuns;
+    std::uint32_t runsNum = 0;
+    if(version >= 3 && (!ReadValue(file, runsNum) || runsNum > (1u << 24)))
+    {
+        std::cout << "\"" << fileName << "\" is truncated\n";
+        return false;
+    }
+    for(std::uint32_t r = 0; r < runsNum; ++r)
+    {
+        GenerationRun run;
+        std::int32_t shardIndex;
+        std::int32_t shardsNum;
+        if(!ReadValue(file, run.seed) || !ReadValue(file, shardIndex) || !ReadValue(file, shardsNum) || !ReadValue(file, run.firstEvent)
+           || !ReadValue(file, run.lastEvent))
+        {
+            std::cout << "\"" << fileName << "\" is truncated\n";
+            return false;
+        }
+        run.shardIndex = shardIndex;
+        run.shardsNum = shardsNum;
+        readRuns.push_back(run);
+    }
+
+    std::vector<FastHistogram> read{histos}; //filled on the side, so that 'histos' is left as it is if something goes wrong
+
+    for(unsigned i = 0; i < read.size(); ++i)
+    {
+        FastHistogram& histo = read[i];
+
+        std::string name;
+        std::string title;
+        std::int32_t nbins;
+        double xmin;
+        double xmax;
+        double entries;
+        double stats[4];
+
+        bool isValid = ReadString(file, name) && ReadString(file, title) && ReadValue(file, nbins) && ReadValue(file, xmin) && ReadValue(file, xmax) && ReadValue(file, entries);
+        for(int s = 0; s < 4 && isValid; ++s) { isValid = ReadValue(file, stats[s]); }
+
+        if(!isValid)
+        {
+            std::cout << "\"" << fileName << "\" is truncated\n";
+            return false;
+        }
+        if(name != definitions[i].name)
+        {
+            std::cout << "\"" << fileName << "\" has histogram \"" << name << "\" where \"" << definitions[i].name << "\" was expected\n";
+            return false;
+        }
+        if(nbins != histo.getNbins() || xmin != histo.getXmin() || xmax != histo.getXmax())
+        {
+            std::cout << "Histogram \"" << name << "\" in \"" << fileName << "\" has a different binning\n";
+            return false;
+        }
+        histo = FastHistogram{nbins, xmin, xmax}; //without the sums of squared weights, unless the file has them
+
+        for(int bin = 0; bin <= nbins + 1; ++bin)
+        {
+            double content;
+            if(!ReadValue(file, content))
+            {
+                std::cout << "\"" << fileName << "\" is truncated\n";
+                return false;
+            }
+            histo.setBinContent(bin, content);
+        }
+
+        std::uint8_t hasSumw2 = 0;
+        if(version >= 2 && !ReadValue(file, hasSumw2))
+        {
+            std::cout << "\"" << fileName << "\" is truncated\n";
+            return false;
+        }
+        for(int bin = 0; hasSumw2 && bin <= nbins + 1; ++bin)
+        {
+            double sumw2;
+            if(!ReadValue(file, sumw2))
+            {
+                std::cout << "\"" << fileName << "\" is truncated\n";
+                return false;
+            }
+            histo.setBinSumw2(bin, sumw2);
+        }
+        histo.setEntries(entries);
+        histo.putStats(stats);
+
+        std::uint32_t labelsNum;
+        isValid = ReadValue(file, labelsNum);
+        for(std::uint32_t l = 0; l < labelsNum && isValid; ++l)
+        {
+            std::string label;
+            isValid = ReadString(file, label);
+        }
+        if(!isValid)
+        {
+            std::cout << "\"" << fileName << "\" is truncated\n";
+            return false;
+        }
+    }
+
+    histos = read;
+    if(runs != nullptr) { *runs = readRuns; }
+    return true;
+}
+
+bool ReadHistograms(std::string const& fileName, GenerationHistograms& histos)
+{
+    return ReadHistograms(fileName, GetHistogramDefinitions(), histos.getHistograms(), &histos.getRuns());
+}
@@ -0,0 +1,52 @@
+// Daniel Michelin
+
+#ifndef HISTOGRAMIO_HPP
+#define HISTOGRAMIO_HPP
+#include "GenerationHistograms.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+//Native output backend, available without ROOT: a binary file with all the histograms of a generation
+//Layout (numbers in the byte order of the machine that wrote the file):
+// "GASHIST" + '\0', format version (uint32), number of histograms (uint32), number of runs (uint32) and, for every run
+// whose events the histograms hold (see GenerationRun), seed (uint64), shard index and number of shards (int32), first
+// and last event (uint64); then for every histogram:
+// name, title (uint32 length + characters), nbins (int32), xmin, xmax, entries, 4 statistics (double),
+// nbins + 2 bin contents (double, underflow and overflow included), whether the sums of squared weights follow (uint8)
+// and, if so, nbins + 2 of them (double), number of bin labels (uint32) and the labels
+//Bin labels, such as the particle names of the abundancies histogram, come from the histogram definitions
+//Version 1 files, which had no sums of squared weights, and version 2 files, which had no runs, are still read (with no runs)
+
+std::uint32_t const HistogramFileVersion = 3;
+
+//Writes histos[i] with the name, title and labels of definitions[i], and the runs; returns false, printing why, if the file
+//can't be written
+bool WriteHistograms(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                     std::vector<GenerationRun> const& runs = {});
+bool WriteHistograms(std::string const& fileName, GenerationHistograms const& histos); //with the definitions of the generation
+
+//Reads a file written by WriteHistograms() into 'histos', which must have the histograms of 'definitions', in the same order
+//and with the same binning, and its runs into 'runs', if not nullptr; returns false, printing why and leaving 'histos' and
+//'runs' untouched, if the file can't be read or doesn't match
+bool ReadHistograms(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                    std::vector<GenerationRun>* runs = nullptr);
+bool ReadHistograms(std::string const& fileName, GenerationHistograms& histos);
+
+//Function writing a whole set of histograms to a file, e.g. WriteHistograms() or, with ROOT, WriteHistogramsToRoot()
+typedef bool (*HistogramFileWriter)(std::string const& fileName, GenerationHistograms const& histos);
+
+//Writes the histograms with 'writer' to a temporary file next to 'fileName', then renames it to 'fileName': whoever reads
+//'fileName' meanwhile (e.g. the analysis following a running generation) finds either the previous file or the new one, whole
+bool WriteHistogramsAtomically(std::string const& fileName, GenerationHistograms const& histos, HistogramFileWriter writer = WriteHistograms);
+
+//The same, on a stream opened in binary mode, e.g. for files that hold the histograms among other things (see
+//GenerationCheckpoint.hpp); 'fileName' is only used in the messages
+bool WriteHistograms(std::ostream& file, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                     std::vector<GenerationRun> const& runs = {});
+bool ReadHistograms(std::istream& file, std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                    std::vector<GenerationRun>* runs = nullptr);
+
+#endif
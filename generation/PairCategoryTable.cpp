@@ -0,0 +1,59 @@
+// Daniel Michelin
+
+#include "PairCategoryTable.hpp"
+#include "Particle.hpp"
+#include <string>
+
+
+PairCategoryTable::PairCategoryTable() : f_NumSpecies{Particle::getNumParticleType()}
+{
+    f_Masks.assign(f_NumSpecies * f_NumSpecies, 0);
+
+    for(int id1 = 0; id1 < f_NumSpecies; ++id1)
+    {
+        for(int id2 = 0; id2 < f_NumSpecies; ++id2)
+        {
+            if(Particle::getParticleTypeWidth(id1) > 0. || Particle::getParticleTypeWidth(id2) > 0.) //resonances are skipped
+            {
+                continue;
+            }
+
+            unsigned mask = PairBit_All;
+
+            std::string const name1 = RemoveChargeFromName(Particle::getParticleType(id1));
+            std::string const name2 = RemoveChargeFromName(Particle::getParticleType(id2));
+            bool const isPionKaon = (name1 == "Pion" && name2 == "Kaon") || (name1 == "Kaon" && name2 == "Pion");
+
+            int const chargeProduct = Particle::getParticleTypeCharge(id1) * Particle::getParticleTypeCharge(id2);
+
+            if(chargeProduct > 0) //same sign --concordant charges
+            {
+                mask |= PairBit_SameSign;
+                if(isPionKaon) { mask |= PairBit_SameSignPionKaon; }
+            }
+            else
+            if(chargeProduct < 0) //opposite sign --discordant charges
+            {
+                mask |= PairBit_OppositeSign;
+                if(isPionKaon) { mask |= PairBit_OppositeSignPionKaon; }
+            }
+
+            f_Masks[id1 * f_NumSpecies + id2] = mask;
+        }
+    }
+}
+
+unsigned PairCategoryTable::getMask(int pairCode) const { return f_Masks[pairCode]; }
+unsigned PairCategoryTable::getMask(int speciesID1, int speciesID2) const { return f_Masks[speciesID1 * f_NumSpecies + speciesID2]; }
+int PairCategoryTable::getNumSpecies() const { return f_NumSpecies; }
+
+std::string PairCategoryTable::RemoveChargeFromName(std::string const& name)
+{
+    // the charge is whatever is between the last pair of round brackets at the end of the name
+    std::size_t const bracket = name.rfind('(');
+    if(bracket == std::string::npos || name.back() != ')')
+    {
+        return name;
+    }
+    return name.substr(0, bracket);
+}
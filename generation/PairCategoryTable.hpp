@@ -0,0 +1,43 @@
+// Daniel Michelin
+
+#ifndef PAIRCATEGORYTABLE_HPP
+#define PAIRCATEGORYTABLE_HPP
+#include <vector>
+#include <string>
+
+//Bits of a pair category mask; bit k means that the pair goes into the k-th invariant mass histogram
+enum PairCategoryBit
+{
+  PairBit_All = 1 << 0,                   //every pair
+  PairBit_SameSign = 1 << 1,              //concordant charges
+  PairBit_SameSignPionKaon = 1 << 2,      //concordant charges, one Pion and one Kaon
+  PairBit_OppositeSign = 1 << 3,          //discordant charges
+  PairBit_OppositeSignPionKaon = 1 << 4   //discordant charges, one Pion and one Kaon
+};
+
+int const NumPairCategories = 5;
+
+//NxN table, N being the number of particle types, telling which invariant mass histograms a pair of types feeds.
+//It's built once from the particle table, so the pair loop only has to look a mask up, and new types are
+//classified automatically. Resonances (types with a width) decay before the pair loop: their masks are 0.
+class PairCategoryTable
+{
+public:
+  PairCategoryTable(); //builds the table from the current content of the particle table
+
+  unsigned getMask(int pairCode) const; //pairCode = speciesID1 * getNumSpecies() + speciesID2, as given by InvMassBlock
+  unsigned getMask(int speciesID1, int speciesID2) const;
+  int getNumSpecies() const;
+
+  static std::string RemoveChargeFromName(std::string const& name); //e.g.: "Kaon(+)" --> "Kaon"
+
+
+protected:
+
+
+private:
+  int f_NumSpecies;
+  std::vector<unsigned char> f_Masks;
+};
+
+#endif
@@ -0,0 +1,158 @@
+// Daniel Michelin
+
+#include "PairKernel.hpp"
+#include <cmath>
+#include <string>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PAIRKERNEL_X86
+#include <immintrin.h>
+#endif
+
+// AVX-512F includes FMA: GCC would fuse the multiplications and additions below unless told not to,
+// and the results would no longer be the same as the scalar ones
+#if defined(PAIRKERNEL_X86) && !defined(__clang__)
+#define PAIRKERNEL_NO_FMA __attribute__((optimize("fp-contract=off")))
+#else
+#define PAIRKERNEL_NO_FMA
+#endif
+
+
+FourMomentumColumns GetFourMomentumColumns(EventBuffer const& buffer)
+{
+    return FourMomentumColumns{buffer.getPx(), buffer.getPy(), buffer.getPz(), buffer.getEnergy(), buffer.getSpeciesID(), buffer.getSize()};
+}
+
+
+/////////////////////
+// IMPLEMENTATIONS //
+
+// Each one computes the masses for j in [first, last) and returns where it stopped, the rest being left to the scalar one
+
+static int InvMassScalar(FourMomentumColumns const& c, int i, int first, int last, double* invMasses)
+{
+    for(int j = first; j < last; ++j)
+    {
+        double const sumOfE = c.energy[i] + c.energy[j];
+        double const sumOfPx = c.px[i] + c.px[j];
+        double const sumOfPy = c.py[i] + c.py[j];
+        double const sumOfPz = c.pz[i] + c.pz[j];
+
+        invMasses[j-first] = sqrt(sumOfE*sumOfE - (sumOfPx*sumOfPx + sumOfPy*sumOfPy + sumOfPz*sumOfPz));
+    }
+    return last;
+}
+
+#ifdef PAIRKERNEL_X86
+
+__attribute__((target("avx2"))) PAIRKERNEL_NO_FMA
+static int InvMassAVX2(FourMomentumColumns const& c, int i, int first, int last, double* invMasses)
+{
+    __m256d const Ei = _mm256_set1_pd(c.energy[i]);
+    __m256d const Pxi = _mm256_set1_pd(c.px[i]);
+    __m256d const Pyi = _mm256_set1_pd(c.py[i]);
+    __m256d const Pzi = _mm256_set1_pd(c.pz[i]);
+
+    int j = first;
+    for(; j + 4 <= last; j += 4)
+    {
+        __m256d const E = _mm256_add_pd(Ei, _mm256_loadu_pd(c.energy + j));
+        __m256d const Px = _mm256_add_pd(Pxi, _mm256_loadu_pd(c.px + j));
+        __m256d const Py = _mm256_add_pd(Pyi, _mm256_loadu_pd(c.py + j));
+        __m256d const Pz = _mm256_add_pd(Pzi, _mm256_loadu_pd(c.pz + j));
+
+        __m256d const P2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(Px, Px), _mm256_mul_pd(Py, Py)), _mm256_mul_pd(Pz, Pz));
+        __m256d const M2 = _mm256_sub_pd(_mm256_mul_pd(E, E), P2);
+
+        _mm256_storeu_pd(invMasses + (j-first), _mm256_sqrt_pd(M2));
+    }
+    return j;
+}
+
+__attribute__((target("avx512f"))) PAIRKERNEL_NO_FMA
+static int InvMassAVX512(FourMomentumColumns const& c, int i, int first, int last, double* invMasses)
+{
+    __m512d const Ei = _mm512_set1_pd(c.energy[i]);
+    __m512d const Pxi = _mm512_set1_pd(c.px[i]);
+    __m512d const Pyi = _mm512_set1_pd(c.py[i]);
+    __m512d const Pzi = _mm512_set1_pd(c.pz[i]);
+
+    int j = first;
+    for(; j + 8 <= last; j += 8)
+    {
+        __m512d const E = _mm512_add_pd(Ei, _mm512_loadu_pd(c.energy + j));
+        __m512d const Px = _mm512_add_pd(Pxi, _mm512_loadu_pd(c.px + j));
+        __m512d const Py = _mm512_add_pd(Pyi, _mm512_loadu_pd(c.py + j));
+        __m512d const Pz = _mm512_add_pd(Pzi, _mm512_loadu_pd(c.pz + j));
+
+        __m512d const P2 = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(Px, Px), _mm512_mul_pd(Py, Py)), _mm512_mul_pd(Pz, Pz));
+        __m512d const M2 = _mm512_sub_pd(_mm512_mul_pd(E, E), P2);
+
+        // the masked form with every lane on, since GCC's _mm512_sqrt_pd() trips -Wmaybe-uninitialized in its own header
+        _mm512_storeu_pd(invMasses + (j-first), _mm512_mask_sqrt_pd(M2, (__mmask8)0xFF, M2));
+    }
+    return j;
+}
+
+#endif
+
+
+////////////////
+// DISPATCHER //
+
+typedef int (*InvMassImplementation)(FourMomentumColumns const&, int, int, int, double*);
+
+struct PairKernelChoice
+{
+    InvMassImplementation function;
+    char const* name;
+};
+
+static PairKernelChoice ChoosePairKernel()
+{
+#ifdef PAIRKERNEL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) { return PairKernelChoice{InvMassAVX512, "avx512"}; }
+    if(__builtin_cpu_supports("avx2")) { return PairKernelChoice{InvMassAVX2, "avx2"}; }
+#endif
+    return PairKernelChoice{InvMassScalar, "scalar"};
+}
+
+static PairKernelChoice pairKernel = ChoosePairKernel(); //the CPU is checked only once, unless setPairKernel() changes it
+
+void InvMassBlock(FourMomentumColumns const& columns, int i, int first, int last, int numSpecies, double* invMasses, int* pairCodes)
+{
+    int const done = pairKernel.function(columns, i, first, last, invMasses);
+    InvMassScalar(columns, i, done, last, invMasses + (done-first)); //tail that doesn't fill a whole vector
+
+    int const codeOfI = columns.speciesID[i] * numSpecies;
+    for(int j = first; j < last; ++j)
+    {
+        pairCodes[j-first] = codeOfI + columns.speciesID[j];
+    }
+}
+
+char const* getPairKernelName() { return pairKernel.name; }
+
+bool setPairKernel(std::string const& name)
+{
+    if(name == "scalar")
+    {
+        pairKernel = PairKernelChoice{InvMassScalar, "scalar"};
+        return true;
+    }
+#ifdef PAIRKERNEL_X86
+    __builtin_cpu_init();
+    if(name == "avx2" && __builtin_cpu_supports("avx2"))
+    {
+        pairKernel = PairKernelChoice{InvMassAVX2, "avx2"};
+        return true;
+    }
+    if(name == "avx512" && __builtin_cpu_supports("avx512f"))
+    {
+        pairKernel = PairKernelChoice{InvMassAVX512, "avx512"};
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,43 @@
+// Daniel Michelin
+
+#ifndef PAIRKERNEL_HPP
+#define PAIRKERNEL_HPP
+#include "EventBuffer.hpp"
+#include <string>
+
+//Invariant mass kernel for the pair loop.
+//Given particle i, it computes in one go the invariant masses with the particles first, first+1, ..., last-1,
+//reading the four-momenta already stored in the columns of an EventBuffer.
+//Depending on what the CPU supports, it runs 8 (AVX-512) or 4 (AVX2) pairs at a time, or falls back to plain scalar code.
+//
+//Tolerance: every implementation does the same IEEE operations in the same order as Particle::InvMass and
+//EventBuffer::InvMass, without FMA, so the results are bit-identical to theirs. Should a compiler reorder or fuse
+//them anyway, the relative difference stays below 1e-12 (a few ulp on m^2).
+
+int const PairBlockSize = 256; //suggested number of pairs per call: the output arrays of a block stay in L1
+
+struct FourMomentumColumns
+{
+    double const* px;
+    double const* py;
+    double const* pz;
+    double const* energy;
+    int const* speciesID;
+    int size;
+};
+
+FourMomentumColumns GetFourMomentumColumns(EventBuffer const& buffer);
+
+//Writes the invariant masses of the pairs (i, j), with first <= j < last, into invMasses[j-first],
+//and their pair codes, speciesID[i]*numSpecies + speciesID[j], into pairCodes[j-first].
+//The output arrays must be at least (last - first) long.
+void InvMassBlock(FourMomentumColumns const& columns, int i, int first, int last, int numSpecies, double* invMasses, int* pairCodes);
+
+//Name of the implementation picked for this CPU: "avx512", "avx2" or "scalar"
+char const* getPairKernelName();
+
+//Forces the implementation, e.g. to check them against each other; returns false, changing nothing, if it's unknown or
+//this CPU can't run it. Not thread-safe: only call it while no pair loop is running
+bool setPairKernel(std::string const& name);
+
+#endif
@@ -5,7 +5,6 @@
 #include <vector>
 #include <string>
 #include <cmath> //also for M_PI
-#include <cstdlib> //for RAND_MAX
 
 
 double ModuleOf3DVector(double x, double y, double z)
@@ -26,11 +25,11 @@ double Particle::getImpulse(char component) const
 {
     switch(component)
     {
-    case 'x': return f_P.x;
+    case 'x': return f_P.px;
         break;
-    case 'y': return f_P.y;
+    case 'y': return f_P.py;
         break;
-    case 'z': return f_P.z;
+    case 'z': return f_P.pz;
         break;
     default:
         {
@@ -41,6 +40,8 @@ double Particle::getImpulse(char component) const
     }
 }
 
+FourVector Particle::getFourVector() const { return f_P; }
+
 std::string Particle::getName() const
 {
     return f_ParticleType[f_IndexParticle]->getName();
@@ -48,12 +49,12 @@ std::string Particle::getName() const
 
 double Particle::getMass() const
 {
-    return f_ParticleType[f_IndexParticle]->getMass();
+    return f_TypeMass[f_IndexParticle];
 }
 
 int Particle::getCharge() const
 {
-    return f_ParticleType[f_IndexParticle]->getCharge();
+    return f_TypeCharge[f_IndexParticle];
 }
 
 int Particle::getIndex() const { return f_IndexParticle; }
@@ -72,24 +73,43 @@ std::string Particle::getParticleType(const int index)
     }
 }
 
+double Particle::getParticleTypeMass(const int index)
+{
+    if(index < 0 || index >= f_NumParticleType) { return 0.; }
+    return f_TypeMass[index];
+}
+
+int Particle::getParticleTypeCharge(const int index)
+{
+    if(index < 0 || index >= f_NumParticleType) { return 0; }
+    return f_TypeCharge[index];
+}
+
+double Particle::getParticleTypeWidth(const int index)
+{
+    if(index < 0 || index >= f_NumParticleType) { return 0.; }
+    return f_TypeWidth[index];
+}
+
 // SETTERS //
 
 void Particle::setImpulse(double px, double py, double pz)
 {
-    f_P.x = px;
-    f_P.y = py;
-    f_P.z = pz;
+    f_P.px = px;
+    f_P.py = py;
+    f_P.pz = pz;
+    UpdateEnergy();
 }
 
 void Particle::setImpulse(char component, double value)
 {
     switch(component)
     {
-    case 'x': f_P.x = value;
+    case 'x': f_P.px = value;
         break;
-    case 'y': f_P.y = value;
+    case 'y': f_P.py = value;
         break;
-    case 'z': f_P.z = value;
+    case 'z': f_P.pz = value;
         break;
     default:
         {
@@ -97,6 +117,7 @@ void Particle::setImpulse(char component, double value)
         }
         break;
     }
+    UpdateEnergy();
 }
 
 void Particle::setIndex(std::string const& name)
@@ -106,6 +127,7 @@ void Particle::setIndex(std::string const& name)
     if(index >= 0 && index < ((int)(f_ParticleType.size())))
     {
         f_IndexParticle = index; //if a match is found, the particle's index is assigned
+        UpdateEnergy(); //the mass may have changed
     }
     else
     {
@@ -117,12 +139,13 @@ void Particle::setIndex(std::string const& name)
 void Particle::setIndex(int newIndex)
 {
     f_IndexParticle = newIndex;
+    UpdateEnergy();
 }
 
 
 // CONSTRUCTOR //
 
-Particle::Particle(std::string const& name, double Px, double Py, double Pz) : f_P{Px, Py, Pz}
+Particle::Particle(std::string const& name, double Px, double Py, double Pz) : f_IndexParticle{-1}, f_P{Px, Py, Pz, 0.}
 {
     int index = FindParticle(name);
     // Remember that 'index == -1' means that the particle has no correspondence in the table/vector (of types)
@@ -136,8 +159,24 @@ Particle::Particle(std::string const& name, double Px, double Py, double Pz) : f
     {
         std::cout << "Assignment of particle index/ID: NO matching type found\n";
     }
+
+    UpdateEnergy();
 };
 
+Particle::Particle(int index, double Px, double Py, double Pz) : f_IndexParticle{-1}, f_P{Px, Py, Pz, 0.}
+{
+    if(index >= 0 && index < f_NumParticleType)
+    {
+        f_IndexParticle = index;
+    }
+    else
+    {
+        std::cout << "Assignment of particle index/ID: NO matching type found\n";
+    }
+
+    UpdateEnergy();
+}
+
 
 // FUNCTIONS //
 
@@ -153,25 +192,29 @@ void Particle::AddParticleType(std::string const& name, double mass, int charge,
     }
     else //if it's a new type
     {
-        if(f_NumParticleType < f_MaxNumParticleType) //if the 'table' of particle types isn't full
+        if(resonanceWidth < 0.)
         {
-            std::cout << " Adding particle \"" << name << "\" to the table...\n";
-
-            if(resonanceWidth > 0)
-            {
-                f_ParticleType.push_back(new ResonanceType{name, mass, charge, resonanceWidth});
-            }
-            else if(resonanceWidth == 0.)
-            {
-                f_ParticleType.push_back(new ParticleType{name, mass, charge});
-            }
-            
-            ++f_NumParticleType;
+            std::cout << "Cannot add particle type \"" << name << "\": the resonance width can't be negative\n";
+            return;
         }
-        else //if table is full
+
+        std::cout << " Adding particle \"" << name << "\" to the table...\n";
+
+        if(resonanceWidth > 0)
         {
-            std::cout << "Cannot add particle type: table is full\n";
+            f_ParticleType.push_back(new ResonanceType{name, mass, charge, resonanceWidth});
         }
+        else
+        {
+            f_ParticleType.push_back(new ParticleType{name, mass, charge});
+        }
+
+        f_ParticleTypeIndex[name] = f_NumParticleType;
+        f_TypeMass.push_back(mass);
+        f_TypeCharge.push_back(charge);
+        f_TypeWidth.push_back(resonanceWidth);
+        
+        ++f_NumParticleType;
     }
 }
 
@@ -196,28 +239,23 @@ void Particle::PrintParticleDetails() const
 
 double Particle::ParticleEnergy() const
 {
-    auto mass = f_ParticleType[f_IndexParticle]->getMass();
-
-    auto impulseModule = ModuleOf3DVector(f_P.x, f_P.y, f_P.z);
-    auto energy = sqrt(pow(mass, 2) + pow(impulseModule, 2));
-    
-    return energy;
+    return f_P.E;
 }
 
 double Particle::InvMass(Particle const& partic2) const
 {
-    auto energy1 = ParticleEnergy();
-    auto energy2 = partic2.ParticleEnergy();
-    auto sumOfPx = f_P.x + partic2.getImpulse('x');
-    auto sumOfPy = f_P.y + partic2.getImpulse('y');
-    auto sumOfPz = f_P.z + partic2.getImpulse('z');
+    auto sumOfE = f_P.E + partic2.f_P.E;
+    auto sumOfPx = f_P.px + partic2.f_P.px;
+    auto sumOfPy = f_P.py + partic2.f_P.py;
+    auto sumOfPz = f_P.pz + partic2.f_P.pz;
     
-    auto invariantMass = sqrt(pow(energy1 + energy2, 2) - pow(ModuleOf3DVector(sumOfPx, sumOfPy, sumOfPz), 2));
+    // squares written out as products: no pow(), and no square root of the impulse module to be squared again
+    auto invariantMass = sqrt(sumOfE*sumOfE - (sumOfPx*sumOfPx + sumOfPy*sumOfPy + sumOfPz*sumOfPz));
     
     return invariantMass;
 }
 
-int Particle::Decay2Body(Particle &dau1, Particle &dau2) const
+int Particle::Decay2Body(Particle &dau1, Particle &dau2, RandomStream& rng) const
 {
   if(getMass() == 0.0)
   {
@@ -233,20 +271,18 @@ int Particle::Decay2Body(Particle &dau1, Particle &dau2) const
   {
     // gaussian random numbers
 
-    float x1, x2, w, y1, y2;
+    float x1, x2, w, y1;
     
-    double invnum = 1./RAND_MAX;
     do {
-      x1 = 2.0 * rand()*invnum - 1.0;
-      x2 = 2.0 * rand()*invnum - 1.0;
+      x1 = 2.0 * rng.Rndm() - 1.0;
+      x2 = 2.0 * rng.Rndm() - 1.0;
       w = x1 * x1 + x2 * x2;
     } while ( w >= 1.0 );
     
     w = sqrt( (-2.0 * log( w ) ) / w );
-    y1 = x1 * w;
-    y2 = x2 * w;
+    y1 = x1 * w; //the second gaussian number, x2 * w, isn't needed
 
-    massMot += f_ParticleType[f_IndexParticle]->getWidth() * y1;
+    massMot += f_TypeWidth[f_IndexParticle] * y1;
 
   }
 
@@ -259,19 +295,18 @@ int Particle::Decay2Body(Particle &dau1, Particle &dau2) const
   //double pout = sqrt((massMot*massMot - (massDau1+massDau2)*(massDau1+massDau2))*(massMot*massMot - (massDau1-massDau2)*(massDau1-massDau2))) / massMot*0.5;
   double pout = sqrt( (massMot*massMot - pow(massDau1+massDau2, 2)) * (massMot*massMot - pow(massDau1-massDau2, 2)) ) / massMot*0.5;
 
-  double norm = 2*M_PI/RAND_MAX;
-
-  double phi = rand()*norm;
-  double theta = rand()*norm*0.5 - M_PI/2.;
+  double phi = rng.Rndm()*2*M_PI;
+  double theta = rng.Rndm()*M_PI - M_PI/2.;
   dau1.setImpulse(pout*sin(theta)*cos(phi), pout*sin(theta)*sin(phi), pout*cos(theta));
   dau2.setImpulse(-pout*sin(theta)*cos(phi), -pout*sin(theta)*sin(phi), -pout*cos(theta));
 
   //double energy = sqrt(fPx*fPx + fPy*fPy + fPz*fPz + massMot*massMot);
-  double energy = sqrt(pow(ModuleOf3DVector(f_P.x, f_P.y, f_P.z), 2) + massMot*massMot);
+  //not f_P.E, since the mass of the mother has just been smeared by the width
+  double energy = sqrt(f_P.px*f_P.px + f_P.py*f_P.py + f_P.pz*f_P.pz + massMot*massMot);
 
-  double bx = f_P.x/energy;
-  double by = f_P.y/energy;
-  double bz = f_P.z/energy;
+  double bx = f_P.px/energy;
+  double by = f_P.py/energy;
+  double bz = f_P.pz/energy;
 
   dau1.Boost(bx,by,bz);
   dau2.Boost(bx,by,bz);
@@ -279,6 +314,22 @@ int Particle::Decay2Body(Particle &dau1, Particle &dau2) const
   return 0;
 }
 
+void Particle::Boost(double bx, double by, double bz)
+{
+    double energy = f_P.E;
+
+    //Boost this Lorentz vector
+    double b2 = bx*bx + by*by + bz*bz;
+    double gamma = 1.0 / sqrt(1.0 - b2);
+    double bp = bx*f_P.px + by*f_P.py + bz*f_P.pz;
+    double gamma2 = b2 > 0 ? (gamma - 1.0)/b2 : 0.0;
+
+    f_P.px += gamma2*bp*bx + gamma*bx*energy;
+    f_P.py += gamma2*bp*by + gamma*by*energy;
+    f_P.pz += gamma2*bp*bz + gamma*bz*energy;
+    f_P.E = gamma*(energy + bp); //the energy transforms along with the impulse, no need to recalculate it
+}
+
 int Particle::FindParticle_public(std::string const& name)
 {
     return Particle::FindParticle(name);
@@ -289,33 +340,27 @@ int Particle::FindParticle_public(std::string const& name)
 // PRIVATE METHODS //
 
 std::vector<ParticleType*> Particle::f_ParticleType{}; //"initializing" static table of types
+std::unordered_map<std::string, int> Particle::f_ParticleTypeIndex{};
+std::vector<double> Particle::f_TypeMass{};
+std::vector<int> Particle::f_TypeCharge{};
+std::vector<double> Particle::f_TypeWidth{};
 
 int Particle::FindParticle(std::string const& name)
 {
-    //std::cout << "f_ParticleType.size() = " << f_ParticleType.size() << '\n'; //FOR TESTING PURPOSES
+    auto const match = f_ParticleTypeIndex.find(name);
 
-    for(unsigned int i=0; i < f_ParticleType.size(); ++i) // 'i < f_ParticleType.size()' may be switched with 'i < f_NumParticleType'
+    if(match != f_ParticleTypeIndex.end())
     {
-        if(f_ParticleType[i]->getName() == name)
-        {
-            return i; // returns index value (i.e. position in the vector) if there's a match,
-        }             // that is if the passed particle type ('name') is already present in the vector
-    }
+        return match->second; // returns index value (i.e. position in the vector) if there's a match,
+    }                         // that is if the passed particle type ('name') is already present in the vector
 
     return -1; //'no match' value
 }
 
-void Particle::Boost(double bx, double by, double bz)
+void Particle::UpdateEnergy()
 {
-    double energy = ParticleEnergy();
+    // a particle without a valid type is treated as massless
+    double mass = getParticleTypeMass(f_IndexParticle);
 
-    //Boost this Lorentz vector
-    double b2 = bx*bx + by*by + bz*bz;
-    double gamma = 1.0 / sqrt(1.0 - b2);
-    double bp = bx*f_P.x + by*f_P.y + bz*f_P.z;
-    double gamma2 = b2 > 0 ? (gamma - 1.0)/b2 : 0.0;
-
-    f_P.x += gamma2*bp*bx + gamma*bx*energy;
-    f_P.y += gamma2*bp*by + gamma*by*energy;
-    f_P.z += gamma2*bp*bz + gamma*bz*energy;
-}
\ No newline at end of file
+    f_P.E = sqrt(mass*mass + f_P.px*f_P.px + f_P.py*f_P.py + f_P.pz*f_P.pz);
+}
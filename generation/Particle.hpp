@@ -4,14 +4,17 @@
 #define PARTICLE_HPP
 #include "ParticleType.hpp"
 #include "ResonanceType.hpp"
+#include "RandomStream.hpp"
 #include <vector>
 #include <string>
+#include <unordered_map>
 
-struct Impulse
+struct FourVector
 {
-  double x;
-  double y;
-  double z;
+  double px;
+  double py;
+  double pz;
+  double E; //energy, kept consistent with the impulse and the particle's mass
 };
 
 double ModuleOf3DVector(double x = 0., double y = 0., double z = 0.);
@@ -20,14 +23,19 @@ class Particle
 {
 public:
   Particle(std::string const& name, double Px = 0., double Py = 0., double Pz = 0.); //parametric constructor
+  Particle(int index, double Px = 0., double Py = 0., double Pz = 0.); //same, with the index given by FindParticle_public(); no name lookup
 
   double getImpulse(char component) const;
+  FourVector getFourVector() const;
   std::string getName() const;
   double getMass() const;
   int getCharge() const;
   int getIndex() const;
   static int getNumParticleType();
   static std::string getParticleType(const int index); //returns particle type (i.e. the name) corresponding to the passed index
+  static double getParticleTypeMass(const int index); //mass of the type corresponding to the passed index; 0 if there's none
+  static int getParticleTypeCharge(const int index); //charge of the type corresponding to the passed index; 0 if there's none
+  static double getParticleTypeWidth(const int index); //resonance width of the type corresponding to the passed index; 0 if there's none
   
   void setImpulse(double px, double py, double pz);
   void setImpulse(char component, double value);
@@ -42,11 +50,13 @@ public:
 
   void PrintParticleDetails() const; //prints index, name and impulse
   
-  double ParticleEnergy() const; //calculates the energy of a particle through a determined formula; used in other functions
+  double ParticleEnergy() const; //energy of the particle; it's calculated whenever the impulse or the type change, so this only reads it
   
   double InvMass(Particle const& partic2) const; //calculates the invariant mass of between two particles through a determined formula
 
-  int Decay2Body(Particle &dau1, Particle &dau2) const; //makes decay a particle into two particles: dau1 & dau2
+  int Decay2Body(Particle &dau1, Particle &dau2, RandomStream& rng) const; //makes decay a particle into two particles: dau1 & dau2; random numbers come from rng
+
+  void Boost(double bx, double by, double bz); //Lorentz boost by the velocity (bx, by, bz), in units of c; used by Decay2Body()
 
   static int FindParticle_public(std::string const& name); //used in the generation macro
   
@@ -56,17 +66,22 @@ protected:
 private:
   static std::vector<ParticleType*> f_ParticleType;
 
-  static const int f_MaxNumParticleType = 10;
+  static std::unordered_map<std::string, int> f_ParticleTypeIndex; //name --> index in f_ParticleType; makes FindParticle() O(1)
+
+  //properties of the types, copied from f_ParticleType into contiguous arrays (same indexes) so that they're read without virtual calls
+  static std::vector<double> f_TypeMass;
+  static std::vector<int> f_TypeCharge;
+  static std::vector<double> f_TypeWidth; //0 for non resonances
 
   static int f_NumParticleType; //number of particle types present in the vector f_ParticleType    // 'initialized' in the .cpp file
 
   int f_IndexParticle; //index corresponding to a certain particle type in the vector f_ParticleType; in a sense, it's a particle's ID
   
-  Impulse f_P;
+  FourVector f_P;
 
   static int FindParticle(std::string const& name); //made static so to also be used outside of private methods
 
-  void Boost(double bx, double by, double bz);
+  void UpdateEnergy(); //recalculates f_P.E from the impulse and the mass; called by whatever changes either of them
 };
 
 #endif
\ No newline at end of file
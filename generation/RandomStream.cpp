@@ -0,0 +1,195 @@
+// Daniel Michelin
+
+#include "RandomStream.hpp"
+#include <cmath>
+#include <math.h> //lgamma_r(), a POSIX extension that <cmath> doesn't declare everywhere
+#include <random>
+#include <chrono>
+
+
+// Philox4x32 constants (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+static const std::uint32_t PhiloxM0 = 0xD2511F53;
+static const std::uint32_t PhiloxM1 = 0xCD9E8D57;
+static const std::uint32_t PhiloxW0 = 0x9E3779B9;
+static const std::uint32_t PhiloxW1 = 0xBB67AE85;
+static const int PhiloxRounds = 10;
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+RandomStream::RandomStream(std::uint64_t seed, std::uint64_t streamID) :
+    f_Seed{seed},
+    f_StreamID{streamID},
+    f_Position{0},
+    f_Block{0, 0, 0, 0},
+    f_BlockIndex{4},
+    f_SpareGaus{0.},
+    f_HasSpareGaus{false}
+    {}
+
+double RandomStream::Rndm()
+{
+    std::uint64_t const high = NextWord();
+    std::uint64_t const low = NextWord();
+
+    return UniformFromBits((high << 21) | (low >> 11));
+}
+
+double RandomStream::Exp(double tau)
+{
+    return -tau * log(Rndm());
+}
+
+double RandomStream::Gaus(double mean, double sigma)
+{
+    if(f_HasSpareGaus)
+    {
+        f_HasSpareGaus = false;
+        return mean + sigma * f_SpareGaus;
+    }
+
+    // Marsaglia polar method, as in Particle::Decay2Body
+    double x1, x2, w;
+    do {
+      x1 = 2.0 * Rndm() - 1.0;
+      x2 = 2.0 * Rndm() - 1.0;
+      w = x1 * x1 + x2 * x2;
+    } while ( w >= 1.0 );
+
+    w = sqrt( (-2.0 * log( w ) ) / w );
+    f_SpareGaus = x2 * w;
+    f_HasSpareGaus = true;
+
+    return mean + sigma * x1 * w;
+}
+
+double RandomStream::Gamma(double shape, double scale)
+{
+    if(shape <= 0.) { return 0.; }
+
+    // shape < 1: Gamma(shape) = Gamma(shape + 1) * U^(1/shape)
+    if(shape < 1.)
+    {
+        double const u = Rndm();
+        return Gamma(shape + 1., scale) * pow(u, 1. / shape);
+    }
+
+    // Marsaglia-Tsang method
+    double const d = shape - 1./3.;
+    double const c = 1. / sqrt(9. * d);
+    while(true)
+    {
+        double const x = Gaus();
+        double v = 1. + c * x;
+        if(v <= 0.) { continue; }
+
+        v = v * v * v;
+        double const u = Rndm();
+        if(u < 1. - 0.0331 * x*x*x*x) { return d * v * scale; }
+        if(log(u) < 0.5 * x*x + d * (1. - v + log(v))) { return d * v * scale; }
+    }
+}
+
+int RandomStream::Poisson(double mean)
+{
+    if(mean <= 0.) { return 0; }
+
+    // Small means: multiplication of uniform numbers (Knuth)
+    if(mean < 10.)
+    {
+        double const limit = exp(-mean);
+        double product = Rndm();
+        int n = 0;
+        while(product > limit)
+        {
+            product *= Rndm();
+            ++n;
+        }
+        return n;
+    }
+
+    // Large means: transformed rejection with squeeze (Hoermann's PTRS), whose cost doesn't grow with the mean
+    double const sqrtMean = sqrt(mean);
+    double const logMean = log(mean);
+    double const b = 0.931 + 2.53 * sqrtMean;
+    double const a = -0.059 + 0.02483 * b;
+    double const invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+    double const vr = 0.9277 - 3.6224 / (b - 2.);
+
+    while(true)
+    {
+        double const u = Rndm() - 0.5;
+        double const v = Rndm();
+        double const us = 0.5 - fabs(u);
+        double const k = floor((2. * a / us + b) * u + mean + 0.43);
+
+        if(us >= 0.07 && v <= vr) { return k; }
+        if(k < 0. || (us < 0.013 && v > us)) { continue; }
+        // lgamma_r(), not lgamma(), which writes the sign to the global signgam: every generation thread gets here at once
+        int sign;
+        if(log(v) + log(invAlpha) - log(a / (us*us) + b) <= -mean + k * logMean - lgamma_r(k + 1., &sign)) { return k; }
+    }
+}
+
+std::uint64_t RandomStream::getSeed() const { return f_Seed; }
+std::uint64_t RandomStream::getStreamID() const { return f_StreamID; }
+std::uint64_t RandomStream::getPosition() const { return f_Position; }
+
+double RandomStream::UniformFromBits(std::uint64_t bits)
+{
+    // Shifted by half a step, so that 0 can't come out. Nor should 1, but for the top value (2^53 - 0.5) * 2^-53 isn't
+    // representable and rounds up to exactly 1: that one is brought back to the largest double below 1
+    double const u = (bits + 0.5) * (1.0 / 9007199254740992.0); // 2^-53
+
+    return (u < 1.) ? u : 1. - 1. / 9007199254740992.0;
+}
+
+std::uint64_t RandomStream::MakeSeed()
+{
+    std::random_device device;
+    std::uint64_t const time = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    return ((std::uint64_t)device() << 32) ^ device() ^ time;
+}
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+void RandomStream::NextBlock()
+{
+    // counter = (position, streamID), key = seed
+    std::uint32_t ctr[4] = {(std::uint32_t)f_Position, (std::uint32_t)(f_Position >> 32),
+                            (std::uint32_t)f_StreamID, (std::uint32_t)(f_StreamID >> 32)};
+    std::uint32_t key[2] = {(std::uint32_t)f_Seed, (std::uint32_t)(f_Seed >> 32)};
+
+    for(int round = 0; round < PhiloxRounds; ++round)
+    {
+        std::uint64_t const product0 = (std::uint64_t)PhiloxM0 * ctr[0];
+        std::uint64_t const product1 = (std::uint64_t)PhiloxM1 * ctr[2];
+
+        std::uint32_t const hi0 = product0 >> 32;
+        std::uint32_t const lo0 = (std::uint32_t)product0;
+        std::uint32_t const hi1 = product1 >> 32;
+        std::uint32_t const lo1 = (std::uint32_t)product1;
+
+        ctr[0] = hi1 ^ ctr[1] ^ key[0];
+        ctr[1] = lo1;
+        ctr[2] = hi0 ^ ctr[3] ^ key[1];
+        ctr[3] = lo0;
+
+        key[0] += PhiloxW0;
+        key[1] += PhiloxW1;
+    }
+
+    for(int i = 0; i < 4; ++i) { f_Block[i] = ctr[i]; }
+
+    ++f_Position;
+    f_BlockIndex = 0;
+}
+
+std::uint32_t RandomStream::NextWord()
+{
+    if(f_BlockIndex == 4) { NextBlock(); }
+    return f_Block[f_BlockIndex++];
+}
@@ -0,0 +1,48 @@
+// Daniel Michelin
+
+#ifndef RANDOMSTREAM_HPP
+#define RANDOMSTREAM_HPP
+#include <cstdint>
+
+//Counter-based generator (Philox4x32-10): every draw is a pure function of (seed, stream, position),
+//so there's no shared state and any stream can be recreated anywhere, in any order.
+//Each event gets its own stream, i.e. RandomStream{seed, eventIndex}, which makes the generated events
+//the same whatever the number of threads or the order the events are generated in.
+class RandomStream
+{
+public:
+  RandomStream(std::uint64_t seed, std::uint64_t streamID); //parametric constructor
+
+  double Rndm(); //uniform in (0,1), both ends excluded
+  double Exp(double tau); //exponential with mean tau
+  double Gaus(double mean = 0., double sigma = 1.);
+  double Gamma(double shape, double scale = 1.);
+  int Poisson(double mean);
+
+  std::uint64_t getSeed() const;
+  std::uint64_t getStreamID() const;
+  std::uint64_t getPosition() const; //number of 128 bit blocks consumed so far
+
+  static std::uint64_t MakeSeed(); //non-deterministic seed, for when the user doesn't pass one
+  static double UniformFromBits(std::uint64_t bits); //what Rndm() makes of 53 random bits, 0 <= bits < 2^53: always in (0,1)
+
+
+protected:
+
+
+private:
+  std::uint64_t const f_Seed;
+  std::uint64_t const f_StreamID;
+  std::uint64_t f_Position;
+
+  std::uint32_t f_Block[4]; //output of the last generated block
+  int f_BlockIndex; //next unused word of f_Block
+
+  double f_SpareGaus; //Gaus() makes two numbers per call
+  bool f_HasSpareGaus;
+
+  void NextBlock();
+  std::uint32_t NextWord();
+};
+
+#endif
@@ -0,0 +1,153 @@
+// Daniel Michelin
+
+#include "RootOutput.hpp"
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//ROOT headers
+#include "TH1F.h"
+#include "TFile.h"
+#include "TObjString.h"
+
+
+TH1F* MakeTH1F(HistogramDefinition const& definition)
+{
+    TH1F* histo = new TH1F{definition.name.c_str(), definition.title.c_str(), definition.nbins, definition.xmin, definition.xmax};
+
+    for(UInt_t i = 0; i < definition.binLabels.size(); ++i)
+    {
+        histo->GetXaxis()->SetBinLabel(i+1, definition.binLabels[i].c_str());
+    }
+
+    return histo;
+}
+
+void CopyToTH1F(FastHistogram const& source, TH1F* histo)
+{
+    histo->Reset();
+
+    if(source.hasSumw2() && histo->GetSumw2N() == 0) { histo->Sumw2(); } //weighted histogram: the errors come from the squared weights
+
+    for(Int_t bin = 0; bin <= source.getNbins() + 1; ++bin)
+    {
+        histo->SetBinContent(bin, source.getBinContent(bin));
+        if(source.hasSumw2()) { histo->SetBinError(bin, source.getBinError(bin)); }
+    }
+
+    // SetBinContent() changes the statistics and the entries, so they're put back afterwards
+    Double_t stats[4];
+    source.getStats(stats);
+    histo->PutStats(stats);
+    histo->SetEntries(source.getEntries());
+}
+
+FastHistogram CopyFromTH1F(TH1F* source)
+{
+    Int_t const nbins = source->GetNbinsX();
+    FastHistogram histo{nbins, source->GetXaxis()->GetXmin(), source->GetXaxis()->GetXmax()};
+
+    for(Int_t bin = 0; bin <= nbins + 1; ++bin)
+    {
+        histo.setBinContent(bin, source->GetBinContent(bin));
+        if(source->GetSumw2N() > 0) { histo.setBinSumw2(bin, source->GetBinError(bin) * source->GetBinError(bin)); }
+    }
+
+    Double_t stats[4];
+    source->GetStats(stats);
+    histo.putStats(stats);
+    histo.setEntries(source->GetEntries());
+
+    return histo;
+}
+
+bool WriteHistogramsToRoot(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                           std::vector<GenerationRun> const& runs)
+{
+    TFile* file = new TFile{fileName.c_str(), "RECREATE"};
+    if(file->IsZombie())
+    {
+        std::cout << "Cannot open \"" << fileName << "\" for writing\n";
+        delete file;
+        return false;
+    }
+
+    for(UInt_t i = 0; i < histos.size(); ++i)
+    {
+        TH1F* histo = MakeTH1F(definitions[i]); //owned by the file, which deletes it when closed
+
+        CopyToTH1F(histos[i], histo);
+        histo->Write();
+    }
+
+    // One line per run: seed, shard index, number of shards, first and last event
+    std::ostringstream runsText;
+    for(GenerationRun const& run : runs)
+    {
+        runsText << run.seed << ' ' << run.shardIndex << ' ' << run.shardsNum << ' ' << run.firstEvent << ' ' << run.lastEvent << '\n';
+    }
+    TObjString runsString{runsText.str().c_str()};
+    runsString.Write(RootRunsName);
+
+    delete file;
+
+    return true;
+}
+
+bool WriteHistogramsToRoot(std::string const& fileName, GenerationHistograms const& histos)
+{
+    return WriteHistogramsToRoot(fileName, GetHistogramDefinitions(), histos.getHistograms(), histos.getRuns());
+}
+
+bool ReadHistogramsFromRoot(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                            std::vector<GenerationRun>* runs)
+{
+    TFile file{fileName.c_str(), "READ"};
+    if(file.IsZombie())
+    {
+        std::cout << "Cannot open \"" << fileName << "\"\n";
+        return false;
+    }
+
+    std::vector<FastHistogram> read{histos}; //filled on the side, so that 'histos' is left as it is if something goes wrong
+
+    for(UInt_t i = 0; i < definitions.size() && i < read.size(); ++i)
+    {
+        TH1F* const histo = file.Get<TH1F>(definitions[i].name.c_str());
+        if(histo == nullptr)
+        {
+            std::cout << "\"" << fileName << "\" has no histogram \"" << definitions[i].name << "\"\n";
+            return false;
+        }
+        if(histo->GetNbinsX() != read[i].getNbins() || histo->GetXaxis()->GetXmin() != read[i].getXmin() || histo->GetXaxis()->GetXmax() != read[i].getXmax())
+        {
+            std::cout << "Histogram \"" << definitions[i].name << "\" in \"" << fileName << "\" has a different binning\n";
+            return false;
+        }
+
+        read[i] = CopyFromTH1F(histo);
+    }
+
+    // Runs, none in the files written before they were recorded
+    std::vector<GenerationRun> readRuns;
+    if(TObjString* const runsString = file.Get<TObjString>(RootRunsName))
+    {
+        std::istringstream runsText{runsString->GetString().Data()};
+        GenerationRun run;
+        while(runsText >> run.seed >> run.shardIndex >> run.shardsNum >> run.firstEvent >> run.lastEvent) { readRuns.push_back(run); }
+        if(!runsText.eof())
+        {
+            std::cout << "\"" << fileName << "\" has unreadable runs\n";
+            return false;
+        }
+    }
+
+    histos = read;
+    if(runs != nullptr) { *runs = readRuns; }
+    return true;
+}
+
+bool ReadHistogramsFromRoot(std::string const& fileName, GenerationHistograms& histos)
+{
+    return ReadHistogramsFromRoot(fileName, GetHistogramDefinitions(), histos.getHistograms(), &histos.getRuns());
+}
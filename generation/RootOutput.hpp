@@ -0,0 +1,42 @@
+// Daniel Michelin
+
+#ifndef ROOTOUTPUT_HPP
+#define ROOTOUTPUT_HPP
+#include "GenerationHistograms.hpp"
+#include <string>
+#include <vector>
+
+//ROOT output backend, which also reads its files back: the only part of the generation that needs ROOT
+//Not built into the library unless ROOT is available (see the Makefile)
+
+class TH1F;
+
+//New TH1F with the name, title, binning and bin labels of the definition
+TH1F* MakeTH1F(HistogramDefinition const& definition);
+
+//Overwrites the contents of a TH1F (name, title, binning and labels are kept) with the ones of a FastHistogram
+//The bins of a TH1F are floats, which count exactly only up to 2^24 = 16777216: past that, the TH1F gets the double
+//contents of the FastHistogram rounded to float (within 6e-8), while a TH1F filled directly would stop counting (1 added
+//to 2^24 in float is still 2^24). The statistics and the sums of squared weights are doubles in both, so they're exact.
+void CopyToTH1F(FastHistogram const& source, TH1F* histo);
+
+//The other way round: a FastHistogram with the binning, contents, errors and statistics of a TH1F
+FastHistogram CopyFromTH1F(TH1F* source);
+
+//Name of the TObjString holding the runs of a file, one line "seed shardIndex shardsNum firstEvent lastEvent" for each
+char const* const RootRunsName = "generationRuns";
+
+//Writes histos[i] to a new ROOT file as a TH1F made from definitions[i], and the runs; returns false, printing why, if the
+//file can't be written
+bool WriteHistogramsToRoot(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram> const& histos,
+                           std::vector<GenerationRun> const& runs = {});
+bool WriteHistogramsToRoot(std::string const& fileName, GenerationHistograms const& histos); //with the definitions of the generation
+
+//Reads the TH1F named as definitions[i] into histos[i], for every i, e.g. to add more events to a file written before, and
+//the runs into 'runs', if not nullptr (none for files written before they were recorded); returns false, printing why and
+//leaving 'histos' and 'runs' untouched, if the file can't be read or doesn't have all the histograms with the same binning
+bool ReadHistogramsFromRoot(std::string const& fileName, std::vector<HistogramDefinition> const& definitions, std::vector<FastHistogram>& histos,
+                            std::vector<GenerationRun>* runs = nullptr);
+bool ReadHistogramsFromRoot(std::string const& fileName, GenerationHistograms& histos);
+
+#endif
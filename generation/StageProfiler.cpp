@@ -0,0 +1,328 @@
+// Daniel Michelin
+
+#include "StageProfiler.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+
+char const* GetStageName(int stage)
+{
+    static char const* const names[NumProfiledStages] = {"Sampling", "Decay", "PairLoop", "HistogramFilling", "EventStore", "OutputWrite"};
+    return (stage >= 0 && stage < NumProfiledStages) ? names[stage] : "Unknown";
+}
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+// ThreadProfile //
+
+ThreadProfile::ThreadProfile(Clock::time_point origin, int maxTraceEvents) :
+    f_Origin{origin},
+    f_MaxTraceEvents{maxTraceEvents},
+    f_UseHardwareCounters{false},
+    f_HardwareAvailable{0}
+    {}
+
+void ThreadProfile::AddTime(int stage, Clock::time_point start, Clock::time_point end)
+{
+    f_Totals[stage].seconds += std::chrono::duration<double>(end - start).count();
+    ++f_Totals[stage].calls;
+
+    if((int)f_Trace.size() < f_MaxTraceEvents)
+    {
+        f_Trace.push_back(TraceEvent{stage, std::chrono::duration_cast<std::chrono::nanoseconds>(start - f_Origin).count(),
+                                     std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()});
+    }
+}
+
+void ThreadProfile::AddCounters(int stage, std::uint64_t const* start, HardwareCounterTimes const& startTimes, std::uint64_t const* end, HardwareCounterTimes const& endTimes)
+{
+    StageTotals& totals = f_Totals[stage];
+    ++totals.countedCalls;
+
+    std::uint64_t const enabled = endTimes.enabled - startTimes.enabled;
+    std::uint64_t const running = endTimes.running - startTimes.running;
+    if(running == 0) //multiplexed out for the whole call: nothing to scale
+    {
+        ++totals.notRunningCalls;
+        return;
+    }
+
+    totals.enabledNs += enabled;
+    totals.runningNs += running;
+    double const scale = (double)enabled / (double)running;
+    for(int c = 0; c < NumHardwareCounters; ++c) { totals.counters[c] += (std::uint64_t)std::llround((end[c] - start[c]) * scale); }
+}
+
+void ThreadProfile::Count(int stage, long long items) { f_Totals[stage].items += items; }
+
+void ThreadProfile::Reset()
+{
+    for(StageTotals& totals : f_Totals) { totals = StageTotals{}; }
+    f_Trace.clear();
+}
+
+bool ThreadProfile::AttachHardwareCounters()
+{
+    if(!f_UseHardwareCounters) { return false; }
+
+    f_Hardware.reset(new HardwareCounters);
+    if(!f_Hardware->Open())
+    {
+        f_HardwareError = f_Hardware->getError();
+        f_Hardware.reset();
+        return false;
+    }
+
+    f_HardwareThread = std::this_thread::get_id();
+    f_HardwareAvailable = 0;
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        if(f_Hardware->isAvailable(c)) { f_HardwareAvailable |= 1u << c; }
+    }
+    return true;
+}
+
+void ThreadProfile::DetachHardwareCounters() { f_Hardware.reset(); }
+
+bool ThreadProfile::hasHardwareCounters() const { return f_Hardware != nullptr && f_HardwareThread == std::this_thread::get_id(); }
+
+void ThreadProfile::ReadHardwareCounters(std::uint64_t* values, HardwareCounterTimes* times) const { f_Hardware->Read(values, times); }
+
+StageTotals const& ThreadProfile::getTotals(int stage) const { return f_Totals[stage]; }
+
+
+// ScopedStageTimer //
+
+ScopedStageTimer::ScopedStageTimer(ThreadProfile* profile, int stage) :
+    f_Profile{profile},
+    f_Stage{stage},
+    f_ReadsCounters{profile != nullptr && profile->hasHardwareCounters()}
+{
+    if(f_ReadsCounters) { f_Profile->ReadHardwareCounters(f_StartCounters, &f_StartTimes); }
+    if(f_Profile != nullptr) { f_Start = ThreadProfile::Clock::now(); }
+}
+
+ScopedStageTimer::~ScopedStageTimer()
+{
+    if(f_Profile == nullptr) { return; }
+
+    f_Profile->AddTime(f_Stage, f_Start, ThreadProfile::Clock::now());
+    if(f_ReadsCounters)
+    {
+        std::uint64_t endCounters[NumHardwareCounters];
+        HardwareCounterTimes endTimes;
+        f_Profile->ReadHardwareCounters(endCounters, &endTimes);
+        f_Profile->AddCounters(f_Stage, f_StartCounters, f_StartTimes, endCounters, endTimes);
+    }
+}
+
+
+// StageProfiler //
+
+StageProfiler::StageProfiler(int threadsNum, int maxTraceEvents) :
+    f_Origin{ThreadProfile::Clock::now()},
+    f_MaxTraceEvents{maxTraceEvents},
+    f_UseHardwareCounters{false}
+{
+    Resize(threadsNum);
+}
+
+void StageProfiler::Resize(int threadsNum)
+{
+    while((int)f_Threads.size() < threadsNum)
+    {
+        f_Threads.push_back(ThreadProfile{f_Origin, f_MaxTraceEvents});
+        f_Threads.back().f_UseHardwareCounters = f_UseHardwareCounters;
+    }
+}
+
+void StageProfiler::Reset()
+{
+    f_Origin = ThreadProfile::Clock::now();
+    for(ThreadProfile& thread : f_Threads)
+    {
+        thread.Reset();
+        thread.f_Origin = f_Origin;
+        thread.f_HardwareError.clear();
+        thread.f_HardwareAvailable = 0;
+    }
+}
+
+void StageProfiler::setHardwareCounters(bool use)
+{
+    f_UseHardwareCounters = use;
+    for(ThreadProfile& thread : f_Threads) { thread.f_UseHardwareCounters = use; }
+}
+
+int StageProfiler::getThreadsNum() const { return f_Threads.size(); }
+
+ThreadProfile* StageProfiler::getThreadProfile(int thread)
+{
+    return (thread >= 0 && thread < (int)f_Threads.size()) ? &f_Threads[thread] : nullptr;
+}
+
+StageTotals StageProfiler::getTotals(int stage) const
+{
+    StageTotals totals;
+    for(ThreadProfile const& thread : f_Threads)
+    {
+        totals.seconds += thread.f_Totals[stage].seconds;
+        totals.calls += thread.f_Totals[stage].calls;
+        totals.items += thread.f_Totals[stage].items;
+        totals.countedCalls += thread.f_Totals[stage].countedCalls;
+        totals.notRunningCalls += thread.f_Totals[stage].notRunningCalls;
+        for(int c = 0; c < NumHardwareCounters; ++c) { totals.counters[c] += thread.f_Totals[stage].counters[c]; }
+        totals.enabledNs += thread.f_Totals[stage].enabledNs;
+        totals.runningNs += thread.f_Totals[stage].runningNs;
+    }
+    return totals;
+}
+
+void StageProfiler::PrintSummary(std::ostream& output) const
+{
+    double allStagesSeconds = 0.;
+    for(int s = 0; s < NumProfiledStages; ++s) { allStagesSeconds += getTotals(s).seconds; }
+
+    std::ios_base::fmtflags const flags = output.flags();
+    std::streamsize const precision = output.precision();
+    output << std::fixed;
+
+    output << "\n = Time per stage (" << f_Threads.size() << " threads; times are summed over the threads) =\n"
+           << std::left << std::setw(18) << "Stage" << std::right << std::setw(12) << "time [s]" << std::setw(9) << "share"
+           << std::setw(16) << "max thread [s]" << std::setw(12) << "calls" << std::setw(14) << "items" << std::setw(12) << "ns/item" << '\n';
+    for(int s = 0; s < NumProfiledStages; ++s)
+    {
+        StageTotals const totals = getTotals(s);
+        double maxThreadSeconds = 0.;
+        for(ThreadProfile const& thread : f_Threads)
+        {
+            if(thread.f_Totals[s].seconds > maxThreadSeconds) { maxThreadSeconds = thread.f_Totals[s].seconds; }
+        }
+
+        output << std::left << std::setw(18) << GetStageName(s) << std::right << std::setprecision(4) << std::setw(12) << totals.seconds
+               << std::setprecision(1) << std::setw(8) << (allStagesSeconds > 0. ? 100. * totals.seconds / allStagesSeconds : 0.) << '%'
+               << std::setprecision(4) << std::setw(16) << maxThreadSeconds << std::setw(12) << totals.calls << std::setw(14) << totals.items
+               << std::setprecision(1) << std::setw(12) << (totals.items > 0 ? 1e9 * totals.seconds / totals.items : 0.) << '\n';
+    }
+
+    // Same times, thread by thread: an unbalanced load shows up as a thread with much more time than the others
+    output << std::left << std::setw(8) << "Thread" << std::right;
+    for(int s = 0; s < NumProfiledStages; ++s) { output << std::setw(18) << GetStageName(s); }
+    output << '\n' << std::setprecision(4);
+    for(unsigned t = 0; t < f_Threads.size(); ++t)
+    {
+        output << std::left << std::setw(8) << t << std::right;
+        for(int s = 0; s < NumProfiledStages; ++s) { output << std::setw(18) << f_Threads[t].f_Totals[s].seconds; }
+        output << '\n';
+    }
+
+    if(f_UseHardwareCounters) { PrintHardwareCounters(output); }
+
+    output.flags(flags);
+    output.precision(precision);
+}
+
+// Trace Event Format: one complete event ("ph": "X") per timed scope, with times in microseconds
+bool StageProfiler::WriteChromeTrace(std::string const& fileName) const
+{
+    std::ofstream file{fileName};
+    if(!file)
+    {
+        std::cout << "Cannot open \"" << fileName << "\" to write the trace\n";
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"generation\"}}";
+    for(unsigned t = 0; t < f_Threads.size(); ++t)
+    {
+        file << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t << ", \"args\": {\"name\": \"thread " << t << "\"}}";
+    }
+
+    file << std::fixed << std::setprecision(3);
+    for(unsigned t = 0; t < f_Threads.size(); ++t)
+    {
+        for(ThreadProfile::TraceEvent const& event : f_Threads[t].f_Trace)
+        {
+            file << ",\n{\"name\": \"" << GetStageName(event.stage) << "\", \"cat\": \"generation\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t
+                 << ", \"ts\": " << event.start * 1e-3 << ", \"dur\": " << event.duration * 1e-3 << '}';
+        }
+    }
+    file << "\n]}\n";
+
+    if(!file)
+    {
+        std::cout << "Error while writing the trace to \"" << fileName << "\"\n";
+        return false;
+    }
+    return true;
+}
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+// Ratios of the hardware counters, stage by stage: instructions per cycle, misses per thousand instructions and,
+// taking the calls of the sampling stage as the number of events, cycles and instructions per event; then the share of
+// the time the counters actually ran (below 100% if multiplexed, the counts being scaled up to the whole time)
+void StageProfiler::PrintHardwareCounters(std::ostream& output) const
+{
+    for(ThreadProfile const& thread : f_Threads)
+    {
+        if(!thread.f_HardwareError.empty())
+        {
+            output << "Hardware counters unavailable: " << thread.f_HardwareError << '\n';
+            return;
+        }
+    }
+
+    // A counter is shown only if every thread that read the counters had it
+    unsigned available = ~0u;
+    for(ThreadProfile const& thread : f_Threads)
+    {
+        if(thread.f_HardwareAvailable != 0) { available &= thread.f_HardwareAvailable; }
+    }
+    for(int c = 0; c < NumHardwareCounters; ++c)
+    {
+        if(!(available & (1u << c))) { output << "Hardware counter " << GetHardwareCounterName(c) << " unavailable\n"; }
+    }
+
+    long long const eventsNum = getTotals(Stage_Sampling).calls;
+
+    output << "\n = Hardware counters per stage (user space only) =\n"
+           << std::left << std::setw(18) << "Stage" << std::right << std::setw(8) << "IPC" << std::setw(14) << "L1d-miss/ki"
+           << std::setw(14) << "LLC-miss/ki" << std::setw(14) << "br-miss/ki" << std::setw(16) << "cycles/event" << std::setw(16) << "instr/event"
+           << std::setw(10) << "counted" << '\n';
+    for(int s = 0; s < NumProfiledStages; ++s)
+    {
+        StageTotals const totals = getTotals(s);
+        output << std::left << std::setw(18) << GetStageName(s) << std::right;
+        if(totals.countedCalls == 0)
+        {
+            output << std::setw(8) << "n/a" << '\n';
+            continue;
+        }
+        if(totals.runningNs == 0) //every call multiplexed out: no count to show
+        {
+            output << std::setw(8) << "n/a" << "  (the counters never ran during its " << totals.countedCalls << " calls)\n";
+            continue;
+        }
+
+        double const cycles = totals.counters[Counter_Cycles];
+        double const kiloInstructions = totals.counters[Counter_Instructions] * 1e-3;
+        auto const ratio = [](double numerator, double denominator) { return denominator > 0. ? numerator / denominator : 0.; }; //0 = not measured
+
+        output << std::setprecision(2) << std::setw(8) << ratio(totals.counters[Counter_Instructions], cycles)
+               << std::setprecision(3) << std::setw(14) << ratio(totals.counters[Counter_L1DMisses], kiloInstructions)
+               << std::setw(14) << ratio(totals.counters[Counter_LLCMisses], kiloInstructions)
+               << std::setw(14) << ratio(totals.counters[Counter_BranchMisses], kiloInstructions)
+               << std::setprecision(0) << std::setw(16) << ratio(cycles, eventsNum)
+               << std::setw(16) << ratio(totals.counters[Counter_Instructions], eventsNum)
+               << std::setprecision(1) << std::setw(9) << 100. * ratio(totals.runningNs, totals.enabledNs) << '%';
+        if(totals.notRunningCalls > 0) { output << "  (" << totals.notRunningCalls << " of " << totals.countedCalls << " calls not counted)"; }
+        output << '\n';
+    }
+}
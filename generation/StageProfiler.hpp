@@ -0,0 +1,161 @@
+// Daniel Michelin
+
+#ifndef STAGEPROFILER_HPP
+#define STAGEPROFILER_HPP
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include "HardwareCounters.hpp"
+
+//Where the time of a generation goes, stage by stage and thread by thread.
+//Every generation thread has its own ThreadProfile (no locks, no shared cache lines while the events are generated);
+//a ScopedStageTimer adds the time between its construction and its destruction to one stage of one ThreadProfile, and
+//Count() adds to the number of items (particles, pairs, ...) a stage has processed. Each timed scope costs two reads of
+//the steady clock, a few tens of nanoseconds, against the hundred microseconds or so of an event.
+//At the end, StageProfiler prints a summary table and writes the timed scopes as a Chrome trace (chrome://tracing or
+//https://ui.perfetto.dev), one row per thread. The trace keeps the first maxTraceEvents scopes of every thread.
+//With setHardwareCounters(true), every thread also reads the CPU counters of HardwareCounters.hpp at both ends of each
+//timed scope, and the summary adds instructions per cycle and misses per thousand instructions, stage by stage and per
+//event. The counters only count the thread that opened them (see ThreadProfile::AttachHardwareCounters()): scopes timed
+//on a profile from another thread, such as the final merge, get their time but no counts. Reading the counters costs
+//a system call per end of a scope, a few percent of the generation time. If the kernel multiplexes the counters, the
+//counts of every scope are scaled by the time the counters were enabled over the time they ran; the scopes during which
+//they didn't run at all are left out of the counts, and the summary tells how many there were.
+
+enum ProfiledStage
+{
+  Stage_Sampling,         //multiplicity, types and impulses of the primary particles (items: particles)
+  Stage_Decay,            //decays of the resonances (items: decays)
+  Stage_PairLoop,         //invariant masses of all the pairs, histogram filling included (items: pairs)
+  Stage_HistogramFilling, //single particle and decay products histograms, and the merge of the threads' histograms (items: fills)
+  Stage_EventStore,       //copy of the events into the store chunks and writing of the chunks (items: events)
+  Stage_OutputWrite,      //writing of the histograms file (items: histograms)
+  NumProfiledStages
+};
+
+char const* GetStageName(int stage);
+
+int const DefaultMaxTraceEvents = 100000; //per thread: about 11 MB of JSON each
+
+//Time and items of one stage
+struct StageTotals
+{
+  double seconds = 0.;
+  long long calls = 0;
+  long long items = 0;
+  long long countedCalls = 0; //calls with the hardware counters read
+  long long notRunningCalls = 0; //of those, calls during which the counters didn't run, so left out of the counts
+  std::uint64_t counters[NumHardwareCounters] = {}; //scaled by enabled / running, call by call
+  std::uint64_t enabledNs = 0; //time the counters were enabled and running during the counted calls
+  std::uint64_t runningNs = 0;
+};
+
+
+//Stages of one thread; not thread-safe: only its own thread uses it while the events are generated
+class alignas(64) ThreadProfile //on cache lines of its own
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ThreadProfile(Clock::time_point origin, int maxTraceEvents = DefaultMaxTraceEvents); //trace times are counted from 'origin'
+
+  void AddTime(int stage, Clock::time_point start, Clock::time_point end);
+  void AddCounters(int stage, std::uint64_t const* start, HardwareCounterTimes const& startTimes, std::uint64_t const* end, HardwareCounterTimes const& endTimes);
+  void Count(int stage, long long items);
+  void Reset();
+
+  //Opens the hardware counters of the calling thread, if the profiler asks for them, and ties them to it; returns
+  //false if they can't be opened (the reason goes into the summary). Detach when the thread has finished its work.
+  bool AttachHardwareCounters();
+  void DetachHardwareCounters();
+  bool hasHardwareCounters() const; //true only on the thread the counters are attached to
+  void ReadHardwareCounters(std::uint64_t* values, HardwareCounterTimes* times) const;
+
+  StageTotals const& getTotals(int stage) const;
+
+
+protected:
+
+
+private:
+  friend class StageProfiler;
+
+  struct TraceEvent
+  {
+    int stage;
+    long long start; //nanoseconds from the origin
+    long long duration;
+  };
+
+  Clock::time_point f_Origin;
+  int f_MaxTraceEvents;
+  StageTotals f_Totals[NumProfiledStages];
+  std::vector<TraceEvent> f_Trace;
+
+  bool f_UseHardwareCounters;
+  std::unique_ptr<HardwareCounters> f_Hardware; //nullptr while not attached
+  std::thread::id f_HardwareThread;
+  unsigned f_HardwareAvailable; //bit c: counter c could be opened
+  std::string f_HardwareError;
+};
+
+
+//Adds the time of its own lifetime to a stage; does nothing with a nullptr profile, so the timers can stay in the code
+class ScopedStageTimer
+{
+public:
+  ScopedStageTimer(ThreadProfile* profile, int stage);
+  ~ScopedStageTimer();
+
+  ScopedStageTimer(ScopedStageTimer const&) = delete;
+  ScopedStageTimer& operator=(ScopedStageTimer const&) = delete;
+
+
+protected:
+
+
+private:
+  ThreadProfile* f_Profile;
+  int f_Stage;
+  bool f_ReadsCounters;
+  ThreadProfile::Clock::time_point f_Start;
+  std::uint64_t f_StartCounters[NumHardwareCounters];
+  HardwareCounterTimes f_StartTimes;
+};
+
+
+//The profiles of all the threads of a run, with the summary and the trace
+class StageProfiler
+{
+public:
+  StageProfiler(int threadsNum = 1, int maxTraceEvents = DefaultMaxTraceEvents);
+
+  void Resize(int threadsNum); //keeps the profiles already there, which the generator calls before starting its threads
+  void Reset();
+  void setHardwareCounters(bool use); //reads the CPU counters too, on the threads that attach them (off by default)
+
+  int getThreadsNum() const;
+  ThreadProfile* getThreadProfile(int thread); //nullptr if 'thread' is out of range
+  StageTotals getTotals(int stage) const; //summed over the threads
+
+  void PrintSummary(std::ostream& output) const;
+  bool WriteChromeTrace(std::string const& fileName) const; //returns false, printing why, if the file can't be written
+
+
+protected:
+
+
+private:
+  ThreadProfile::Clock::time_point f_Origin;
+  int f_MaxTraceEvents;
+  bool f_UseHardwareCounters;
+  std::vector<ThreadProfile> f_Threads;
+
+  void PrintHardwareCounters(std::ostream& output) const;
+};
+
+#endif
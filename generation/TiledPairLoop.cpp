@@ -0,0 +1,218 @@
+// Daniel Michelin
+
+#include "TiledPairLoop.hpp"
+#include <algorithm>
+
+
+/////////////////////
+// PUBLIC ELEMENTS //
+
+PairHelperPool::PairHelperPool(int helpersNum, int maxPartsNum) :
+    f_Mutex{},
+    f_PartQueued{},
+    f_PartDone{},
+    f_QueuedParts{},
+    f_IsStopping{false},
+    f_Helpers{}
+{
+    f_QueuedParts.reserve(maxPartsNum > 0 ? maxPartsNum : 1);
+    for(int t = 0; t < helpersNum; ++t) { f_Helpers.emplace_back(&PairHelperPool::HelperLoop, this); }
+}
+
+PairHelperPool::~PairHelperPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{f_Mutex};
+        f_IsStopping = true;
+    }
+    f_PartQueued.notify_all();
+    for(std::thread& helper : f_Helpers) { helper.join(); }
+}
+
+bool PairHelperPool::Submit(PairLoopPart* parts, int partsNum)
+{
+    {
+        std::lock_guard<std::mutex> lock{f_Mutex};
+        if(f_QueuedParts.size() + partsNum > f_QueuedParts.capacity()) { return false; } //no reallocation during the generation
+
+        for(int p = 0; p < partsNum; ++p)
+        {
+            parts[p].isDone = false;
+            f_QueuedParts.push_back(&parts[p]);
+        }
+    }
+    if(partsNum == 1) { f_PartQueued.notify_one(); }
+    else { f_PartQueued.notify_all(); }
+    return true;
+}
+
+void PairHelperPool::Finish(PairLoopPart* parts, int partsNum)
+{
+    std::unique_lock<std::mutex> lock{f_Mutex};
+    for(int p = 0; p < partsNum; ++p)
+    {
+        auto const queued = std::find(f_QueuedParts.begin(), f_QueuedParts.end(), &parts[p]);
+        if(queued == f_QueuedParts.end()) { continue; } //taken by a helper
+
+        f_QueuedParts.erase(queued);
+        lock.unlock();
+        parts[p].loop->FillPart(parts[p]);
+        lock.lock();
+        parts[p].isDone = true;
+    }
+
+    f_PartDone.wait(lock, [parts, partsNum]
+    {
+        for(int p = 0; p < partsNum; ++p) { if(!parts[p].isDone) { return false; } }
+        return true;
+    });
+}
+
+int PairHelperPool::getHelpersNum() const { return f_Helpers.size(); }
+
+
+TiledPairLoop::TiledPairLoop(PairCategoryTable const& pairCategories, int tileSize, int threadsNum, PairHelperPool* helpers, FastHistogram const* invMassBinning) :
+    f_PairCategories(pairCategories),
+    f_TileSize{tileSize > 0 ? tileSize : DefaultPairTileSize},
+    f_ThreadsNum{threadsNum > 0 ? threadsNum : 1},
+    f_Helpers{helpers},
+    f_Parts(f_ThreadsNum - 1),
+    f_Columns{nullptr},
+    f_SkippedSpecies{-1},
+    f_Weights{nullptr}
+{
+    for(int p = 0; p < (int)f_Parts.size(); ++p)
+    {
+        f_Parts[p].loop = this;
+        f_Parts[p].firstTile = p + 1;
+        if(invMassBinning != nullptr) { f_Parts[p].histos.assign(invMassBinning, invMassBinning + NumPairCategories); }
+    }
+}
+
+void TiledPairLoop::Fill(FourMomentumColumns const& columns, int skippedSpecies, FastHistogram* invMassHistos, PairWeights const* weights)
+{
+    int const groupsNum = (columns.size + f_TileSize - 1) / f_TileSize;
+
+    if(f_ThreadsNum == 1 || groupsNum <= 1)
+    {
+        FillTiles(columns, skippedSpecies, invMassHistos, weights, 0, 1);
+        return;
+    }
+
+    f_Columns = &columns;
+    f_SkippedSpecies = skippedSpecies;
+    f_Weights = weights;
+    for(PairLoopPart& part : f_Parts)
+    {
+        if(part.histos.empty()) { part.histos.assign(invMassHistos, invMassHistos + NumPairCategories); } //no binning given
+        for(FastHistogram& histo : part.histos) { histo.Reset(); }
+    }
+
+    bool const isShared = f_Helpers != nullptr && f_Helpers->Submit(f_Parts.data(), f_Parts.size());
+
+    FillTiles(columns, skippedSpecies, invMassHistos, weights, 0, f_ThreadsNum);
+
+    if(isShared) { f_Helpers->Finish(f_Parts.data(), f_Parts.size()); }
+    else
+    {
+        for(PairLoopPart& part : f_Parts) { FillPart(part); }
+    }
+
+    for(PairLoopPart const& part : f_Parts)
+    {
+        for(int h = 0; h < NumPairCategories; ++h) { invMassHistos[h].Add(part.histos[h]); }
+    }
+}
+
+void TiledPairLoop::FillPart(PairLoopPart& part) const
+{
+    FillTiles(*f_Columns, f_SkippedSpecies, part.histos.data(), f_Weights, part.firstTile, f_ThreadsNum);
+}
+
+int TiledPairLoop::getTileSize() const { return f_TileSize; }
+int TiledPairLoop::getThreadsNum() const { return f_ThreadsNum; }
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+// Fills the parts queued by the pair loops, oldest first, until the pool is destroyed
+void PairHelperPool::HelperLoop()
+{
+    std::unique_lock<std::mutex> lock{f_Mutex};
+    for(;;)
+    {
+        f_PartQueued.wait(lock, [this] { return f_IsStopping || !f_QueuedParts.empty(); });
+        if(f_QueuedParts.empty()) { return; } //stopping
+
+        PairLoopPart* const part = f_QueuedParts.front();
+        f_QueuedParts.erase(f_QueuedParts.begin());
+        lock.unlock();
+        part->loop->FillPart(*part);
+        lock.lock();
+        part->isDone = true;
+        f_PartDone.notify_all(); //the pair loops waiting for their parts
+    }
+}
+
+// Fills the histograms with the pairs of the tiles firstTile, firstTile + tileStep, firstTile + 2*tileStep, ...
+// The tiles are numbered row by row: (0,0), (0,1), ..., (0,groupsNum-1), (1,1), (1,2), ...
+void TiledPairLoop::FillTiles(FourMomentumColumns const& columns, int skippedSpecies, FastHistogram* invMassHistos, PairWeights const* weights, int firstTile, int tileStep) const
+{
+    int const size = columns.size;
+    int const groupsNum = (size + f_TileSize - 1) / f_TileSize;
+    int const numSpecies = f_PairCategories.getNumSpecies();
+
+    double invMasses[PairBlockSize]; //output of the pair kernel
+    int pairCodes[PairBlockSize];
+
+    int tile = 0;
+    for(int I = 0; I < groupsNum; ++I)
+    {
+        int const iFirst = I * f_TileSize;
+        int const iLast = (iFirst + f_TileSize < size) ? iFirst + f_TileSize : size;
+
+        for(int J = I; J < groupsNum; ++J, ++tile)
+        {
+            if(tile % tileStep != firstTile) { continue; }
+
+            int const jGroupFirst = J * f_TileSize;
+            int const jLast = (jGroupFirst + f_TileSize < size) ? jGroupFirst + f_TileSize : size;
+
+            for(int i = iFirst; i < iLast; ++i)
+            {
+                if(columns.speciesID[i] == skippedSpecies) { continue; }
+
+                int const jFirst = (I == J) ? i+1 : jGroupFirst; //on the diagonal, only the pairs i < j
+                for(int blockStart = jFirst; blockStart < jLast; blockStart += PairBlockSize)
+                {
+                    int const blockEnd = (blockStart + PairBlockSize < jLast) ? blockStart + PairBlockSize : jLast;
+                    InvMassBlock(columns, i, blockStart, blockEnd, numSpecies, invMasses, pairCodes);
+
+                    for(int k = 0; k < blockEnd - blockStart; ++k)
+                    {
+                        unsigned const mask = f_PairCategories.getMask(pairCodes[k]);
+                        if(mask == 0) { continue; }
+
+                        if(weights == nullptr)
+                        {
+                            for(int h = 0; h < NumPairCategories; ++h)
+                            {
+                                if(mask & (1u << h)) { invMassHistos[h].Fill(invMasses[k]); }
+                            }
+                            continue;
+                        }
+
+                        int const j = blockStart + k;
+                        bool const isSameDecay = weights->mother[i] >= 0 && weights->mother[i] == weights->mother[j];
+                        double const weight = isSameDecay ? weights->weight[i] : weights->weight[i] * weights->weight[j];
+                        for(int h = 0; h < NumPairCategories; ++h)
+                        {
+                            if(mask & (1u << h)) { invMassHistos[h].Fill(invMasses[k], weight); }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
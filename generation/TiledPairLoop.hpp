@@ -0,0 +1,120 @@
+// Daniel Michelin
+
+#ifndef TILEDPAIRLOOP_HPP
+#define TILEDPAIRLOOP_HPP
+#include "PairKernel.hpp"
+#include "PairCategoryTable.hpp"
+#include "FastHistogram.hpp"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Pair loop of an event, for any multiplicity.
+//The triangle of pairs i < j is cut into square tiles of tileSize x tileSize particles: tile (I, J), with I <= J, holds
+//the pairs whose first particle is in the I-th group of tileSize particles and the second one in the J-th group.
+//Inside a tile both groups stay in cache (about 36 bytes of columns per particle, i.e. 18 kB per group with the default
+//size), while the plain i < j loop walks the whole event for every particle once the event doesn't fit in L2 any more.
+//An event with at most tileSize particles is a single tile, and its pairs are visited in the same order as the plain loop.
+//
+//The tiles of a big event can also be shared between threadsNum parts, filled by the calling thread and by the helpers
+//of a PairHelperPool: tile t goes to part t % threadsNum, and every part but the first fills its own histograms, added to
+//the caller's ones in part order, so the results depend only on tileSize and threadsNum, not on the timing of the threads
+//nor on which thread filled which part. Events with a single tile are always filled by the calling thread alone.
+
+int const DefaultPairTileSize = 512;
+
+//Weights of the particles of a weighted generation (see GenerationConfig::resonanceEnhancement): a pair weighs
+//weight[i]*weight[j], or weight[i] alone when i and j are products of the same decay, since they come from a single draw
+struct PairWeights
+{
+  double const* weight;
+  int const* mother; //as EventBuffer::getMother()
+};
+
+class TiledPairLoop;
+
+//A share of the tiles of an event, with its own histograms (see TiledPairLoop::Fill())
+struct PairLoopPart
+{
+  TiledPairLoop const* loop = nullptr;
+  int firstTile = 0; //the part holds the tiles firstTile, firstTile + threadsNum, firstTile + 2*threadsNum, ...
+  std::vector<FastHistogram> histos; //NumPairCategories, with the binning of the caller's histograms
+  bool isDone = false; //guarded by the mutex of the pool
+};
+
+//Helper threads shared by the pair loops of all the threads of a generator. They are started once, with the pool, and
+//sleep until a pair loop hands them parts of an event: no thread is started, nor memory allocated, per event.
+//The parts are queued in a vector reserved for maxPartsNum of them; if the queue is full, the pair loop fills its parts itself.
+class PairHelperPool
+{
+public:
+  PairHelperPool(int helpersNum, int maxPartsNum);
+  ~PairHelperPool(); //wakes the helpers up and waits for them to stop
+  PairHelperPool(PairHelperPool const&) = delete;
+  PairHelperPool& operator=(PairHelperPool const&) = delete;
+
+  //Queues the parts for the helpers; returns false, with nothing queued, if there isn't room for all of them
+  bool Submit(PairLoopPart* parts, int partsNum);
+  //Fills in the calling thread the parts that no helper has taken yet, then waits until the other ones are done
+  void Finish(PairLoopPart* parts, int partsNum);
+
+  int getHelpersNum() const;
+
+
+protected:
+
+
+private:
+  std::mutex f_Mutex;
+  std::condition_variable f_PartQueued;
+  std::condition_variable f_PartDone;
+  std::vector<PairLoopPart*> f_QueuedParts; //oldest first
+  bool f_IsStopping;
+  std::vector<std::thread> f_Helpers;
+
+  void HelperLoop();
+};
+
+class TiledPairLoop
+{
+public:
+  //With threadsNum > 1, the tiles of the events bigger than a tile are shared with the helpers of 'helpers' (without a pool
+  //the calling thread fills every part itself, with the same results); 'invMassBinning' then gives the binning of the
+  //histograms of the parts (the NumPairCategories ones passed to Fill()), so that they are allocated here and not by Fill()
+  TiledPairLoop(PairCategoryTable const& pairCategories, int tileSize = DefaultPairTileSize, int threadsNum = 1,
+                PairHelperPool* helpers = nullptr, FastHistogram const* invMassBinning = nullptr);
+  TiledPairLoop(TiledPairLoop const&) = delete; //the parts point to their loop
+  TiledPairLoop& operator=(TiledPairLoop const&) = delete;
+
+  //Fills invMassHistos[k] with the masses of the pairs whose category mask has bit k set, for every pair i < j
+  //of 'columns'; the particles of species 'skippedSpecies' (the resonances, which don't enter) are left out as first particle
+  //of a pair, the second one is left out by its pair category mask. invMassHistos must be NumPairCategories long.
+  //With 'weights' the pairs are filled with their weights, without them with weight 1.
+  void Fill(FourMomentumColumns const& columns, int skippedSpecies, FastHistogram* invMassHistos, PairWeights const* weights = nullptr);
+
+  void FillPart(PairLoopPart& part) const; //the tiles of a part of the event being filled
+
+  int getTileSize() const;
+  int getThreadsNum() const;
+
+
+protected:
+
+
+private:
+  PairCategoryTable const& f_PairCategories;
+  int f_TileSize;
+  int f_ThreadsNum;
+  PairHelperPool* f_Helpers;
+  std::vector<PairLoopPart> f_Parts; //parts 1 to threadsNum - 1; part 0 is filled straight into the caller's histograms
+
+  //The event being filled, for FillPart()
+  FourMomentumColumns const* f_Columns;
+  int f_SkippedSpecies;
+  PairWeights const* f_Weights;
+
+  void FillTiles(FourMomentumColumns const& columns, int skippedSpecies, FastHistogram* invMassHistos, PairWeights const* weights, int firstTile, int tileStep) const;
+};
+
+#endif
@@ -0,0 +1,86 @@
+// Daniel Michelin
+
+#include "WorkStealingScheduler.hpp"
+
+
+WorkStealingScheduler::WorkStealingScheduler(int workersNum, int first, int last) :
+    f_Slices(workersNum > 0 ? workersNum : 1),
+    f_StealsNum{0}
+{
+    int const slicesNum = f_Slices.size();
+    long long const eventsNum = last > first ? last - first : 0;
+
+    for(int w = 0; w < slicesNum; ++w)
+    {
+        f_Slices[w].first = first + (int)((eventsNum * w) / slicesNum);
+        f_Slices[w].last = first + (int)((eventsNum * (w+1)) / slicesNum);
+    }
+}
+
+bool WorkStealingScheduler::NextChunk(int worker, int& first, int& last)
+{
+    Slice& own = f_Slices[worker];
+
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> lock{own.mutex};
+            int const left = own.last - own.first;
+            if(left > 0)
+            {
+                int chunkSize = left / 8;
+                if(chunkSize < 1) { chunkSize = 1; }
+                if(chunkSize > MaxChunkSize) { chunkSize = MaxChunkSize; }
+
+                first = own.first;
+                last = own.first + chunkSize;
+                own.first = last;
+                return true;
+            }
+        }
+
+        if(!Steal(worker)) { return false; }
+    }
+}
+
+int WorkStealingScheduler::getWorkersNum() const { return f_Slices.size(); }
+int WorkStealingScheduler::getStealsNum() const { return f_StealsNum; }
+
+
+/////////////////////
+// PRIVATE METHODS //
+
+// Moves the back half of another worker's slice into the thief's (empty) slice; returns false if every slice is empty
+// Only one lock is held at a time: a range being moved is briefly in no slice, but the thief then generates it anyway
+bool WorkStealingScheduler::Steal(int thief)
+{
+    int const slicesNum = f_Slices.size();
+
+    for(int i = 1; i < slicesNum; ++i)
+    {
+        Slice& victim = f_Slices[(thief + i) % slicesNum];
+
+        int stolenFirst;
+        int stolenLast;
+        {
+            std::lock_guard<std::mutex> lock{victim.mutex};
+            int const left = victim.last - victim.first;
+            if(left <= 0) { continue; }
+
+            stolenLast = victim.last;
+            stolenFirst = victim.last - (left + 1) / 2; //a single event left is taken too
+            victim.last = stolenFirst;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{f_Slices[thief].mutex};
+            f_Slices[thief].first = stolenFirst;
+            f_Slices[thief].last = stolenLast;
+        }
+
+        ++f_StealsNum;
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,47 @@
+// Daniel Michelin
+
+#ifndef WORKSTEALINGSCHEDULER_HPP
+#define WORKSTEALINGSCHEDULER_HPP
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+//Shares a range of events (or of blocks of events) out between the worker threads when the cost of the events varies a lot,
+//e.g. with a variable multiplicity, where the pair loop makes an event with 10 times the particles cost 100 times as much.
+//Every worker starts with an equal slice of the range and takes events from the front of its own slice,
+//in chunks that shrink as the slice empties (an eighth of what's left, at most MaxChunkSize):
+//big chunks while there's plenty of work, single events towards the end.
+//A worker whose slice is empty steals the back half of the slice of another worker, so no worker is idle
+//while there are events left anywhere. Each slice has its own lock, which is only contended during a steal.
+class WorkStealingScheduler
+{
+public:
+  WorkStealingScheduler(int workersNum, int first, int last); //splits the events [first, last) between the workers
+
+  //Gives worker 'worker' its next events, [first, last); returns false when there are no events left to generate
+  bool NextChunk(int worker, int& first, int& last);
+
+  int getWorkersNum() const;
+  int getStealsNum() const; //number of successful steals so far
+
+  static int const MaxChunkSize = 64;
+
+
+protected:
+
+
+private:
+  struct alignas(64) Slice //one per worker, on its own cache line
+  {
+    std::mutex mutex;
+    int first;
+    int last;
+  };
+
+  std::vector<Slice> f_Slices;
+  std::atomic<int> f_StealsNum;
+
+  bool Steal(int thief);
+};
+
+#endif
@@ -3,334 +3,420 @@
 #include "ParticleType.hpp"
 #include "ResonanceType.hpp"
 #include "Particle.hpp"
+#include "RandomStream.hpp"
+#include "AliasSampler.hpp"
+#include "GenerationHistograms.hpp"
+#include "EventStore.hpp"
+#include "EventGenerator.hpp"
+#include "GenerationCheckpoint.hpp"
+#include "StageProfiler.hpp"
+#include "RootOutput.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
+#include <thread>
+#include <algorithm>
 
 //ROOT headers
-#include "TMath.h"
 #include "TH1F.h"
 #include "TFile.h"
-#include "TRandom.h" //needed for gRandom
 #include "TSystem.h" //needed for gSystem
 #include "TROOT.h"
 #include "TBenchmark.h"
 
 
-Int_t executionCounter = 0;
+// The types are added by the generation library (see EventGenerator.cpp), which only fills the table if it's still empty:
+// loading the macro through ACLiC used to run this initialization twice, now the second run just finds the table full
+Int_t const NumParticleType = FillDefaultParticleTable(); //number of particles in the table
 
-// Adds all the following particles to the table and returns how many there are
-Int_t FillParticleTable()
+
+
+/////////////
+// Histograms
+/////////////
+
+// Same names, titles and binnings as the histograms filled by the generation library, see GenerationHistograms.cpp
+std::vector<HistogramDefinition> const histogramDefinitions = GetHistogramDefinitions();
+
+TH1F* histo_ParticleAbundancies = MakeTH1F(histogramDefinitions[Histo_ParticleAbundancies]);
+TH1F* histo_Theta = MakeTH1F(histogramDefinitions[Histo_Theta]);
+TH1F* histo_Phi = MakeTH1F(histogramDefinitions[Histo_Phi]);
+TH1F* histo_Impulse = MakeTH1F(histogramDefinitions[Histo_Impulse]);
+TH1F* histo_TransverseImpulse = MakeTH1F(histogramDefinitions[Histo_TransverseImpulse]);
+TH1F* histo_Energy = MakeTH1F(histogramDefinitions[Histo_Energy]);
+
+//In the general InvariantMass histogram ([0]) decayment products MUST NOT be included
+std::vector<TH1F*> invMassHistograms{
+MakeTH1F(histogramDefinitions[Histo_InvariantMass]),					// 0
+MakeTH1F(histogramDefinitions[Histo_InvMass_SameSign]),					// 1
+MakeTH1F(histogramDefinitions[Histo_InvMass_SameSign_PionKaon]),		// 2
+MakeTH1F(histogramDefinitions[Histo_InvMass_OppositeSign]),				// 3
+MakeTH1F(histogramDefinitions[Histo_InvMass_OppositeSign_PionKaon]),	// 4
+MakeTH1F(histogramDefinitions[Histo_InvMass_SameKProducts])				// 5
+};
+
+
+
+////////////
+// Functions
+////////////
+
+
+AliasSampler* particleSampler = new AliasSampler{DefaultAbundancies()}; //draws the type of every generated particle
+
+
+// Replaces the abundancies of the generated particles with the ones read from a file (see particleAbundancies.txt for the format)
+void LoadAbundancies(std::string const& fileName = "./generation/particleAbundancies.txt")
 {
-    /*
-    This goddamn function executes twice everytime I compile it via LoadMacro().
-    That's the reason for the executionCounter and the if{} block.
-    It literally executes twice for no reason. It gets called only once, to
-    initialize NumParticleType (see below the function end), because I tested it:
-    removing the only call (again, see below), it won't execute at all.
-    WHY DOES IT EXECUTE TWICE!??!?!??!?!?
-    I don't know what else to do. Several minutes of web search diddn't help, either.
-    */
-    if(executionCounter == 0)
+    std::vector<SpeciesAbundance> const abundancies = AliasSampler::ReadAbundancies(fileName);
+    if(abundancies.empty())
     {
-        //std::cout << "FillParticleTable() is executed" << '\n'; //FOR TESTING PURPOSES
-        std::cout << '\n';
+        std::cout << " No abundancies loaded: keeping the previous ones\n";
+        return;
+    }
+
+    delete particleSampler;
+    particleSampler = new AliasSampler{abundancies};
 
-        //add new types here
-        Particle::AddParticleType("Pion(+)", 0.13957, 1);
-        Particle::AddParticleType("Pion(-)", 0.13957, -1);
-        Particle::AddParticleType("Kaon(+)", 0.49367, 1);
-        Particle::AddParticleType("Kaon(-)", 0.49367, -1);
-        Particle::AddParticleType("Proton(+)", 0.93827, 1);
-        Particle::AddParticleType("Proton(-)", 0.93827, -1);
-        Particle::AddParticleType("K*", 0.89166, 0, 0.050);
-
-
-        //std::cout << "FillParticleTable() will soon return: " << Particle::getNumParticleType() << '\n' << '\n'; //FOR TESTING PURPOSES
-        
-        ++executionCounter;
-        
-        return Particle::getNumParticleType();
+    std::cout << " Abundancies loaded:\n";
+    for(Int_t i = 0; i < particleSampler->getNumSpecies(); ++i)
+    {
+        std::cout << "  " << Particle::getParticleType(particleSampler->getSpeciesID(i)) << ": " << particleSampler->getProbability(i) * 100 << "%\n";
     }
+}
+
+
+// Distribution of the number of particles per event used by GenerateEvents(), whose partPerEventNum becomes the mean
+MultiplicityModel multiplicityModel = Multiplicity_Fixed;
+Double_t multiplicityShape = 1.;
 
-    //std::cout << "2nd execution happened\n"; //FOR TESTING PURPOSES
-    return Particle::getNumParticleType();
+// Sets the distribution of the number of particles per event: "fixed", "poisson" or "negative-binomial" (with shape k)
+void SetMultiplicity(std::string const& model, Double_t k = 1.)
+{
+    if(model == "fixed") { multiplicityModel = Multiplicity_Fixed; }
+    else if(model == "poisson") { multiplicityModel = Multiplicity_Poisson; }
+    else if(model == "negative-binomial" && k > 0.) { multiplicityModel = Multiplicity_NegativeBinomial; }
+    else
+    {
+        std::cout << " Unknown multiplicity \"" << model << "\" (or k <= 0): keeping the previous one\n";
+        return;
+    }
 
+    multiplicityShape = k;
+    std::cout << " Multiplicity: " << model << '\n';
 }
 
-Int_t const NumParticleType = FillParticleTable(); //number of particles in the table
 
+// Importance sampling of the resonances used by GenerateEvents(), off (1) by default
+Double_t resonanceEnhancement = 1.;
 
+// Draws the resonances 'factor' times more often in the next generations, weighting every fill back (see EventGenerator.hpp):
+// the histograms estimate the same distributions, with the errors from the sums of the squared weights; 1 turns it off
+void SetResonanceEnhancement(Double_t factor = 10.)
+{
+    if(!(factor > 0.))
+    {
+        std::cout << " The enhancement must be positive: keeping the previous one\n";
+        return;
+    }
 
-/////////////
-// Histograms
-/////////////
+    resonanceEnhancement = factor;
+    std::cout << " Resonance enhancement: " << factor << '\n';
+}
 
-TH1F* histo_ParticleAbundancies = new TH1F{"histo_ParticleAbundancies", "Number of particles per type", NumParticleType, 0, 10};
-TH1F* histo_Theta = new TH1F{"histo_Theta_Distribution", "Distribution of azimutal coordinate theta", 500, 0, TMath::Pi()}; //suggested bin #: 100--1000
-TH1F* histo_Phi = new TH1F{"histo_Phi_Distribution", "Distribution of polar coordinate phi", 500, 0, 2*TMath::Pi()}; //suggested bin #: 100--1000
-TH1F* histo_Impulse = new TH1F{"histo_Impulse_Distribution", "Impulse distribution", 1000, 0, 10};
-TH1F* histo_TransverseImpulse = new TH1F{"histo_TransverseImpulse_Distribution", "Transverse impulse distribution", 1000, 0, 10};
-TH1F* histo_Energy = new TH1F{"histo_Energy_Distribution", "Particle energy distribution", 1000, 0, 10};
 
+// Adaptive run length of GenerateEvents(), off (0) by default
+Double_t targetPrecision = 0.;
+Int_t batchEventsNum = 1e5;
 
-Int_t const InvMassNbins = 80;
-Int_t const InvMassXmax = 2;
+// Makes the next generations stop as soon as the Gaussian fit of the K* peak (opposite - same sign Pion-Kaon, as in
+// AnalyseHistoDifference()) gives the mass and the width with a relative error below 'relativeError'; the fit is made
+// every 'batchEvents' events, and the eventsNum of GenerateEvents() becomes the most events generated. 0 turns it off
+void SetTargetPrecision(Double_t relativeError = 0.01, Int_t batchEvents = 1e5)
+{
+    if(relativeError < 0. || batchEvents <= 0)
+    {
+        std::cout << " The precision can't be negative, nor the batches empty: keeping the previous ones\n";
+        return;
+    }
 
-//In the general InvariantMass histogram ([0]) decayment products MUST NOT be included
-std::vector<TH1F*> invMassHistograms{
-new TH1F{"histo_InvariantMass", "Invariant mass between every particle", InvMassNbins, 0, InvMassXmax},							// 0
-new TH1F{"histo_InvMass_SameSign", "Invariant mass: concordant charge", InvMassNbins, 0, InvMassXmax},						    // 1
-new TH1F{"histo_InvMass_SameSign_PionKaon", "Invariant mass: Pion-Kaon concordant charge", InvMassNbins, 0, InvMassXmax},		// 2
-new TH1F{"histo_InvMass_OppositeSign", "Invariant mass: discordant charge", InvMassNbins, 0, InvMassXmax},						// 3
-new TH1F{"histo_InvMass_OppositeSign_PionKaon", "Invariant mass: Pion-Kaon discordant charge", InvMassNbins, 0, InvMassXmax},	// 4
-new TH1F{"histo_InvMass_SameKProducts", "Invariant mass: same K* decay products", InvMassNbins, 0, InvMassXmax}					// 5
-};
+    targetPrecision = relativeError;
+    batchEventsNum = batchEvents;
+    if(relativeError > 0.) { std::cout << " Target precision: " << relativeError * 100 << "%, checked every " << batchEvents << " events\n"; }
+    else { std::cout << " Target precision: off\n"; }
+}
 
 
+// Checkpoints of GenerateEvents(), off by default (see GenerationCheckpoint.hpp)
+std::string checkpointFile;
+Int_t checkpointEventsNum = 1e6;
 
-////////////
-// Functions
-////////////
+// Makes the next generations write their state to 'fileName' (in particles_output) every 'everyEvents' events, replacing the
+// previous one each time, so that ResumeEvents() can go on from there; with a target precision, the checkpoints follow its fits.
+// "" turns them off
+void SetCheckpoint(std::string const& fileName = "generation.ckpt", Int_t everyEvents = 1e6)
+{
+    if(everyEvents <= 0)
+    {
+        std::cout << " The checkpoints must be at least an event apart: keeping the previous ones\n";
+        return;
+    }
+
+    checkpointFile = fileName;
+    checkpointEventsNum = everyEvents;
+    if(!fileName.empty()) { std::cout << " Checkpoint: particles_output/" << fileName << ", every " << everyEvents << " events\n"; }
+    else { std::cout << " Checkpoint: off\n"; }
+}
 
 
-// Sets bin labels for Abundancies histogram, which are used as reference in the filling process
-void MakeBinLabelsParticleNames()
+// Pipelined generation, off by default (see EventGenerator.hpp)
+Int_t pipelineSamplingThreads = 0; //0 = off
+Int_t pipelineDecayThreads = 1;
+Int_t pipelinePairThreads = 1;
+Int_t pipelineQueueDepth = 64;
+
+// Makes the next generations run sampling, decays and pair loop as concurrent stages on their own threads, with queues of
+// 'queueDepth' events between them; the number of threads passed to GenerateEvents() is then unused. 0 sampling threads turn it off
+void SetPipeline(Int_t samplingThreads = 1, Int_t decayThreads = 1, Int_t pairThreads = 2, Int_t queueDepth = 64)
 {
-    for(Int_t i = 0; i < NumParticleType; ++i)
+    if(samplingThreads < 0 || decayThreads <= 0 || pairThreads <= 0 || queueDepth <= 0)
     {
-        histo_ParticleAbundancies->GetXaxis()->SetBinLabel(i+1, (Particle::getParticleType(i)).c_str());
+        std::cout << " Every stage needs a thread, and the queues room for an event: keeping the previous pipeline\n";
+        return;
     }
+
+    pipelineSamplingThreads = samplingThreads;
+    pipelineDecayThreads = decayThreads;
+    pipelinePairThreads = pairThreads;
+    pipelineQueueDepth = queueDepth;
+    if(samplingThreads > 0)
+    {
+        std::cout << " Pipeline: " << samplingThreads << " sampling, " << decayThreads << " decay, " << pairThreads << " pair loop threads, queues of "
+                  << queueDepth << " events\n";
+    }
+    else { std::cout << " Pipeline: off\n"; }
+}
+
+// Sets the pipeline of SetPipeline() in 'config'
+void ConfigurePipeline(GenerationConfig& config)
+{
+    config.pipelined = pipelineSamplingThreads > 0;
+    config.samplingThreadsNum = pipelineSamplingThreads;
+    config.decayThreadsNum = pipelineDecayThreads;
+    config.pairStageThreadsNum = pipelinePairThreads;
+    config.queueDepth = pipelineQueueDepth;
+}
+
+
+// Live snapshots of GenerateEvents(), off by default
+std::string snapshotFile;
+Int_t snapshotEventsNum = 1e6;
+
+// Makes the next generations write the histograms generated so far to 'fileName' (in particles_output) every 'everyEvents'
+// events, through a temporary file renamed over the previous snapshot: AttachHistograms() and RefreshHistograms() of the
+// analysis macro can follow a run while it's going. By default the snapshot is particleHistograms.root itself. "" turns them off
+void SetSnapshots(std::string const& fileName = "particleHistograms.root", Int_t everyEvents = 1e6)
+{
+    if(everyEvents <= 0)
+    {
+        std::cout << " The snapshots must be at least an event apart: keeping the previous ones\n";
+        return;
+    }
+
+    snapshotFile = fileName;
+    snapshotEventsNum = everyEvents;
+    if(!fileName.empty()) { std::cout << " Snapshots: particles_output/" << fileName << ", every " << everyEvents << " events\n"; }
+    else { std::cout << " Snapshots: off\n"; }
+}
+
+// Events between two fits, checkpoints or snapshots: the fits of a target precision set the pace, otherwise the more
+// frequent of the checkpoints and the snapshots
+Int_t GenerationBatchEvents()
+{
+    if(targetPrecision > 0.) { return batchEventsNum; }
+    if(!checkpointFile.empty() && !snapshotFile.empty()) { return std::min(checkpointEventsNum, snapshotEventsNum); }
+    return snapshotFile.empty() ? checkpointEventsNum : snapshotEventsNum;
+}
+
+
+// Stage profiling of GenerateEvents(), off by default (see StageProfiler.hpp)
+Bool_t isGenerationProfiled = false;
+Bool_t useHardwareCounters = false;
+std::string generationTraceFile;
+
+// Prints the time spent in every stage of the next generations, thread by thread, after the total given by gBenchmark;
+// if 'traceFile' isn't empty, also writes the timeline of the stages to that file (relative to particles_output), as a Chrome trace;
+// with 'hardwareCounters' the CPU counters of every stage are read too (Linux only: without them, only the times are given)
+void SetProfiling(Bool_t enable = true, std::string const& traceFile = "", Bool_t hardwareCounters = false)
+{
+    isGenerationProfiled = enable;
+    useHardwareCounters = enable && hardwareCounters;
+    generationTraceFile = enable ? traceFile : "";
 }
 
 
 // Randomly generates a particle type (i.e. the name of the particle)
-// Used in the main function
+// Only meant to check how the generation works: the main function draws the indexes directly from particleSampler
+RandomStream interactiveStream{RandomStream::MakeSeed(), 0}; //used when calling GenerateParticleName() from the ROOT console
 std::string GenerateParticleName()
 {
-	Double_t a = gRandom->Rndm();
-	
-	std::string name;
-	
-	if(a<0.01) //K* 1%
-    {
-    	name = "K*"; 
-	}
-	else
-	{     
-		// The other particles
-		
-		if(a<0.10) //Protons 9%
-		{
-			name = "Proton";
-		}
-		else
-		if(a<0.20) //Kaons 10%
-		{
-			name = "Kaon";
-		}
-		else //Pions 80%
-		{
-			name = "Pion";
-		}
-		
-		// setting the charge
-		std::string charge;		
-		if(gRandom->Rndm() < 0.50)
-		{
-			charge = "(+)";
-		}
-		else { charge = "(-)"; }
-		
-		name.append(charge);
-	}
-	
-	return name;
+    return Particle::getParticleType(particleSampler->Sample(interactiveStream));
 }
 
 
-// Main function
-void GenerateEvents(Int_t const eventsNum = 1e5, Int_t const partPerEventNum = 100) //default settings: 100k events with 100 particles per event
+// Runs the generation set up in 'generator', copies the histograms into the global ones and writes them to particles_output/particleHistograms.root
+// Used by GenerateEvents() and ResumeEvents()
+void RunGeneration(EventGenerator& generator)
 {
-    MakeBinLabelsParticleNames();
+    std::cout << "\nSeed: " << generator.getSeed();
+    if(generator.getFirstEventNum() > 0) { std::cout << "\nResuming from event " << generator.getFirstEventNum(); }
 
-    gRandom->SetSeed();
+    StageProfiler profiler{generator.getConfig().threadsNum};
+    profiler.setHardwareCounters(useHardwareCounters);
+    if(isGenerationProfiled) { generator.setProfiler(&profiler); }
+    generator.setSnapshotWriter(WriteHistogramsToRoot);
 
     //Before the following lines execute, the current directory should be the one containing the loading script
     gSystem->mkdir("./particles_output");
     gSystem->cd("particles_output");
-    
-    TFile* file = new TFile{"particleHistograms.root", "RECREATE"};
 
     std::cout << "\nGenerating events";
 
     gBenchmark->Start("Events generation");
 
-    //cycle that generates batches of particles and does all calculations EXCEPT the invariant mass 
-    for(Int_t eventCounter = 0; eventCounter < eventsNum; ++eventCounter) //event cycle
-    {
-        // Live progress bar
-        if(eventCounter % ((Int_t)(0.05 * eventsNum)) == 0)
-        {
-            Double_t fraction = ((Double_t)eventCounter / (Double_t)eventsNum) * 100;
-            std::cout << "..." << (Int_t)fraction << "%";
-            std::cout.flush();
-        }
+    GenerationHistograms const histos = generator.Run();
 
-        std::vector<Particle> particles; //vector that will be filled and emptied every event cycle
-        
-        for(Int_t particleCounter = 0; particleCounter < partPerEventNum; ++particleCounter) //batch of particles cycle
-        {
-            std::string particleName{GenerateParticleName()};
-            histo_ParticleAbundancies->Fill(particleName.c_str(), 1); //FILLING PARTICLE ABUNDANCIES HISTOGRAM through a defined bin label
-            
-            Double_t theta = gRandom->Rndm() * TMath::Pi(); //azimutal coordinate
-            Double_t phi = gRandom->Rndm() * 2 * TMath::Pi(); //polar coordinate
-            Double_t P = gRandom->Exp(1.); //impulse
-            
-            // Calculating impulse components through spherical coordinates
-            Double_t Px = P * TMath::Sin(theta) * TMath::Cos(phi);
-            Double_t Py = P * TMath::Sin(theta) * TMath::Sin(phi);
-            Double_t Pz = P * TMath::Cos(theta);
-            Double_t PTransverse = TMath::Sqrt(Px*Px + Py*Py);
-
-
-            Particle prtcl{particleName, Px, Py, Pz};
-            //prtcl.setIndex(particleName); //sets the ID of the instance --not necessary since ID is set at creation of the instance
-            Double_t energy = prtcl.ParticleEnergy();
-
-            histo_Theta->Fill(theta);
-            histo_Phi->Fill(phi);
-            histo_Impulse->Fill(P);
-            histo_TransverseImpulse->Fill(PTransverse);
-            histo_Energy->Fill(energy);
-
-            particles.push_back(prtcl); //puts the instance of "chosen" particle into the vector
-        }
-        
-        Int_t const K_ID = Particle::FindParticle_public("K*");
-        
-        Int_t const p = particles.size(); //p == number of particles present before any decayment
-        
-        // Cycle that makes K* decay and adds its products at the end of the vector
-        for(Int_t i = 0; i < p; ++i) 
-        {
-            if(particles[i].getIndex() == K_ID) //checks for K*
-            {
-            	std::string particleName1{"Pion"};
-            	std::string particleName2{"Kaon"};
-            	
-                if(gRandom->Rndm() < 0.50)
-                {
-                    particleName1.append("(+)");
-                    particleName2.append("(-)");
-                }
-                else
-                {
-                    particleName1.append("(-)");
-                    particleName2.append("(+)");
-                }
-
-                Particle dau1{particleName1};
-                Particle dau2{particleName2};
-                
-                particles[i].Decay2Body(dau1, dau2);
- 
-                particles.push_back(dau1);
-                particles.push_back(dau2);
-            }
-        }
+    CopyToTH1F(histos[Histo_ParticleAbundancies], histo_ParticleAbundancies);
+    CopyToTH1F(histos[Histo_Theta], histo_Theta);
+    CopyToTH1F(histos[Histo_Phi], histo_Phi);
+    CopyToTH1F(histos[Histo_Impulse], histo_Impulse);
+    CopyToTH1F(histos[Histo_TransverseImpulse], histo_TransverseImpulse);
+    CopyToTH1F(histos[Histo_Energy], histo_Energy);
 
-        Int_t const p2 = particles.size(); //p2 == number of particles present after all decayments
-     
-        // Invariant mass calculation and correspondent histogram filling -- K* must not be considered
-        for(Int_t i = 0; i < p2-1; ++i)
-        {
-        	if(particles[i].getIndex() != K_ID) //skipping K*
-        	{
-        		for(Int_t j = i+1; j < p2; ++j)
-            	{
-		        	if(particles[j].getIndex() != K_ID) //skipping K*
-		        	{
-                        //std::cout << "combination (i,j): " << i << "  " << j << '\n'; //FOR TESTING PURPOSES
-
-		        		Double_t invMass = particles[i].InvMass(particles[j]);
-				    	
-				    	invMassHistograms[0]->Fill(invMass); //FILLING GENERAL INVARIANT MASS HISTOGRAM
-
-                        Int_t const chargeProduct = particles[i].getCharge() * particles[j].getCharge();
-
-                        std::string particle1_name = particles[i].getName();
-                        std::string particle2_name = particles[j].getName();
-
-
-				    	//cycle that deletes the last three characters of the name, e.g.: "Kaon(+)" --> "Kaon"
-				    	for(Int_t g = 0; g < 3; ++g)  //DEPENDENT ON PARTICLE NAME
-				    	{
-				    		particle1_name.pop_back();
-				    		particle2_name.pop_back();
-				    	} //this cycle could be made a function: 'void RemoveChargeFromName(std::string& input)'
-				    	
-				    	if(chargeProduct > 0) //same sign --concordant charges
-				    	{
-				    		invMassHistograms[1]->Fill(invMass); //FILLING GENERAL SAME SIGN INVARIANT MASS HISTOGRAM
-				    		
-				    		if( (particle1_name == "Pion" && particle2_name == "Kaon") || (particle1_name == "Kaon" && particle2_name == "Pion") )
-				    		{
-				    			invMassHistograms[2]->Fill(invMass); //FILLING SAME SIGN PION/KAON HISTOGRAM
-				    		}
-				    	}
-				    	else
-				    	if(chargeProduct < 0) //opposite sign --discordant charges
-				    	{
-				    		invMassHistograms[3]->Fill(invMass); //FILLING GENERAL OPPOSITE SIGN INVARIANT MASS HISTOGRAM
-				    		
-				    		if( (particle1_name == "Pion" && particle2_name == "Kaon") || (particle1_name == "Kaon" && particle2_name == "Pion") )
-				    		{
-				    			invMassHistograms[4]->Fill(invMass); //FILLING OPPOSITE SIGN PION/KAON HISTOGRAM
-				    		}
-		        		}
-		        	}	
-		        }
-        	}
-        }
-        
-        // Invariant mass between decay products of the same K*
-        for(Int_t k = partPerEventNum; k < p2; k = k+2) //because the products have been put two by two at the end of the 'particles' vector
-        {
-        	Double_t invMassDecay = particles[k].InvMass(particles[k+1]);
-        	
-        	invMassHistograms[5]->Fill(invMassDecay); //FILLING INVARIANT MASS BETWEEN PRODUCTS OF THE SAME K* HISTOGRAM
-        }
-        
-    } //END OF EVENTS GENERATION; END OF THE for loop
+    for(UInt_t i = 0; i < invMassHistograms.size(); ++i)
+    {
+        CopyToTH1F(histos[Histo_InvariantMass + i], invMassHistograms[i]);
+    }
 
     std::cout << "...DONE\n";
+    if(generator.getConfig().targetPrecision > 0.)
+    {
+        GaussianFitResult const& fit = generator.getKaonStarFit();
+        std::cout << (generator.isTargetPrecisionReached() ? " Target precision reached after " : " <!> Target precision not reached in ")
+                  << generator.getGeneratedEventsNum() << " events";
+        if(fit.isValid) { std::cout << ": K* mass " << fit.mean << " +/- " << fit.meanError << ", width " << fit.sigma << " +/- " << fit.sigmaError; }
+        std::cout << '\n';
+    }
+    if(!generator.getConfig().checkpointFile.empty())
+    {
+        std::cout << " Checkpoint written to \"particles_output/" << generator.getConfig().checkpointFile << "\" (" << generator.getGeneratedEventsNum() << " events)\n";
+    }
     std::cout.flush();
 
+    if(generator.getConfig().pipelined) { PrintQueueStats(std::cout, generator.getQueueStats()); }
+
     gBenchmark->Show("Events generation");
     gBenchmark->Reset();
     std::cout << '\n';
     
 
     //SAVING ALL THE STUFF TO FILE
-    histo_ParticleAbundancies->Write();
-    histo_Theta->Write();
-    histo_Phi->Write();
-    histo_Impulse->Write();
-    histo_TransverseImpulse->Write();
-    histo_Energy->Write();
+    //The file is only opened now, so that a generation that doesn't finish leaves the previous one as it was, and it's
+    //written under a temporary name, then renamed, so that an analysis following the snapshots never reads half of it
+    {
+        ScopedStageTimer timer{isGenerationProfiled ? profiler.getThreadProfile(0) : nullptr, Stage_OutputWrite};
+
+        TFile* file = new TFile{"particleHistograms.root.tmp", "RECREATE"};
+
+        histo_ParticleAbundancies->Write();
+        histo_Theta->Write();
+        histo_Phi->Write();
+        histo_Impulse->Write();
+        histo_TransverseImpulse->Write();
+        histo_Energy->Write();
     
-    for(Int_t l = 0; l < ((Int_t)(invMassHistograms.size())); ++l) //saves invariant mass histograms
+        for(Int_t l = 0; l < ((Int_t)(invMassHistograms.size())); ++l) //saves invariant mass histograms
+        {
+        	invMassHistograms[l]->Write();
+        }
+
+        file->Write(); //Doesn't really seem to work, since the histograms are getting saved to file only through a '->Write()'
+
+        delete file;
+        gSystem->Rename("particleHistograms.root.tmp", "particleHistograms.root");
+    }
+
+    if(isGenerationProfiled)
     {
-    	invMassHistograms[l]->Write();
+        profiler.PrintSummary(std::cout);
+        if(!generationTraceFile.empty() && profiler.WriteChromeTrace(generationTraceFile))
+        {
+            std::cout << "Trace written to \"particles_output/" << generationTraceFile << "\"\n";
+        }
     }
 
-    file->Write(); //Doesn't really seem to work, since the histograms are getting saved to file only through a '->Write()'
+    gSystem->cd("..");
+}
 
-    delete file;
 
-    gSystem->cd("..");
+// Main function
+// The events are generated by the generation library (see EventGenerator.hpp), then copied into the global histograms and written to file
+// With threadsNum > 1 the events are shared out between the threads as they become free: each of them fills its own copy
+// of the histograms, and all the copies are added together once every thread has finished
+// The number of particles of every event follows the distribution set by SetMultiplicity(), fixed by default
+// Passing the same non-zero seed gives back the same histograms, whatever the number of threads; seed = 0 picks a new seed every run
+// If 'eventsFile' isn't empty, every generated particle is also written to that file (relative to particles_output), see EventStore.hpp
+// With a precision set by SetTargetPrecision(), eventsNum is the most events generated: the run stops when the K* fit is precise enough
+// With a checkpoint set by SetCheckpoint(), a run that doesn't finish can be taken up again with ResumeEvents()
+void GenerateEvents(Int_t const eventsNum = 1e5, Int_t const partPerEventNum = 100, Int_t const threadsNum = 1, ULong64_t seed = 0, std::string const& eventsFile = "") //default settings: 100k events with 100 particles per event, single thread
+{
+    GenerationConfig config;
+    config.eventsNum = eventsNum;
+    config.particlesPerEvent = partPerEventNum;
+    config.multiplicity = multiplicityModel;
+    config.multiplicityShape = multiplicityShape;
+    config.resonanceEnhancement = resonanceEnhancement;
+    config.targetPrecision = targetPrecision;
+    config.batchEventsNum = GenerationBatchEvents();
+    config.threadsNum = threadsNum;
+    config.seed = seed;
+    config.eventStoreFile = eventsFile;
+    config.checkpointFile = checkpointFile;
+    config.snapshotFile = snapshotFile;
+    ConfigurePipeline(config);
+
+    EventGenerator generator{config, *particleSampler};
+    RunGeneration(generator);
+}
+
+
+// Goes on with the run that wrote the checkpoint 'fileName' (in particles_output), with the same seed, up to eventsNum events in all:
+// a run that didn't finish is taken up from its last checkpoint, a finished one is extended with more events
+// The particles per event, the multiplicity and the enhancement are the ones of the checkpoint; the abundancies must be the same ones
+// The checkpoint keeps being updated, as set by SetCheckpoint() (by default, every 1e6 events)
+void ResumeEvents(std::string const& fileName, Int_t const eventsNum, Int_t const threadsNum = 1, std::string const& eventsFile = "")
+{
+    GenerationCheckpoint checkpoint;
+    if(!ReadCheckpoint("./particles_output/" + fileName, checkpoint)) { return; }
+
+    GenerationConfig config;
+    config.eventsNum = eventsNum;
+    config.particlesPerEvent = checkpoint.particlesPerEvent;
+    config.multiplicity = (MultiplicityModel)checkpoint.multiplicity;
+    config.multiplicityShape = checkpoint.multiplicityShape;
+    config.resonanceEnhancement = checkpoint.resonanceEnhancement;
+    config.targetPrecision = targetPrecision;
+    config.batchEventsNum = GenerationBatchEvents();
+    config.threadsNum = threadsNum;
+    config.eventStoreFile = eventsFile;
+    config.checkpointFile = fileName;
+    config.snapshotFile = snapshotFile;
+    ConfigurePipeline(config);
+
+    EventGenerator generator{config, *particleSampler};
+    if(!generator.Resume(checkpoint)) { return; }
+
+    RunGeneration(generator);
 }
 
 
@@ -338,6 +424,7 @@ void SetGenerationParameters()
 {
     Int_t events;
     Int_t particlesPerEvent;
+    Int_t threads;
 
     std::cout << "\nNOTE: don't put expressions such as '1e5', because it'll go in an infinite loop\n";
 
@@ -364,7 +451,18 @@ void SetGenerationParameters()
         }
     } while (!(particlesPerEvent > 0));
 
-    GenerateEvents(events, particlesPerEvent);
+    do
+    {
+        std::cout << "Insert how many threads will generate the events (available cores: " << std::thread::hardware_concurrency() << "): ";
+        std::cin >> threads;
+        if(!(threads > 0))
+        {
+            threads = 0;
+            std::cout << "<!> Incorrect input: must enter a positive value\n";
+        }
+    } while (!(threads > 0));
+
+    GenerateEvents(events, particlesPerEvent, threads);
 }
 
 
@@ -0,0 +1,364 @@
+// Daniel Michelin
+
+// Benchmarks of the generation: the kinematics of Particle in isolation, the particle type lookups, the pair loop at
+// several multiplicities and the whole generation, in events per second.
+// The results are written as JSON, so that runs of different versions on the same machine can be compared by a script.
+// Build it with 'make', run './build/benchmark_generation --help' (or 'make benchmark', which writes build/benchmark.json)
+
+#include "Particle.hpp"
+#include "RandomStream.hpp"
+#include "AliasSampler.hpp"
+#include "EventBuffer.hpp"
+#include "PairKernel.hpp"
+#include "PairCategoryTable.hpp"
+#include "FastHistogram.hpp"
+#include "GenerationHistograms.hpp"
+#include "TiledPairLoop.hpp"
+#include "EventGenerator.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <ctime>
+#include <cstdlib>
+#include <cmath>
+
+int const BenchmarkFormatVersion = 1; //bumped whenever a benchmark changes what it measures
+
+//Everything that can be set from the command line
+struct BenchmarkOptions
+{
+  std::string outputFile; //empty = standard output
+  std::string filter; //only the benchmarks whose name contains it
+  double minTime = 0.2; //seconds per repetition
+  int repetitions = 5;
+  int events = 2000; //per repetition of the whole generation
+  int threadsNum = 1; //of the whole generation
+};
+
+//Result of one benchmark: the time per operation of every repetition, where an operation is what the name says
+//(an invariant mass, a pair, an event, ...)
+struct BenchmarkResult
+{
+  std::string name;
+  std::string operation;
+  long long operationsPerRepetition;
+  std::vector<double> nsPerOperation; //one per repetition
+};
+
+
+void PrintUsage(char const* programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "Options:\n"
+              << "  --output FILE      writes the results there instead of the standard output, as JSON\n"
+              << "  --filter TEXT      only runs the benchmarks whose name contains TEXT\n"
+              << "  --min-time S       minimum duration of a repetition, in seconds (default: 0.2)\n"
+              << "  --repetitions N    repetitions of every benchmark; the median is the result (default: 5)\n"
+              << "  --events N         events per repetition of the whole generation (default: 2000)\n"
+              << "  --threads N        threads of the whole generation (default: 1)\n"
+              << "  --help             prints this message\n";
+}
+
+
+// Keeps the compiler from dropping a computation whose result isn't used otherwise
+volatile double benchmarkSink;
+
+
+// Times 'body', a callable doing 'operationsPerCall' operations and returning something computed from them:
+// the number of calls grows until they take at least minTime, then every repetition makes that many calls
+template<typename Body>
+BenchmarkResult Measure(BenchmarkOptions const& options, std::string const& name, std::string const& operation, long long operationsPerCall, Body body)
+{
+    using Clock = std::chrono::steady_clock;
+    double sink = 0.;
+
+    long long calls = 1;
+    for(;;)
+    {
+        auto const start = Clock::now();
+        for(long long c = 0; c < calls; ++c) { sink += body(); }
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if(seconds >= options.minTime || calls >= (1LL << 40)) { break; }
+        double const factor = (seconds > 0.01 * options.minTime) ? std::min(1.2 * options.minTime / seconds, 16.) : 16.;
+        calls = std::max(calls + 1, (long long)(calls * factor));
+    }
+
+    BenchmarkResult result{name, operation, calls * operationsPerCall, {}};
+    for(int r = 0; r < options.repetitions; ++r)
+    {
+        auto const start = Clock::now();
+        for(long long c = 0; c < calls; ++c) { sink += body(); }
+        std::chrono::duration<double, std::nano> const elapsed = Clock::now() - start;
+        result.nsPerOperation.push_back(elapsed.count() / result.operationsPerRepetition);
+    }
+
+    benchmarkSink = sink;
+    return result;
+}
+
+
+// Median of the repetitions
+double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    std::size_t const n = values.size();
+    return (n % 2 == 1) ? values[n/2] : 0.5 * (values[n/2 - 1] + values[n/2]);
+}
+
+
+// Particles of random types and impulses, as the generation makes them
+std::vector<Particle> MakeParticles(AliasSampler const& sampler, int particlesNum, RandomStream& rng)
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i < particlesNum; ++i)
+    {
+        double const theta = rng.Rndm() * M_PI;
+        double const phi = rng.Rndm() * 2 * M_PI;
+        double const P = rng.Exp(1.);
+        particles.push_back(Particle{sampler.Sample(rng), P * sin(theta) * cos(phi), P * sin(theta) * sin(phi), P * cos(theta)});
+    }
+    return particles;
+}
+
+
+// Name of the CPU, from /proc/cpuinfo where there is one
+std::string GetCpuName()
+{
+    std::ifstream cpuinfo{"/proc/cpuinfo"};
+    std::string line;
+    while(std::getline(cpuinfo, line))
+    {
+        if(line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos)
+        {
+            return line.substr(line.find(':') + 2);
+        }
+    }
+    return "unknown";
+}
+
+
+// Escapes the characters JSON doesn't allow as they are in a string
+std::string JsonString(std::string const& text)
+{
+    std::string escaped = "\"";
+    for(char c : text)
+    {
+        if(c == '"' || c == '\\') { escaped += '\\'; }
+        if((unsigned char)c >= 0x20) { escaped += c; }
+    }
+    return escaped + '"';
+}
+
+
+void WriteJson(std::ostream& output, BenchmarkOptions const& options, std::vector<BenchmarkResult> const& results)
+{
+    char date[32];
+    std::time_t const now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    output << "{\n  \"context\": {\n"
+           << "    \"format_version\": " << BenchmarkFormatVersion << ",\n"
+           << "    \"date\": " << JsonString(date) << ",\n"
+           << "    \"cpu\": " << JsonString(GetCpuName()) << ",\n"
+           << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+           << "    \"pair_kernel\": " << JsonString(getPairKernelName()) << ",\n"
+           << "    \"compiler\": " << JsonString(__VERSION__) << ",\n"
+           << "    \"min_time\": " << options.minTime << ",\n"
+           << "    \"repetitions\": " << options.repetitions << "\n"
+           << "  },\n  \"benchmarks\": [";
+
+    for(std::size_t b = 0; b < results.size(); ++b)
+    {
+        BenchmarkResult const& result = results[b];
+        double const median = Median(result.nsPerOperation);
+
+        output << (b > 0 ? "," : "") << "\n    {\"name\": " << JsonString(result.name) << ", \"operation\": " << JsonString(result.operation)
+               << ", \"operations_per_repetition\": " << result.operationsPerRepetition
+               << ", \"ns_per_operation\": " << median
+               << ", \"operations_per_second\": " << (median > 0. ? 1e9 / median : 0.)
+               << ", \"min_ns_per_operation\": " << *std::min_element(result.nsPerOperation.begin(), result.nsPerOperation.end())
+               << ", \"max_ns_per_operation\": " << *std::max_element(result.nsPerOperation.begin(), result.nsPerOperation.end()) << '}';
+    }
+    output << "\n  ]\n}\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string const argument = argv[i];
+
+        if(argument == "--help" || argument == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(argument.compare(0, 2, "--") != 0 || i + 1 >= argc)
+        {
+            std::cout << "<!> Incorrect argument \"" << argument << "\"\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        std::string const name = argument.substr(2);
+        std::string const value = argv[++i];
+        char* end = nullptr;
+        double const number = std::strtod(value.c_str(), &end);
+        bool const isNumber = !value.empty() && *end == '\0';
+
+        if(name == "output") { options.outputFile = value; }
+        else if(name == "filter") { options.filter = value; }
+        else if(name == "min-time" && isNumber && number > 0.) { options.minTime = number; }
+        else if(name == "repetitions" && isNumber && number >= 1.) { options.repetitions = number; }
+        else if(name == "events" && isNumber && number >= 1.) { options.events = number; }
+        else if(name == "threads" && isNumber && number >= 1.) { options.threadsNum = number; }
+        else
+        {
+            std::cout << "<!> Incorrect option \"" << argument << ' ' << value << "\"\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The messages of the particle table go to the standard error, so that the standard output is only the JSON
+    std::streambuf* const coutBuffer = std::cout.rdbuf(std::cerr.rdbuf());
+    FillDefaultParticleTable();
+    std::cout.rdbuf(coutBuffer);
+
+    AliasSampler const sampler{DefaultAbundancies()};
+    RandomStream rng{12345, 0}; //the same inputs at every run
+    std::vector<BenchmarkResult> results;
+
+    auto const isSelected = [&options](std::string const& name) { return name.find(options.filter) != std::string::npos; };
+    auto const run = [&](std::string const& name, std::string const& operation, long long operationsPerCall, auto body)
+    {
+        if(!isSelected(name)) { return; }
+        std::cerr << name << "...\n";
+        results.push_back(Measure(options, name, operation, operationsPerCall, body));
+    };
+
+    // Kinematics of single particles: every call goes through the same 1024 particles, which stay in L1
+    int const SetSize = 1024;
+    std::vector<Particle> particles = MakeParticles(sampler, SetSize, rng);
+    std::vector<Particle> others = MakeParticles(sampler, SetSize, rng);
+
+    run("Particle::InvMass", "pair", SetSize, [&]()
+    {
+        double sum = 0.;
+        for(int i = 0; i < SetSize; ++i) { sum += particles[i].InvMass(others[i]); }
+        return sum;
+    });
+
+    run("Particle::ParticleEnergy", "impulse update", SetSize, [&]() //the energy is computed when the impulse changes
+    {
+        double sum = 0.;
+        for(int i = 0; i < SetSize; ++i)
+        {
+            particles[i].setImpulse(others[i].getImpulse('x'), others[i].getImpulse('y'), particles[i].getImpulse('z'));
+            sum += particles[i].ParticleEnergy();
+        }
+        return sum;
+    });
+
+    run("Particle::Boost", "boost", 2 * SetSize, [&]() //there and back, so that the impulses don't drift away
+    {
+        for(int i = 0; i < SetSize; ++i)
+        {
+            particles[i].Boost(0.3, -0.2, 0.5);
+            particles[i].Boost(-0.3, 0.2, -0.5);
+        }
+        return particles[0].ParticleEnergy();
+    });
+
+    int const K_ID = Particle::FindParticle_public("K*");
+    Particle kaonStar{K_ID, 0.4, -0.3, 1.1};
+    Particle pion{Particle::FindParticle_public("Pion(+)")};
+    Particle kaon{Particle::FindParticle_public("Kaon(-)")};
+    run("Particle::Decay2Body", "decay", SetSize, [&]()
+    {
+        double sum = 0.;
+        for(int i = 0; i < SetSize; ++i)
+        {
+            kaonStar.Decay2Body(pion, kaon, rng);
+            sum += pion.ParticleEnergy();
+        }
+        return sum;
+    });
+
+    // Particle types: GenerateParticleName() of the generation macro is the sampler plus a name lookup
+    run("GenerateParticleName", "name", SetSize, [&]()
+    {
+        double sum = 0.;
+        for(int i = 0; i < SetSize; ++i) { sum += Particle::getParticleType(sampler.Sample(rng)).size(); }
+        return sum;
+    });
+
+    std::vector<std::string> typeNames;
+    for(int id = 0; id < Particle::getNumParticleType(); ++id) { typeNames.push_back(Particle::getParticleType(id)); }
+    run("Particle::FindParticle", "lookup", SetSize, [&]()
+    {
+        double sum = 0.;
+        for(int i = 0; i < SetSize; ++i) { sum += Particle::FindParticle_public(typeNames[i % typeNames.size()]); }
+        return sum;
+    });
+
+    // Pair loop of a whole event, as the generation does it, at increasing multiplicities
+    PairCategoryTable const pairCategories;
+    std::vector<HistogramDefinition> const definitions = GetHistogramDefinitions();
+    std::vector<FastHistogram> invMassHistos;
+    for(int h = 0; h < NumPairCategories; ++h)
+    {
+        HistogramDefinition const& definition = definitions[Histo_InvariantMass + h];
+        invMassHistos.push_back(FastHistogram{definition.nbins, definition.xmin, definition.xmax});
+    }
+
+    for(int multiplicity : {10, 100, 1000, 10000})
+    {
+        EventBuffer event{multiplicity};
+        for(Particle const& particle : MakeParticles(sampler, multiplicity, rng)) { event.Add(particle); }
+
+        TiledPairLoop pairLoop{pairCategories};
+        FourMomentumColumns const columns = GetFourMomentumColumns(event);
+        run("PairLoop/" + std::to_string(multiplicity), "pair", (long long)multiplicity * (multiplicity - 1) / 2, [&]()
+        {
+            pairLoop.Fill(columns, K_ID, invMassHistos.data());
+            return invMassHistos[0].getEntries();
+        });
+    }
+
+    // The whole generation, with the default settings; the operation is an event, so the result is also given in events per second
+    GenerationConfig config;
+    config.eventsNum = options.events;
+    config.threadsNum = options.threadsNum;
+    config.seed = 12345;
+    config.showProgress = false;
+    run("GenerateEvents/threads:" + std::to_string(options.threadsNum), "event", options.events, [&]()
+    {
+        EventGenerator generator{config, sampler};
+        return generator.Run()[Histo_InvariantMass].getEntries();
+    });
+
+    if(options.outputFile.empty())
+    {
+        WriteJson(std::cout, options, results);
+        return 0;
+    }
+
+    std::ofstream file{options.outputFile};
+    WriteJson(file, options, results);
+    if(!file)
+    {
+        std::cout << "<!> Cannot write the results to \"" << options.outputFile << "\"\n";
+        return 1;
+    }
+    std::cerr << "Results written to \"" << options.outputFile << "\"\n";
+    return 0;
+}
@@ -0,0 +1,261 @@
+// Daniel Michelin
+
+// Merge of the histograms of a sharded generation (see the --shards option of generate_particles): sums the histograms of
+// any number of shard files into one file, which the analysis macro reads as the output of a single run.
+// The files are read in parallel, each into histograms of its own, which are added along a fixed tree over the file
+// indexes (see BlockSum.hpp): the result is the same to the last bit with any number of threads, whatever their timing.
+// The merge is refused if two of the files have some of the same events, i.e. runs with the same seed whose events overlap
+// (see GenerationRun), as when a shard is listed twice.
+// Build it with 'make' (add WITH_ROOT=1 to also be able to read and write ROOT files), run './build/merge_histograms --help'
+
+#include "EventGenerator.hpp"
+#include "GenerationHistograms.hpp"
+#include "HistogramIO.hpp"
+#include "BlockSum.hpp"
+#ifdef GASHEIEP_WITH_ROOT
+#include "RootOutput.hpp"
+#include "TROOT.h"
+#endif
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+
+
+//Everything that can be set from the command line
+struct MergeOptions
+{
+  std::vector<std::string> inputFiles;
+  int threadsNum = 1;
+  std::string outputFile; //empty = ./particles_output/particleHistograms.<format extension>
+  std::string format;
+};
+
+
+void PrintUsage(char const* programName)
+{
+    std::cout << "Usage: " << programName << " [options] FILE...\n"
+              << "Sums the histograms of the FILEs, written by generate_particles (.root files need a build with ROOT)\n"
+              << "Options:\n"
+              << "  --list FILE         also merges the files listed in FILE, one per line\n"
+              << "  --threads N         reading threads (default: 1)\n"
+              << "  --output FILE       output file (default: ./particles_output/particleHistograms.root or .hist)\n"
+              << "  --format FORMAT     'native' or, if built with ROOT, 'root' (default: root if available, else native)\n"
+              << "  --help              prints this message\n";
+}
+
+
+// Adds the lines of 'fileName' to the input files; returns false if it can't be read
+bool ReadFileList(MergeOptions& options, std::string const& fileName)
+{
+    std::ifstream file{fileName};
+    if(!file)
+    {
+        std::cout << "<!> Cannot open the list of files \"" << fileName << "\"\n";
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        size_t const first = line.find_first_not_of(" \t\r");
+        if(first == std::string::npos) { continue; }
+        size_t const last = line.find_last_not_of(" \t\r");
+        options.inputFiles.push_back(line.substr(first, last - first + 1));
+    }
+    return true;
+}
+
+// Sets option 'name'; returns false, printing why, if it doesn't exist or 'value' isn't valid for it
+bool SetOption(MergeOptions& options, std::string const& name, std::string const& value)
+{
+    if(name == "list") { return ReadFileList(options, value); }
+    if(name == "output")
+    {
+        options.outputFile = value;
+        return true;
+    }
+    if(name == "format")
+    {
+        if(value != "native" && value != "root")
+        {
+            std::cout << "<!> Unknown format \"" << value << "\": use 'native' or 'root'\n";
+            return false;
+        }
+        options.format = value;
+        return true;
+    }
+    if(name == "threads")
+    {
+        char* end = nullptr;
+        long const number = std::strtol(value.c_str(), &end, 10);
+        if(value.empty() || *end != '\0' || number < 1 || number > 1024)
+        {
+            std::cout << "<!> \"" << value << "\" is not a valid number of threads\n";
+            return false;
+        }
+        options.threadsNum = number;
+        return true;
+    }
+
+    std::cout << "<!> Unknown option \"--" << name << "\"\n";
+    return false;
+}
+
+
+// Reads one shard file into 'histos', in the format given by its extension
+bool ReadShard(std::string const& fileName, GenerationHistograms& histos)
+{
+#ifdef GASHEIEP_WITH_ROOT
+    if(std::filesystem::path{fileName}.extension() == ".root") { return ReadHistogramsFromRoot(fileName, histos); }
+#endif
+    return ReadHistograms(fileName, histos);
+}
+
+// Reads the next file not yet read until there are none left, handing it over to 'sum' as block 'its index'; stops at the
+// first one that can't be read, setting 'failedFile' to it
+void MergeFiles(std::vector<std::string> const& fileNames, BlockSum<GenerationHistograms>& sum, std::atomic<int>& nextFile, std::atomic<int>& failedFile)
+{
+    for(int i = nextFile++; i < (int)fileNames.size() && failedFile < 0; i = nextFile++)
+    {
+        GenerationHistograms* const shard = sum.Take();
+        if(!ReadShard(fileNames[i], *shard))
+        {
+            failedFile = i;
+            return;
+        }
+        sum.Add(i, shard);
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    MergeOptions options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string const argument = argv[i];
+
+        if(argument == "--help" || argument == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(argument.compare(0, 2, "--") != 0)
+        {
+            options.inputFiles.push_back(argument);
+            continue;
+        }
+        if(i + 1 >= argc)
+        {
+            std::cout << "<!> Incorrect argument \"" << argument << "\"\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        if(!SetOption(options, argument.substr(2), argv[++i])) { return 1; }
+    }
+
+    if(options.inputFiles.empty())
+    {
+        std::cout << "<!> No files to merge\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if(options.format.empty())
+    {
+#ifdef GASHEIEP_WITH_ROOT
+        options.format = "root";
+#else
+        options.format = "native";
+#endif
+    }
+#ifndef GASHEIEP_WITH_ROOT
+    if(options.format == "root")
+    {
+        std::cout << "<!> This program has been built without ROOT: only the 'native' format is available\n";
+        return 1;
+    }
+#else
+    ROOT::EnableThreadSafety(); //the shards are read by several threads at once
+#endif
+
+    if(options.outputFile.empty())
+    {
+        options.outputFile = "./particles_output/particleHistograms." + std::string{options.format == "root" ? "root" : "hist"};
+    }
+
+    FillDefaultParticleTable(); //the abundancies histogram has a bin per particle type
+
+    int const filesNum = options.inputFiles.size();
+    int const threadsNum = std::min(options.threadsNum, filesNum);
+
+    std::cout << "\nFiles: " << filesNum << ", threads: " << threadsNum;
+    std::cout << "\nMerging histograms";
+    std::cout.flush();
+
+    auto const start = std::chrono::steady_clock::now();
+
+    BlockSum<GenerationHistograms> sum{filesNum, GenerationHistograms{}};
+    std::atomic<int> nextFile{0};
+    std::atomic<int> failedFile{-1};
+    std::vector<std::thread> threads;
+    for(int t = 1; t < threadsNum; ++t)
+    {
+        threads.emplace_back(MergeFiles, std::cref(options.inputFiles), std::ref(sum), std::ref(nextFile), std::ref(failedFile));
+    }
+    MergeFiles(options.inputFiles, sum, nextFile, failedFile);
+    for(std::thread& thread : threads) { thread.join(); }
+
+    if(failedFile >= 0)
+    {
+        std::cout << "\n<!> Cannot merge \"" << options.inputFiles[failedFile] << "\"\n";
+        return 1;
+    }
+    GenerationHistograms const& merged = sum.getSum();
+
+    std::vector<GenerationRun> const& runs = merged.getRuns();
+    for(unsigned i = 0; i < runs.size(); ++i)
+    {
+        for(unsigned j = i + 1; j < runs.size(); ++j)
+        {
+            if(!AreOverlapping(runs[i], runs[j])) { continue; }
+            std::cout << "\n<!> Two of the files have the same events: seed " << runs[i].seed << ", events [" << runs[i].firstEvent << ", "
+                      << runs[i].lastEvent << ") and [" << runs[j].firstEvent << ", " << runs[j].lastEvent << ")\n";
+            return 1;
+        }
+    }
+
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "...DONE\n";
+    std::cout << "Merge time: " << elapsed.count() << " s (" << filesNum / elapsed.count() << " files/s)\n";
+    std::cout << "Particles: " << (long long)merged[Histo_ParticleAbundancies].getEntries() << '\n';
+
+    std::filesystem::path const outputPath{options.outputFile};
+    if(outputPath.has_parent_path())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(outputPath.parent_path(), error);
+    }
+
+    bool isWritten;
+#ifdef GASHEIEP_WITH_ROOT
+    if(options.format == "root") { isWritten = WriteHistogramsToRoot(options.outputFile, merged); }
+    else
+#endif
+    isWritten = WriteHistograms(options.outputFile, merged);
+
+    if(!isWritten) { return 1; }
+
+    std::cout << "Histograms written to \"" << options.outputFile << "\"\n";
+    return 0;
+}
@@ -0,0 +1,491 @@
+// Daniel Michelin
+
+// Headless generator: the same generation as GenerateEvents() in macro_ParticleGeneration.cpp, without starting ROOT
+// Build it with 'make' (add WITH_ROOT=1 to also be able to write ROOT files), run './build/generate_particles --help'
+
+#include "Particle.hpp"
+#include "AliasSampler.hpp"
+#include "GenerationHistograms.hpp"
+#include "EventGenerator.hpp"
+#include "StageProfiler.hpp"
+#include "HistogramIO.hpp"
+#ifdef GASHEIEP_WITH_ROOT
+#include "RootOutput.hpp"
+#endif
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <cstdlib>
+
+
+//Everything that can be set from the command line or from a configuration file
+struct GeneratorOptions
+{
+  GenerationConfig generation;
+  std::string abundanciesFile; //empty = default abundancies
+  std::string outputFile; //empty = ./particles_output/particleHistograms.<format extension>
+  std::string format;
+  bool profile = false; //prints the time spent in every stage
+  bool hardwareCounters = false; //adds the CPU counters of every stage to the profile
+  std::string traceFile; //if not empty, writes the timeline of the stages there, as a Chrome trace
+  std::string resumeFile; //if not empty, the checkpoint the run goes on from
+  std::string extendFile; //if not empty, the histogram file the run adds its events to
+};
+
+
+void PrintUsage(char const* programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "Options:\n"
+              << "  --events N         number of events to generate, or the most of them with --target-precision (default: 100000)\n"
+              << "  --particles N      particles generated per event, or their mean if the multiplicity isn't fixed (default: 100)\n"
+              << "  --multiplicity M   'fixed', 'poisson' or 'negative-binomial': distribution of the particles per event (default: fixed)\n"
+              << "  --multiplicity-k K shape of the negative binomial: the smaller K, the wider the distribution (default: 1)\n"
+              << "  --resonance-enhancement F\n"
+              << "                     draws the resonances F times more often and weights the histograms back (default: 1, off)\n"
+              << "  --target-precision R\n"
+              << "                     generates in batches until the relative errors of the K* mass and width fitted on the\n"
+              << "                     opposite - same sign Pion-Kaon invariant mass are below R, e.g. 0.01 (default: 0, off)\n"
+              << "  --batch-events N   events between two fits, with --target-precision (default: 100000)\n"
+              << "  --threads N        generation threads (default: 1)\n"
+              << "  --pair-threads N   threads sharing the pair loop of an event bigger than a tile: its own and N - 1 shared helpers (default: 1)\n"
+              << "  --pipeline S,D,P   runs sampling, decays and pair loop as concurrent stages, on S, D and P threads (instead of --threads),\n"
+              << "                     with bounded queues between them; prints how full the queues were and how long the stages waited\n"
+              << "  --queue-depth N    events that can wait between two stages of --pipeline (default: 64)\n"
+              << "  --pair-tile-size N particles per side of the tiles of the pair loop (default: " << DefaultPairTileSize << ")\n"
+              << "  --seed N           seed of the generation; 0 picks a new one (default: 0)\n"
+              << "  --shards N         splits the --events events into N shards, e.g. for different machines, which share the --seed\n"
+              << "  --shard-index K    generates only shard K (0 to N - 1): its output files get '.shardK-of-N' before their extension;\n"
+              << "                     build/merge_histograms adds the shards together (default: 0)\n"
+              << "  --abundancies FILE abundancies of the generated particles, as in generation/particleAbundancies.txt\n"
+              << "  --output FILE      output file (default: ./particles_output/particleHistograms.root or .hist)\n"
+              << "  --events-file FILE also writes every generated particle to FILE, for later analyses (see generation/EventStore.hpp)\n"
+              << "  --checkpoint FILE  writes the state of the run to FILE every --batch-events events, to go on with --resume\n"
+              << "  --snapshot FILE    writes the histograms so far to FILE every --batch-events events, in the --format of the output,\n"
+              << "                     for the analysis to follow the run; can be the --output file itself\n"
+              << "  --resume FILE      goes on from the checkpoint FILE, with its seed, up to --events events in all; also extends a\n"
+              << "                     finished run with more events (the checkpoint is updated, unless --checkpoint says otherwise)\n"
+              << "  --extend FILE      adds the events to the histograms of FILE, written by earlier runs with different seeds\n"
+              << "                     (the output is FILE itself, unless --output says otherwise); not with --shards\n"
+              << "  --format FORMAT    'native' or, if built with ROOT, 'root' (default: root if available, else native)\n"
+              << "  --config FILE      reads the options from FILE, one 'name = value' per line (e.g. 'events = 1000000');\n"
+              << "                     the options following it on the command line take precedence\n"
+              << "  --quiet            no progress bar\n"
+              << "  --profile          prints the time spent in every stage of the generation, thread by thread\n"
+              << "  --counters         same as --profile, with the CPU counters of every stage (Linux perf events: IPC, cache and branch misses)\n"
+              << "  --trace FILE       also writes the timeline of the stages to FILE, as a Chrome trace (chrome://tracing, ui.perfetto.dev)\n"
+              << "  --help             prints this message\n";
+}
+
+
+// Reads a positive integer, or 0 when 'allowZero'; returns false if 'value' isn't one
+bool ParseCount(std::string const& value, long long& result, bool allowZero)
+{
+    char* end = nullptr;
+    result = std::strtoll(value.c_str(), &end, 10);
+    return !value.empty() && *end == '\0' && (result > 0 || (allowZero && result == 0));
+}
+
+
+// Sets the option 'name' (without the leading "--") to 'value'; returns false, printing why, if it can't
+bool SetOption(GeneratorOptions& options, std::string const& name, std::string const& value)
+{
+    long long number;
+
+    if(name == "events" || name == "particles" || name == "threads" || name == "pair-threads" || name == "pair-tile-size"
+       || name == "batch-events" || name == "shards" || name == "shard-index" || name == "queue-depth")
+    {
+        if(!ParseCount(value, number, name == "shard-index") || number > 2147483647LL)
+        {
+            std::cout << "<!> Incorrect value for " << name << ": must enter a positive value\n";
+            return false;
+        }
+
+        if(name == "events") { options.generation.eventsNum = number; }
+        else if(name == "particles") { options.generation.particlesPerEvent = number; }
+        else if(name == "pair-threads") { options.generation.pairThreadsNum = number; }
+        else if(name == "pair-tile-size") { options.generation.pairTileSize = number; }
+        else if(name == "batch-events") { options.generation.batchEventsNum = number; }
+        else if(name == "shards") { options.generation.shardsNum = number; }
+        else if(name == "shard-index") { options.generation.shardIndex = number; }
+        else if(name == "queue-depth") { options.generation.queueDepth = number; }
+        else { options.generation.threadsNum = number; }
+    }
+    else if(name == "seed")
+    {
+        char* end = nullptr;
+        options.generation.seed = std::strtoull(value.c_str(), &end, 10);
+        if(value.empty() || *end != '\0')
+        {
+            std::cout << "<!> Incorrect value for seed: must enter a non-negative integer\n";
+            return false;
+        }
+    }
+    else if(name == "pipeline")
+    {
+        // Three thread counts, separated by commas
+        std::istringstream counts{value};
+        std::string count;
+        int threadsNum[3];
+        int countsNum = 0;
+        while(countsNum < 3 && std::getline(counts, count, ','))
+        {
+            if(!ParseCount(count, number, false) || number > 1024) { break; }
+            threadsNum[countsNum++] = number;
+        }
+        if(countsNum != 3 || !counts.eof())
+        {
+            std::cout << "<!> Incorrect value for pipeline: must enter three positive thread counts, e.g. '1,1,4'\n";
+            return false;
+        }
+
+        options.generation.pipelined = true;
+        options.generation.samplingThreadsNum = threadsNum[0];
+        options.generation.decayThreadsNum = threadsNum[1];
+        options.generation.pairStageThreadsNum = threadsNum[2];
+    }
+    else if(name == "multiplicity")
+    {
+        if(value == "fixed") { options.generation.multiplicity = Multiplicity_Fixed; }
+        else if(value == "poisson") { options.generation.multiplicity = Multiplicity_Poisson; }
+        else if(value == "negative-binomial") { options.generation.multiplicity = Multiplicity_NegativeBinomial; }
+        else
+        {
+            std::cout << "<!> Unknown multiplicity \"" << value << "\": must be 'fixed', 'poisson' or 'negative-binomial'\n";
+            return false;
+        }
+    }
+    else if(name == "multiplicity-k")
+    {
+        char* end = nullptr;
+        options.generation.multiplicityShape = std::strtod(value.c_str(), &end);
+        if(value.empty() || *end != '\0' || !(options.generation.multiplicityShape > 0.))
+        {
+            std::cout << "<!> Incorrect value for multiplicity-k: must enter a positive number\n";
+            return false;
+        }
+    }
+    else if(name == "resonance-enhancement")
+    {
+        char* end = nullptr;
+        options.generation.resonanceEnhancement = std::strtod(value.c_str(), &end);
+        if(value.empty() || *end != '\0' || !(options.generation.resonanceEnhancement > 0.))
+        {
+            std::cout << "<!> Incorrect value for resonance-enhancement: must enter a positive number\n";
+            return false;
+        }
+    }
+    else if(name == "target-precision")
+    {
+        char* end = nullptr;
+        options.generation.targetPrecision = std::strtod(value.c_str(), &end);
+        if(value.empty() || *end != '\0' || options.generation.targetPrecision < 0.)
+        {
+            std::cout << "<!> Incorrect value for target-precision: must enter a non-negative number\n";
+            return false;
+        }
+    }
+    else if(name == "abundancies") { options.abundanciesFile = value; }
+    else if(name == "output") { options.outputFile = value; }
+    else if(name == "events-file") { options.generation.eventStoreFile = value; }
+    else if(name == "format")
+    {
+        if(value != "native" && value != "root")
+        {
+            std::cout << "<!> Unknown format \"" << value << "\": must be 'native' or 'root'\n";
+            return false;
+        }
+        options.format = value;
+    }
+    else if(name == "quiet") { options.generation.showProgress = !(value.empty() || value == "1" || value == "true" || value == "yes"); }
+    else if(name == "profile") { options.profile = value.empty() || value == "1" || value == "true" || value == "yes"; }
+    else if(name == "counters") { options.hardwareCounters = value.empty() || value == "1" || value == "true" || value == "yes"; }
+    else if(name == "trace") { options.traceFile = value; }
+    else if(name == "checkpoint") { options.generation.checkpointFile = value; }
+    else if(name == "snapshot") { options.generation.snapshotFile = value; }
+    else if(name == "resume") { options.resumeFile = value; }
+    else if(name == "extend") { options.extendFile = value; }
+    else
+    {
+        std::cout << "<!> Unknown option \"" << name << "\"\n";
+        return false;
+    }
+
+    return true;
+}
+
+
+// Name of the file of shard 'shard' of 'shardsNum': ".shard<shard>-of-<shardsNum>" goes before the extension
+std::string ShardFileName(std::string const& fileName, int shard, int shardsNum)
+{
+    if(fileName.empty() || shardsNum <= 1) { return fileName; }
+
+    std::filesystem::path path{fileName};
+    std::string const extension = path.extension().string();
+    path.replace_extension();
+    return path.string() + ".shard" + std::to_string(shard) + "-of-" + std::to_string(shardsNum) + extension;
+}
+
+
+// Reads the options from a file with lines such as "events = 1000000"; '#' starts a comment
+bool ReadConfigFile(GeneratorOptions& options, std::string const& fileName)
+{
+    std::ifstream file{fileName};
+    if(!file)
+    {
+        std::cout << "Cannot open the configuration file \"" << fileName << "\"\n";
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::string::size_type const equalSign = line.find('=');
+        std::string name;
+        std::string value;
+        std::istringstream{line.substr(0, equalSign)} >> name;
+        if(name.empty()) { continue; } //blank line or comment
+        if(equalSign != std::string::npos) { std::istringstream{line.substr(equalSign + 1)} >> value; }
+
+        if(!SetOption(options, name, value))
+        {
+            std::cout << " in \"" << fileName << "\", line " << lineNumber << '\n';
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+int main(int argc, char** argv)
+{
+    GeneratorOptions options;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string const argument = argv[i];
+
+        if(argument == "--help" || argument == "-h")
+        {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if(argument == "--quiet")
+        {
+            options.generation.showProgress = false;
+            continue;
+        }
+        if(argument == "--profile" || argument == "--counters")
+        {
+            options.profile = true;
+            options.hardwareCounters = options.hardwareCounters || argument == "--counters";
+            continue;
+        }
+        if(argument.compare(0, 2, "--") != 0 || i + 1 >= argc)
+        {
+            std::cout << "<!> Incorrect argument \"" << argument << "\"\n";
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        std::string const name = argument.substr(2);
+        std::string const value = argv[++i];
+        bool const isValid = (name == "config") ? ReadConfigFile(options, value) : SetOption(options, name, value);
+        if(!isValid) { return 1; }
+    }
+
+    if(!options.resumeFile.empty() && !options.extendFile.empty())
+    {
+        std::cout << "<!> --resume and --extend can't be used together: a checkpoint already has the histograms to go on from\n";
+        return 1;
+    }
+    if(!options.extendFile.empty() && options.generation.shardsNum > 1)
+    {
+        std::cout << "<!> --extend can't be used with --shards: every shard would add its events to the same histograms;\n"
+                  << "    generate the shards, then add them to \"" << options.extendFile << "\" with merge_histograms\n";
+        return 1;
+    }
+    if(!options.extendFile.empty())
+    {
+        if(options.outputFile.empty()) { options.outputFile = options.extendFile; }
+        if(options.format.empty()) { options.format = (std::filesystem::path{options.extendFile}.extension() == ".root") ? "root" : "native"; }
+    }
+
+    if(options.format.empty())
+    {
+#ifdef GASHEIEP_WITH_ROOT
+        options.format = "root";
+#else
+        options.format = "native";
+#endif
+    }
+#ifndef GASHEIEP_WITH_ROOT
+    if(options.format == "root")
+    {
+        std::cout << "<!> This generator has been built without ROOT: only the 'native' format is available\n";
+        return 1;
+    }
+#endif
+
+    if(options.outputFile.empty())
+    {
+        options.outputFile = "./particles_output/particleHistograms." + std::string{options.format == "root" ? "root" : "hist"};
+    }
+
+    // Every shard writes its own files
+    GenerationConfig& generation = options.generation;
+    if(generation.shardsNum > 1)
+    {
+        if(generation.shardIndex >= generation.shardsNum)
+        {
+            std::cout << "<!> Incorrect value for shard-index: must be less than the number of shards\n";
+            return 1;
+        }
+        if(generation.seed == 0)
+        {
+            std::cout << "<!> The shards of a run must share a seed: pass it with --seed\n";
+            return 1;
+        }
+        for(std::string* fileName : {&generation.eventStoreFile, &generation.checkpointFile, &generation.snapshotFile, &options.traceFile})
+        {
+            *fileName = ShardFileName(*fileName, generation.shardIndex, generation.shardsNum);
+        }
+        options.outputFile = ShardFileName(options.outputFile, generation.shardIndex, generation.shardsNum);
+    }
+    if(!options.resumeFile.empty() && generation.checkpointFile.empty()) { generation.checkpointFile = options.resumeFile; } //already the shard's one
+
+    // The folders of the output files
+    for(std::string const& fileName : {options.outputFile, options.generation.eventStoreFile, options.generation.checkpointFile, options.generation.snapshotFile})
+    {
+        std::filesystem::path const outputPath{fileName};
+        if(outputPath.has_parent_path())
+        {
+            std::error_code error;
+            std::filesystem::create_directories(outputPath.parent_path(), error);
+        }
+    }
+
+    FillDefaultParticleTable();
+
+    std::vector<SpeciesAbundance> abundancies = DefaultAbundancies();
+    if(!options.abundanciesFile.empty())
+    {
+        abundancies = AliasSampler::ReadAbundancies(options.abundanciesFile);
+        if(abundancies.empty())
+        {
+            std::cout << "<!> No abundancies read from \"" << options.abundanciesFile << "\"\n";
+            return 1;
+        }
+    }
+    AliasSampler const sampler{abundancies};
+
+    // Backend of the output file, and of the snapshots
+    HistogramFileWriter writer = WriteHistograms;
+#ifdef GASHEIEP_WITH_ROOT
+    if(options.format == "root") { writer = WriteHistogramsToRoot; }
+#endif
+
+    EventGenerator generator{options.generation, sampler};
+    GenerationConfig const& config = generator.getConfig();
+    generator.setSnapshotWriter(writer);
+
+    if(!options.resumeFile.empty())
+    {
+        GenerationCheckpoint checkpoint;
+        if(!ReadCheckpoint(options.resumeFile, checkpoint) || !generator.Resume(checkpoint))
+        {
+            std::cout << "<!> Cannot resume from \"" << options.resumeFile << "\"\n";
+            return 1;
+        }
+    }
+    if(!options.extendFile.empty())
+    {
+        GenerationHistograms previous;
+        bool isRead;
+#ifdef GASHEIEP_WITH_ROOT
+        if(options.format == "root") { isRead = ReadHistogramsFromRoot(options.extendFile, previous); }
+        else
+#endif
+        isRead = ReadHistograms(options.extendFile, previous);
+        if(!isRead || !generator.setInitialHistograms(previous))
+        {
+            std::cout << "<!> Cannot extend \"" << options.extendFile << "\"\n";
+            return 1;
+        }
+    }
+
+    StageProfiler profiler{config.threadsNum};
+    options.profile = options.profile || options.hardwareCounters;
+    profiler.setHardwareCounters(options.hardwareCounters);
+    bool const isProfiled = options.profile || !options.traceFile.empty();
+    if(isProfiled) { generator.setProfiler(&profiler); }
+
+    std::cout << "\nEvents: " << ((config.targetPrecision > 0.) ? "at most " : "") << config.eventsNum << ", particles per event: " << config.particlesPerEvent;
+    if(config.pipelined)
+    {
+        std::cout << ", pipeline threads: " << config.samplingThreadsNum << " sampling, " << config.decayThreadsNum << " decay, "
+                  << config.pairStageThreadsNum << " pair loop";
+    }
+    else { std::cout << ", threads: " << config.threadsNum; }
+    if(config.shardsNum > 1)
+    {
+        std::cout << "\nShard " << config.shardIndex << " of " << config.shardsNum << ": events " << generator.getShardFirstEvent()
+                  << " to " << generator.getShardLastEvent() - 1;
+    }
+    std::cout << "\nSeed: " << generator.getSeed();
+    if(generator.getFirstEventNum() > 0) { std::cout << "\nResuming from event " << generator.getFirstEventNum(); }
+    std::cout << "\nGenerating events";
+    std::cout.flush();
+
+    auto const start = std::chrono::steady_clock::now();
+    GenerationHistograms const histos = generator.Run();
+    std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "...DONE\n";
+    std::cout << "Generation time: " << elapsed.count() << " s (" << generator.getNewEventsNum() / elapsed.count() << " events/s)\n";
+    if(config.targetPrecision > 0.)
+    {
+        GaussianFitResult const& fit = generator.getKaonStarFit();
+        std::cout << (generator.isTargetPrecisionReached() ? "Target precision reached after " : "<!> Target precision not reached in ")
+                  << generator.getGeneratedEventsNum() << " events";
+        if(fit.isValid)
+        {
+            std::cout << ": K* mass " << fit.mean << " +/- " << fit.meanError << " (" << 100. * fit.meanError / fit.mean << "%), width "
+                      << fit.sigma << " +/- " << fit.sigmaError << " (" << 100. * fit.sigmaError / fit.sigma << "%)";
+        }
+        std::cout << '\n';
+    }
+    if(config.threadsNum > 1 && !config.pipelined) { std::cout << "Event ranges stolen between threads: " << generator.getStealsNum() << '\n'; }
+    if(config.pipelined) { PrintQueueStats(std::cout, generator.getQueueStats()); }
+
+    bool isWritten;
+    {
+        ScopedStageTimer timer{isProfiled ? profiler.getThreadProfile(0) : nullptr, Stage_OutputWrite};
+        isWritten = WriteHistogramsAtomically(options.outputFile, histos, writer); //the output may also be the snapshot, read meanwhile
+    }
+    if(isProfiled) { profiler.getThreadProfile(0)->Count(Stage_OutputWrite, histos.getSize()); }
+
+    if(!isWritten) { return 1; }
+
+    std::cout << "Histograms written to \"" << options.outputFile << "\"\n";
+    if(!config.eventStoreFile.empty()) { std::cout << "Events written to \"" << config.eventStoreFile << "\"\n"; }
+    if(!config.snapshotFile.empty() && config.snapshotFile != options.outputFile) { std::cout << "Last snapshot in \"" << config.snapshotFile << "\"\n"; }
+    if(!config.checkpointFile.empty()) { std::cout << "Checkpoint written to \"" << config.checkpointFile << "\" (" << generator.getGeneratedEventsNum() << " events)\n"; }
+
+    if(options.profile) { profiler.PrintSummary(std::cout); }
+    if(!options.traceFile.empty())
+    {
+        if(!profiler.WriteChromeTrace(options.traceFile)) { return 1; }
+        std::cout << "Trace written to \"" << options.traceFile << "\"\n";
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// Daniel Michelin
+
+#ifndef TESTCHECK_HPP
+#define TESTCHECK_HPP
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+//Checks of the tests run by 'make test': every test is a program whose main() returns TestResult(), i.e. 0 if
+//all of its checks passed; a failed check prints where it is and what it was, and the test goes on with the next ones.
+
+inline int testFailuresNum = 0;
+
+#define CHECK(condition) \
+  do { \
+    if(!(condition)) \
+    { \
+      std::cout << __FILE__ << ':' << __LINE__ << ": check failed: " #condition "\n"; \
+      ++testFailuresNum; \
+    } \
+  } while(false)
+
+//|actual - expected| <= tolerance * |expected|; NaN equals NaN, as the same operations give NaN on both sides
+#define CHECK_CLOSE(actual, expected, tolerance) \
+  do { \
+    double const checkActual = (actual); \
+    double const checkExpected = (expected); \
+    bool const checkBothNaN = std::isnan(checkActual) && std::isnan(checkExpected); \
+    if(!checkBothNaN && !(std::fabs(checkActual - checkExpected) <= (tolerance) * std::fabs(checkExpected))) \
+    { \
+      std::cout << __FILE__ << ':' << __LINE__ << ": check failed: " #actual " = " << std::setprecision(17) << checkActual \
+                << ", expected " << checkExpected << " within " << (tolerance) << " (relative)\n"; \
+      ++testFailuresNum; \
+    } \
+  } while(false)
+
+inline int TestResult(char const* testName)
+{
+    if(testFailuresNum == 0) { std::cout << testName << ": OK\n"; }
+    else { std::cout << testName << ": " << testFailuresNum << " check(s) FAILED\n"; }
+    return (testFailuresNum == 0) ? 0 : 1;
+}
+
+#endif
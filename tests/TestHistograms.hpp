@@ -0,0 +1,31 @@
+// Daniel Michelin
+
+#ifndef TESTHISTOGRAMS_HPP
+#define TESTHISTOGRAMS_HPP
+#include "TestCheck.hpp"
+#include "../generation/GenerationHistograms.hpp"
+
+//Whether two histograms are the same bit for bit: binning, contents, sums of squared weights, entries and statistics
+inline bool AreIdentical(FastHistogram const& a, FastHistogram const& b)
+{
+    if(a.getNbins() != b.getNbins() || a.getXmin() != b.getXmin() || a.getXmax() != b.getXmax()) { return false; }
+    if(a.hasSumw2() != b.hasSumw2() || a.getEntries() != b.getEntries()) { return false; }
+
+    for(int bin = 0; bin <= a.getNbins() + 1; ++bin)
+    {
+        if(a.getBinContent(bin) != b.getBinContent(bin) || a.getBinSumw2(bin) != b.getBinSumw2(bin)) { return false; }
+    }
+
+    double aStats[4], bStats[4];
+    a.getStats(aStats);
+    b.getStats(bStats);
+    for(int i = 0; i < 4; ++i) { if(aStats[i] != bStats[i]) { return false; } }
+    return true;
+}
+
+inline void CheckIdentical(GenerationHistograms const& actual, GenerationHistograms const& expected)
+{
+    for(int h = 0; h < NumHistograms; ++h) { CHECK(AreIdentical(actual[h], expected[h])); }
+}
+
+#endif
@@ -0,0 +1,87 @@
+// Daniel Michelin
+
+// AliasSampler: the species are drawn with the probabilities of the table, and tables that can't be sampled (empty,
+// all zero, negative or not finite probabilities) are rejected by the constructor and by the reader of abundancies files.
+
+#include "TestCheck.hpp"
+#include "../generation/AliasSampler.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/RandomStream.hpp"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Every species within 5 standard deviations of its expected count
+void CheckFrequencies(std::vector<SpeciesAbundance> const& abundancies)
+{
+    AliasSampler const sampler{abundancies};
+    int const drawsNum = 1000000;
+
+    std::vector<int> counts(64, 0);
+    RandomStream rng{7, 0};
+    for(int i = 0; i < drawsNum; ++i) { ++counts[sampler.Sample(rng)]; }
+
+    double total = 0.;
+    for(SpeciesAbundance const& abundance : abundancies) { total += abundance.probability; }
+
+    for(SpeciesAbundance const& abundance : abundancies)
+    {
+        double const p = abundance.probability / total;
+        double const expected = p * drawsNum;
+        CHECK(std::fabs(counts[abundance.speciesID] - expected) <= 5. * std::sqrt(expected * (1. - p)) + 1e-9);
+    }
+}
+
+bool IsRejected(std::vector<SpeciesAbundance> const& abundancies)
+{
+    try { AliasSampler const sampler{abundancies}; }
+    catch(std::invalid_argument const& error)
+    {
+        std::cout << "rejected as expected: " << error.what() << '\n';
+        return true;
+    }
+    return false;
+}
+
+std::vector<SpeciesAbundance> ReadFromText(std::string const& text)
+{
+    std::string const fileName = "test_AliasSampler_abundancies.txt";
+    {
+        std::ofstream file{fileName};
+        file << text;
+    }
+    std::vector<SpeciesAbundance> const abundancies = AliasSampler::ReadAbundancies(fileName);
+    std::remove(fileName.c_str());
+    return abundancies;
+}
+
+
+int main()
+{
+    FillDefaultParticleTable(); //for the names of the abundancies files
+
+    CheckFrequencies(DefaultAbundancies());
+    CheckFrequencies({{3, 0.5}, {10, 0.}, {11, 2.5}, {40, 1e-3}, {63, 7.}}); //a zero probability is allowed, and never drawn
+
+    double const nan = std::numeric_limits<double>::quiet_NaN();
+    double const infinity = std::numeric_limits<double>::infinity();
+    CHECK(IsRejected({}));
+    CHECK(IsRejected({{0, 0.}, {1, 0.}, {2, 0.}}));
+    CHECK(IsRejected({{0, 0.5}, {1, -0.1}, {2, 0.6}}));
+    CHECK(IsRejected({{0, 0.5}, {1, nan}}));
+    CHECK(IsRejected({{0, 0.5}, {1, infinity}}));
+    CHECK(!IsRejected({{0, 0.}, {1, 1e-300}}));
+
+    std::vector<SpeciesAbundance> const read = ReadFromText("# comment\nPion(+) 0.4\nKaon(-) 0.1 # another one\n\nK* 0.01\n");
+    CHECK(read.size() == 3);
+    CHECK(ReadFromText("Pion(+) 0.\nPion(-) 0\n").empty());
+    CHECK(ReadFromText("Pion(+) 0.4\nPion(-) -0.4\n").empty());
+    CHECK(ReadFromText("# nothing\n").empty());
+
+    return TestResult("test_AliasSampler");
+}
@@ -0,0 +1,113 @@
+// Daniel Michelin
+
+// BoundedQueue: a single thread gets its values back in order, and the queue refuses pushes when full and pops when
+// empty. Several producers and consumers at once, on a queue small enough to go round the ring and stall all the time,
+// pop every pushed value exactly once, and every consumer gets the values of a producer in the order they were pushed.
+
+#include "TestCheck.hpp"
+#include "../generation/BoundedQueue.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+void CheckSingleThread()
+{
+    BoundedQueue queue{"single", 5};
+    CHECK(queue.getCapacity() == 8); //rounded up to a power of 2
+
+    int value = -1;
+    CHECK(!queue.TryPop(value));
+    CHECK(value == -1);
+
+    for(int round = 0; round < 3; ++round) //round the ring a few times
+    {
+        for(int i = 0; i < 8; ++i) { CHECK(queue.TryPush(10 * round + i)); }
+        CHECK(!queue.TryPush(99));
+        CHECK(queue.getSize() == 8);
+
+        for(int i = 0; i < 8; ++i)
+        {
+            CHECK(queue.TryPop(value));
+            CHECK(value == 10 * round + i);
+        }
+        CHECK(!queue.TryPop(value));
+        CHECK(queue.getSize() == 0);
+    }
+
+    QueueStats const stats = queue.getStats();
+    CHECK(stats.pushesNum == 24);
+    CHECK(stats.maxDepth == 8);
+}
+
+void CheckProducersAndConsumers()
+{
+    int const producersNum = 4;
+    int const consumersNum = 4;
+    int const valuesNum = 200000; //per producer
+    int const EndOfValues = -1;
+
+    BoundedQueue queue{"stress", 8};
+
+    // Producer p pushes p*valuesNum ... (p+1)*valuesNum - 1, in this order
+    std::vector<std::thread> producers;
+    for(int p = 0; p < producersNum; ++p)
+    {
+        producers.emplace_back([&queue, p, valuesNum]() {
+            for(int i = 0; i < valuesNum; ++i) { queue.Push(p * valuesNum + i); }
+        });
+    }
+
+    // Every consumer counts the values it pops and checks that those of each producer keep increasing
+    std::vector<std::atomic<int>> popsNum(producersNum * valuesNum);
+    for(std::atomic<int>& pops : popsNum) { pops = 0; }
+    std::atomic<int> misorderedNum{0};
+    std::vector<std::thread> consumers;
+    for(int c = 0; c < consumersNum; ++c)
+    {
+        consumers.emplace_back([&queue, &popsNum, &misorderedNum, producersNum, valuesNum, EndOfValues]() {
+            std::vector<int> lastValues(producersNum, -1);
+            for(int value = queue.Pop(); value != EndOfValues; value = queue.Pop())
+            {
+                if(value < 0 || value >= producersNum * valuesNum)
+                {
+                    ++misorderedNum;
+                    continue;
+                }
+                int const producer = value / valuesNum;
+                if(value <= lastValues[producer]) { ++misorderedNum; }
+                lastValues[producer] = value;
+                ++popsNum[value];
+            }
+        });
+    }
+
+    for(std::thread& producer : producers) { producer.join(); }
+    for(int c = 0; c < consumersNum; ++c) { queue.Push(EndOfValues); } //after every value, so each consumer gets one
+    for(std::thread& consumer : consumers) { consumer.join(); }
+
+    int missingNum = 0;
+    int duplicatedNum = 0;
+    for(std::atomic<int> const& pops : popsNum)
+    {
+        if(pops == 0) { ++missingNum; }
+        if(pops > 1) { ++duplicatedNum; }
+    }
+    CHECK(missingNum == 0);
+    CHECK(duplicatedNum == 0);
+    CHECK(misorderedNum == 0);
+    CHECK(queue.getSize() == 0);
+
+    QueueStats const stats = queue.getStats();
+    CHECK(stats.pushesNum == (long long)producersNum * valuesNum + consumersNum);
+    CHECK(stats.maxDepth <= 8);
+}
+
+
+int main()
+{
+    CheckSingleThread();
+    CheckProducersAndConsumers();
+
+    return TestResult("test_BoundedQueue");
+}
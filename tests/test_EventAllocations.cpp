@@ -0,0 +1,172 @@
+// Daniel Michelin
+
+// The event cycle must not allocate memory once the first events have sized the arena, the buffers and the scratch
+// arrays (see EventArena.hpp): this test counts every malloc() of the process, and checks that a run of many events
+// makes exactly as many as a run of fewer, i.e. that the events after the warm-up make none at all. The partial
+// histograms of a batch are summed along a tree over its blocks of events (see BlockSum.hpp), which allocates up front
+// one partial per level: both runs have their blocks in a tree of the same depth.
+// With several threads, or the pipeline, how many partials are alive at once depends on the timing of the threads, and
+// so does the number of partials the sum allocates beyond the ones it starts with: there the longer run has many more
+// events than the warm-up, and may only make as many more allocations as those partials take, far fewer than its events.
+
+#include "TestCheck.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/Particle.hpp"
+#include <atomic>
+#include <cstddef>
+
+extern "C" void* __libc_malloc(std::size_t size);
+extern "C" void* __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void* __libc_realloc(void* pointer, std::size_t size);
+extern "C" void* __libc_memalign(std::size_t alignment, std::size_t size);
+
+static std::atomic<long long> allocationsNum{0};
+
+// Malloc shim: the allocations of the whole process (operator new and the standard containers included, since they go
+// through malloc) are counted, then handed over to glibc
+extern "C" void* malloc(std::size_t size)
+{
+    allocationsNum.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(std::size_t count, std::size_t size)
+{
+    allocationsNum.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, std::size_t size)
+{
+    allocationsNum.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void* aligned_alloc(std::size_t alignment, std::size_t size)
+{
+    allocationsNum.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void** pointer, std::size_t alignment, std::size_t size)
+{
+    allocationsNum.fetch_add(1, std::memory_order_relaxed);
+    *pointer = __libc_memalign(alignment, size);
+    return (*pointer != nullptr) ? 0 : 12; //ENOMEM
+}
+
+
+// Allocations made by Run() for a generation of 'eventsNum' events with 'config'
+long long CountRunAllocations(GenerationConfig config, int eventsNum, AliasSampler const& sampler)
+{
+    config.eventsNum = eventsNum;
+    EventGenerator generator{config, sampler};
+
+    long long const before = allocationsNum.load();
+    GenerationHistograms const histos = generator.Run();
+    long long const after = allocationsNum.load();
+
+    if(config.multiplicity == Multiplicity_Fixed) { CHECK(histos[Histo_ParticleAbundancies].getEntries() == (double)eventsNum * config.particlesPerEvent); }
+    return after - before;
+}
+
+// Allocations made by a partial that the sum of the blocks makes when it runs out of them: its copy of the empty one,
+// then the sums of squared weights, which every histogram allocates at its first weighted fill
+long long CountPartialAllocations()
+{
+    GenerationHistograms const empty;
+
+    long long const before = allocationsNum.load();
+    GenerationHistograms partial{empty};
+    for(int i = 0; i < partial.getSize(); ++i) { partial[i].Fill(0., 2.); }
+    long long const after = allocationsNum.load();
+
+    return after - before;
+}
+
+// The extra events of the longer run must not allocate anything
+void CheckSteadyState(char const* name, GenerationConfig const& config, AliasSampler const& sampler)
+{
+    int const warmUpEventsNum = 1100; //275 blocks of 4 events
+    int const longRunEventsNum = 2000; //500 blocks, 9 levels as well
+
+    long long const warmUpAllocations = CountRunAllocations(config, warmUpEventsNum, sampler);
+    long long const longRunAllocations = CountRunAllocations(config, longRunEventsNum, sampler);
+
+    std::cout << name << ": " << warmUpAllocations << " allocations for " << warmUpEventsNum << " events, "
+              << longRunAllocations << " for " << longRunEventsNum << '\n';
+    CHECK(longRunAllocations == warmUpAllocations);
+}
+
+// The extra events of the longer run may only allocate the partials that the timing of the threads asks for. The blocks
+// not done yet make one range per thread (the one it goes through, stolen ranges included; the sampling threads, in the
+// pipeline): the partials alive are the ones being filled, one per range, and the nodes waiting for a sibling, one per level
+// on either side of a range. In the pipeline, the events in flight also keep open a block each, at most, behind the
+// sampling threads, with as many nodes waiting between them.
+void CheckThreadedSteadyState(char const* name, GenerationConfig const& config, AliasSampler const& sampler)
+{
+    int const warmUpEventsNum = 1100;
+    int const longRunEventsNum = 5000; //1250 blocks of 4 events, 11 levels below the root
+    int const levelsNum = 11 + 1;
+    int const rangesNum = config.pipelined ? config.samplingThreadsNum : config.threadsNum;
+    int const slotsNum = 2 * config.queueDepth + config.samplingThreadsNum + config.decayThreadsNum + config.pairStageThreadsNum;
+    int const partialsNum = rangesNum * (2 * levelsNum + 1) + (config.pipelined ? 2 * slotsNum : 0);
+    long long const slack = CountPartialAllocations() * partialsNum;
+
+    long long const warmUpAllocations = CountRunAllocations(config, warmUpEventsNum, sampler);
+    long long const longRunAllocations = CountRunAllocations(config, longRunEventsNum, sampler);
+
+    std::cout << name << ": " << warmUpAllocations << " allocations for " << warmUpEventsNum << " events, "
+              << longRunAllocations << " for " << longRunEventsNum << " (at most " << slack << " more)\n";
+    CHECK(slack < longRunEventsNum - warmUpEventsNum); //an allocation per event would go beyond it
+    CHECK(longRunAllocations <= warmUpAllocations + slack);
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+    AliasSampler const sampler{DefaultAbundancies()};
+
+    GenerationConfig config;
+    config.particlesPerEvent = 100;
+    config.seed = 12345;
+    config.showProgress = false;
+
+    CheckSteadyState("unweighted", config, sampler);
+
+    config.resonanceEnhancement = 5.; //the weighted fills, with the weights of the decay products
+    CheckSteadyState("weighted", config, sampler);
+
+    config.pairTileSize = 16; //7 groups of particles: every event is shared with the 2 helpers of the pair loop
+    config.pairThreadsNum = 3;
+    CheckSteadyState("weighted, pair threads", config, sampler);
+
+    // Variable multiplicity: the buffers grow with the biggest event so far, so the shape of the negative binomial is
+    // large enough for the warm-up to have seen events as big as the ones of the longer run, give or take a few
+    config.pairTileSize = DefaultPairTileSize;
+    config.pairThreadsNum = 1;
+    config.multiplicity = Multiplicity_Poisson;
+    CheckSteadyState("weighted, Poisson", config, sampler);
+
+    config.multiplicity = Multiplicity_NegativeBinomial;
+    config.multiplicityShape = 50.;
+    CheckSteadyState("weighted, negative binomial", config, sampler);
+
+    config.threadsNum = 3;
+    CheckThreadedSteadyState("weighted, negative binomial, 3 threads", config, sampler);
+
+    config.multiplicity = Multiplicity_Fixed;
+    CheckThreadedSteadyState("weighted, 3 threads", config, sampler);
+
+    config.threadsNum = 1;
+    config.multiplicity = Multiplicity_Poisson;
+    config.pipelined = true;
+    config.samplingThreadsNum = 1;
+    config.decayThreadsNum = 2;
+    config.pairStageThreadsNum = 2;
+    config.queueDepth = 2;
+    CheckThreadedSteadyState("weighted, Poisson, pipeline", config, sampler);
+
+    return TestResult("test_EventAllocations");
+}
@@ -0,0 +1,159 @@
+// Daniel Michelin
+
+// Event store: the events written are read back as they were, a file cut short is read up to its last whole chunk, and
+// a chunk whose event offsets don't fit its columns (not starting at 0, decreasing, or past its particles), with a
+// species ID past the species table or a mother that isn't -1 or a particle before its daughter makes the reader throw
+// instead of handing out indexes that point outside the mapped columns or the tables of the readers.
+
+#include "TestCheck.hpp"
+#include "../generation/EventStore.hpp"
+#include "../generation/EventBuffer.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/Particle.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+std::string const StoreFile = "test_EventStore.evts";
+std::string const CorruptFile = "test_EventStore_corrupt.evts";
+
+int const EventSizes[] = {3, 5, 2, 4}; //one chunk of 4 events
+
+
+// Event e: particle i has species (e + i) % 6 and impulse (e, i, e*i)
+void WriteStore()
+{
+    EventStoreWriter writer{StoreFile, 42, 4};
+    EventChunkBuilder chunk{8};
+    EventBuffer particles;
+    for(int e = 0; e < 4; ++e)
+    {
+        particles.Clear();
+        for(int i = 0; i < EventSizes[e]; ++i) { particles.Add(Particle{(e + i) % 6, (double)e, (double)i, (double)e*i}); }
+        chunk.AddEvent(e, particles);
+    }
+    writer.WriteChunk(chunk.getView());
+    CHECK(writer.Close());
+}
+
+void CheckReadBack()
+{
+    EventStoreReader const reader{StoreFile};
+    CHECK(reader.isOpen());
+    CHECK(reader.getSeed() == 42);
+    CHECK(reader.getNumChunks() == 1);
+    CHECK(reader.getNumEvents() == 4);
+    CHECK(reader.getNumParticles() == 14);
+    if(reader.getNumChunks() != 1) { return; }
+
+    EventChunkView const chunk = reader.getChunk(0);
+    CHECK(chunk.eventOffsets[0] == 0);
+    for(int e = 0; e < 4; ++e)
+    {
+        CHECK((int)(chunk.eventOffsets[e+1] - chunk.eventOffsets[e]) == EventSizes[e]);
+        for(int i = 0; i < EventSizes[e]; ++i)
+        {
+            int const k = chunk.eventOffsets[e] + i;
+            CHECK(chunk.speciesID[k] == (e + i) % 6);
+            CHECK(chunk.px[k] == (float)e && chunk.py[k] == (float)i && chunk.pz[k] == (float)(e*i));
+            CHECK(chunk.mother[k] == -1);
+        }
+    }
+}
+
+std::vector<char> ReadFile(std::string const& fileName)
+{
+    std::ifstream file{fileName, std::ios::binary};
+    return std::vector<char>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+void WriteFile(std::string const& fileName, std::vector<char> const& bytes)
+{
+    std::ofstream file{fileName, std::ios::binary};
+    file.write(bytes.data(), bytes.size());
+}
+
+// Position in the file of the offsets column of the chunk, found by its values: 0, 3, 8, 10, 14
+std::size_t FindOffsets(std::vector<char> const& bytes)
+{
+    std::uint32_t const offsets[] = {0, 3, 8, 10, 14};
+    for(std::size_t position = 0; position + sizeof(offsets) <= bytes.size(); position += 4)
+    {
+        if(std::memcmp(bytes.data() + position, offsets, sizeof(offsets)) == 0) { return position; }
+    }
+    return 0;
+}
+
+// Position in the file of value 'index' of a column of the chunk: every column starts 64 bytes after the one before,
+// since none of this small chunk takes more (offsets, px, py, pz, species, mother)
+enum Column { Column_Offsets, Column_Px, Column_Py, Column_Pz, Column_Species, Column_Mother };
+
+std::size_t FindValue(std::vector<char> const& bytes, Column column, int index, std::size_t valueSize)
+{
+    std::size_t const offsetsPosition = FindOffsets(bytes);
+    CHECK(offsetsPosition > 0);
+    return offsetsPosition + 64 * column + index * valueSize;
+}
+
+// Whether opening the file with value 'index' of 'column' replaced by 'value' throws
+template<typename T>
+bool IsCorruptionDetected(std::vector<char> bytes, Column column, int index, T value)
+{
+    std::memcpy(bytes.data() + FindValue(bytes, column, index, sizeof(T)), &value, sizeof(value));
+    WriteFile(CorruptFile, bytes);
+
+    try { EventStoreReader const reader{CorruptFile}; }
+    catch(std::runtime_error const& error)
+    {
+        std::cout << "rejected as expected: " << error.what() << '\n';
+        return true;
+    }
+    return false;
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+
+    WriteStore();
+    CheckReadBack();
+
+    std::vector<char> const bytes = ReadFile(StoreFile);
+
+    CHECK(IsCorruptionDetected(bytes, Column_Offsets, 0, std::uint32_t{1})); //not starting at 0
+    CHECK(IsCorruptionDetected(bytes, Column_Offsets, 2, std::uint32_t{2})); //decreasing: 3, 2
+    CHECK(IsCorruptionDetected(bytes, Column_Offsets, 4, std::uint32_t{15})); //past the 14 particles
+    CHECK(IsCorruptionDetected(bytes, Column_Offsets, 3, std::uint32_t{0xFFFFFFFF})); //then decreasing
+    CHECK(!IsCorruptionDetected(bytes, Column_Offsets, 2, std::uint32_t{3})); //an empty event is fine
+
+    // Particle 2 of event 1 (the 6th of the chunk); the table has 7 species
+    int const numSpecies = Particle::getNumParticleType();
+    CHECK(IsCorruptionDetected(bytes, Column_Species, 5, (std::uint16_t)numSpecies));
+    CHECK(IsCorruptionDetected(bytes, Column_Species, 5, std::uint16_t{0xFFFF}));
+    CHECK(!IsCorruptionDetected(bytes, Column_Species, 5, (std::uint16_t)(numSpecies - 1)));
+    CHECK(IsCorruptionDetected(bytes, Column_Mother, 5, std::int32_t{2})); //itself
+    CHECK(IsCorruptionDetected(bytes, Column_Mother, 5, std::int32_t{4})); //after it, still in its event
+    CHECK(IsCorruptionDetected(bytes, Column_Mother, 5, std::int32_t{-2}));
+    CHECK(IsCorruptionDetected(bytes, Column_Mother, 2, std::int32_t{3})); //last particle of event 0, pointing past it
+    CHECK(!IsCorruptionDetected(bytes, Column_Mother, 5, std::int32_t{1})); //a particle before it
+    CHECK(!IsCorruptionDetected(bytes, Column_Mother, 5, std::int32_t{0}));
+
+    // Cut short: the chunk is incomplete, so there are no events, but no error either
+    WriteFile(CorruptFile, std::vector<char>(bytes.begin(), bytes.end() - 64));
+    {
+        EventStoreReader const reader{CorruptFile};
+        CHECK(reader.isOpen());
+        CHECK(reader.getNumEvents() == 0);
+    }
+
+    std::remove(StoreFile.c_str());
+    std::remove(CorruptFile.c_str());
+
+    return TestResult("test_EventStore");
+}
@@ -0,0 +1,140 @@
+// Daniel Michelin
+
+// FastHistogram against the bins and statistics that TH1::Fill() gives, worked out by hand: bin search at the edges,
+// under/overflows out of the statistics, weighted fills switching Sumw2() on, and shards added together.
+
+#include "TestCheck.hpp"
+#include "../generation/FastHistogram.hpp"
+#include <vector>
+
+void CheckFindBin()
+{
+    int const nbins = 1000;
+    double const xmin = 0.;
+    double const xmax = 2.;
+    FastHistogram const histo{nbins, xmin, xmax};
+
+    CHECK(histo.FindBin(-1e-300) == 0);
+    CHECK(histo.FindBin(xmin) == 1);
+    CHECK(histo.FindBin(std::nextafter(xmax, 0.)) == nbins);
+    CHECK(histo.FindBin(xmax) == nbins + 1);
+    CHECK(histo.FindBin(1e300) == nbins + 1);
+
+    // On and around every bin edge, the bin of TAxis::FindFixBin()
+    for(int edge = 0; edge <= nbins; ++edge)
+    {
+        double const x = xmin + edge * (xmax - xmin) / nbins;
+        for(double const near : {std::nextafter(x, -1.), x, std::nextafter(x, 3.)})
+        {
+            if(near < xmin || !(near < xmax)) { continue; }
+            CHECK(histo.FindBin(near) == 1 + (int)(nbins * (near - xmin) / (xmax - xmin)));
+        }
+    }
+}
+
+void CheckUnweightedFills()
+{
+    FastHistogram histo{4, 0., 4.};
+    for(double const x : {0.5, 1.5, 1.5, 3.25, -1., 4., 7.}) { histo.Fill(x); }
+    histo.FillBin(2); //as a labelled bin: the entry counts, but no x enters the statistics
+
+    CHECK(histo.getEntries() == 8.);
+    CHECK(histo.getBinContent(0) == 1.);
+    CHECK(histo.getBinContent(1) == 1.);
+    CHECK(histo.getBinContent(2) == 3.);
+    CHECK(histo.getBinContent(4) == 1.);
+    CHECK(histo.getBinContent(5) == 2.);
+    CHECK(!histo.hasSumw2());
+    CHECK(histo.getBinSumw2(2) == 3.);
+
+    double stats[4];
+    histo.getStats(stats);
+    CHECK(stats[0] == 5.); //4 fills in range and the FillBin()
+    CHECK(stats[1] == 5.);
+    CHECK(stats[2] == 0.5 + 1.5 + 1.5 + 3.25);
+    CHECK(stats[3] == 0.25 + 2.25 + 2.25 + 10.5625);
+}
+
+void CheckWeightedFills()
+{
+    FastHistogram histo{4, 0., 4.};
+    histo.Fill(0.5);
+    histo.Fill(0.5, 3.); //switches Sumw2() on, with the first fill counted with weight 1
+    histo.Fill(2.5, 0.5);
+    histo.Fill(9., 2.);
+    histo.FillBin(3, 4.);
+    histo.Fill(0.75); //a fill of weight 1 once Sumw2() is on
+
+    CHECK(histo.hasSumw2());
+    CHECK(histo.getEntries() == 6.);
+    CHECK(histo.getBinContent(1) == 5.);
+    CHECK(histo.getBinSumw2(1) == 1. + 9. + 1.);
+    CHECK(histo.getBinContent(3) == 4.5);
+    CHECK(histo.getBinSumw2(3) == 0.25 + 16.);
+    CHECK(histo.getBinContent(5) == 2.);
+    CHECK(histo.getBinSumw2(5) == 4.);
+    CHECK_CLOSE(histo.getBinError(1), std::sqrt(11.), 1e-15);
+
+    double stats[4];
+    histo.getStats(stats);
+    CHECK(stats[0] == 1. + 3. + 0.5 + 4. + 1.);
+    CHECK(stats[1] == 1. + 9. + 0.25 + 16. + 1.);
+    CHECK(stats[2] == 0.5 + 3. * 0.5 + 0.5 * 2.5 + 0.75);
+    CHECK(stats[3] == 0.25 + 3. * 0.25 + 0.5 * 6.25 + 0.5625);
+
+    histo.Reset(); //empties it, but keeps Sumw2() on, as ROOT does
+    CHECK(histo.hasSumw2());
+    CHECK(histo.getEntries() == 0.);
+    CHECK(histo.getBinContent(1) == 0. && histo.getBinSumw2(1) == 0.);
+    histo.getStats(stats);
+    CHECK(stats[0] == 0. && stats[1] == 0. && stats[2] == 0. && stats[3] == 0.);
+}
+
+// Shards filled with parts of the values and added must give the histogram filled with all of them, Sumw2() included
+// when only some of the shards are weighted; the values are multiples of 1/4, so every sum is exact
+void CheckAdd()
+{
+    FastHistogram whole{8, -1., 1.};
+    std::vector<FastHistogram> shards(3, FastHistogram{8, -1., 1.});
+    for(int i = 0; i < 300; ++i)
+    {
+        double const x = -1.25 + 0.25 * (i % 11);
+        if(i % 3 == 1)
+        {
+            whole.Fill(x, 2.);
+            shards[1].Fill(x, 2.);
+        }
+        else
+        {
+            whole.Fill(x);
+            shards[i % 3].Fill(x);
+        }
+    }
+
+    FastHistogram sum{8, -1., 1.};
+    for(FastHistogram const& shard : shards) { sum.Add(shard); }
+
+    CHECK(sum.hasSumw2());
+    CHECK(sum.getEntries() == whole.getEntries());
+    for(int bin = 0; bin < 10; ++bin)
+    {
+        CHECK(sum.getBinContent(bin) == whole.getBinContent(bin));
+        CHECK(sum.getBinSumw2(bin) == whole.getBinSumw2(bin));
+    }
+
+    double sumStats[4], wholeStats[4];
+    sum.getStats(sumStats);
+    whole.getStats(wholeStats);
+    for(int i = 0; i < 4; ++i) { CHECK(sumStats[i] == wholeStats[i]); }
+}
+
+
+int main()
+{
+    CheckFindBin();
+    CheckUnweightedFills();
+    CheckWeightedFills();
+    CheckAdd();
+
+    return TestResult("test_FastHistogram");
+}
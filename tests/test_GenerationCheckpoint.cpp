@@ -0,0 +1,158 @@
+// Daniel Michelin
+
+// Checkpoint and resume: a checkpoint is read back as it was written, a run stopped after its first batch and resumed
+// from the checkpoint gives bit for bit the histograms of a run that never stopped, and a checkpoint can't be resumed
+// by a run that would generate different events. The histograms record the run that generated them, which is written to
+// and read from the histogram files, and a run can't be added to histograms that already have its seed.
+
+#include "TestHistograms.hpp"
+#include "../generation/GenerationCheckpoint.hpp"
+#include "../generation/HistogramIO.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/Particle.hpp"
+#include <cstdio>
+#include <string>
+
+std::string const UninterruptedFile = "test_GenerationCheckpoint_uninterrupted.ckpt";
+std::string const ResumedFile = "test_GenerationCheckpoint_resumed.ckpt";
+std::string const HistogramsFile = "test_GenerationCheckpoint.hist";
+
+int const BatchEventsNum = 500;
+int const EventsNum = 3 * BatchEventsNum;
+
+
+// One thread, so that the histograms of every batch are summed in the same order in both runs
+GenerationConfig MakeConfig(int eventsNum, std::string const& checkpointFile)
+{
+    GenerationConfig config;
+    config.eventsNum = eventsNum;
+    config.particlesPerEvent = 100;
+    config.multiplicity = Multiplicity_Poisson;
+    config.resonanceEnhancement = 5.; //the weighted histograms, with their sums of squared weights
+    config.batchEventsNum = BatchEventsNum;
+    config.seed = 12345;
+    config.showProgress = false;
+    config.checkpointFile = checkpointFile;
+    return config;
+}
+
+void CheckResume(AliasSampler const& sampler)
+{
+    EventGenerator uninterrupted{MakeConfig(EventsNum, UninterruptedFile), sampler};
+    GenerationHistograms const expected = uninterrupted.Run();
+
+    // The first batch alone, as if the run had been stopped there
+    EventGenerator stopped{MakeConfig(BatchEventsNum, ResumedFile), sampler};
+    GenerationHistograms const firstBatch = stopped.Run();
+
+    GenerationCheckpoint checkpoint;
+    CHECK(ReadCheckpoint(ResumedFile, checkpoint));
+    CHECK(checkpoint.seed == 12345);
+    CHECK(checkpoint.firstEvent == 0);
+    CHECK(checkpoint.nextEvent == BatchEventsNum);
+    CHECK(checkpoint.particlesPerEvent == 100);
+    CHECK(checkpoint.multiplicity == Multiplicity_Poisson);
+    CHECK(checkpoint.resonanceEnhancement == 5.);
+    CheckIdentical(checkpoint.histos, firstBatch);
+    CHECK(checkpoint.histos.getRuns().empty()); //the run is only added to its histograms once it's over
+
+    // Resumed with a different seed in the configuration: the one of the checkpoint is taken
+    GenerationConfig resumedConfig = MakeConfig(EventsNum, ResumedFile);
+    resumedConfig.seed = 1;
+    EventGenerator resumed{resumedConfig, sampler};
+    CHECK(resumed.Resume(checkpoint));
+    CHECK(resumed.getFirstEventNum() == BatchEventsNum);
+
+    GenerationHistograms const histos = resumed.Run();
+    CHECK(resumed.getSeed() == 12345);
+    CHECK(resumed.getGeneratedEventsNum() == EventsNum);
+    CHECK(resumed.getNewEventsNum() == EventsNum - BatchEventsNum);
+    CheckIdentical(histos, expected);
+    CHECK(histos.getRuns().size() == 1); //one run, although in two parts
+    CHECK(histos.getRuns()[0].seed == 12345 && histos.getRuns()[0].firstEvent == 0 && histos.getRuns()[0].lastEvent == EventsNum);
+
+    // The last checkpoints of the two runs hold the same state
+    GenerationCheckpoint uninterruptedEnd, resumedEnd;
+    CHECK(ReadCheckpoint(UninterruptedFile, uninterruptedEnd));
+    CHECK(ReadCheckpoint(ResumedFile, resumedEnd));
+    CHECK(uninterruptedEnd.nextEvent == EventsNum && resumedEnd.nextEvent == EventsNum);
+    CheckIdentical(resumedEnd.histos, expected);
+    CheckIdentical(uninterruptedEnd.histos, expected);
+}
+
+void CheckRefused(AliasSampler const& sampler)
+{
+    GenerationCheckpoint checkpoint;
+    CHECK(ReadCheckpoint(ResumedFile, checkpoint));
+    GenerationCheckpoint const unchanged = checkpoint;
+    CHECK(!ReadCheckpoint("test_GenerationCheckpoint_missing.ckpt", checkpoint));
+    CHECK(checkpoint.nextEvent == unchanged.nextEvent);
+
+    GenerationConfig config = MakeConfig(EventsNum, "");
+    config.particlesPerEvent = 50;
+    CHECK(!EventGenerator(config, sampler).Resume(checkpoint));
+
+    config = MakeConfig(EventsNum, "");
+    config.multiplicity = Multiplicity_Fixed;
+    CHECK(!EventGenerator(config, sampler).Resume(checkpoint));
+
+    config = MakeConfig(EventsNum, "");
+    config.resonanceEnhancement = 1.;
+    CHECK(!EventGenerator(config, sampler).Resume(checkpoint));
+
+    config = MakeConfig(EventsNum, ""); //the second shard starts at another event than the checkpoint
+    config.shardsNum = 2;
+    config.shardIndex = 1;
+    CHECK(!EventGenerator(config, sampler).Resume(checkpoint));
+}
+
+void CheckExtend(AliasSampler const& sampler)
+{
+    GenerationHistograms const previous = EventGenerator{MakeConfig(BatchEventsNum, ""), sampler}.Run();
+    CHECK(previous.getRuns().size() == 1);
+    GenerationRun const& run = previous.getRuns()[0];
+    CHECK(run.seed == 12345 && run.shardIndex == 0 && run.shardsNum == 1 && run.firstEvent == 0 && run.lastEvent == BatchEventsNum);
+
+    // The runs go through the histogram file
+    CHECK(WriteHistograms(HistogramsFile, previous));
+    GenerationHistograms read;
+    CHECK(ReadHistograms(HistogramsFile, read));
+    CheckIdentical(read, previous);
+    CHECK(read.getRuns().size() == 1);
+    CHECK(read.getRuns()[0].seed == run.seed && read.getRuns()[0].firstEvent == run.firstEvent && read.getRuns()[0].lastEvent == run.lastEvent);
+
+    // The same seed would add the same events again
+    EventGenerator sameSeed{MakeConfig(BatchEventsNum, ""), sampler};
+    CHECK(!sameSeed.setInitialHistograms(read));
+    CHECK(sameSeed.Run().getRuns().size() == 1); //the histograms were left out
+
+    GenerationConfig config = MakeConfig(BatchEventsNum, "");
+    config.seed = 777;
+    EventGenerator otherSeed{config, sampler};
+    CHECK(otherSeed.setInitialHistograms(read));
+    GenerationHistograms const extended = otherSeed.Run();
+    CHECK(extended.getRuns().size() == 2);
+    CHECK(extended.getRuns()[0].seed == 12345 && extended.getRuns()[1].seed == 777);
+    CHECK(extended[Histo_ParticleAbundancies].getEntries() > previous[Histo_ParticleAbundancies].getEntries());
+
+    // The extended histograms can't be extended again with either seed
+    CHECK(!EventGenerator(MakeConfig(BatchEventsNum, ""), sampler).setInitialHistograms(extended));
+    CHECK(!EventGenerator(config, sampler).setInitialHistograms(extended));
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+    AliasSampler const sampler{DefaultAbundancies()};
+
+    CheckResume(sampler);
+    CheckRefused(sampler);
+    CheckExtend(sampler);
+
+    std::remove(UninterruptedFile.c_str());
+    std::remove(ResumedFile.c_str());
+    std::remove(HistogramsFile.c_str());
+
+    return TestResult("test_GenerationCheckpoint");
+}
@@ -0,0 +1,99 @@
+// Daniel Michelin
+
+// Native histogram files: what is written is read back bit for bit, contents, sums of squared weights, entries and
+// statistics; WriteHistogramsAtomically() leaves no temporary file behind; and a file that is missing, cut short or
+// binned differently is refused, leaving the histograms to be read into as they were.
+
+#include "TestHistograms.hpp"
+#include "../generation/HistogramIO.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/Particle.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+std::string const HistogramFile = "test_HistogramIO.hist";
+std::string const TruncatedFile = "test_HistogramIO_truncated.hist";
+
+
+// Histograms with something in every kind of bin: labelled bins, under/overflows, and weighted fills in some of them only
+GenerationHistograms MakeHistograms()
+{
+    GenerationHistograms histos;
+    for(int i = 0; i < 1000; ++i)
+    {
+        double const x = 0.001 * i * i;
+        histos[Histo_ParticleAbundancies].FillBin(1 + i % (histos[Histo_ParticleAbundancies].getNbins() + 1));
+        histos[Histo_Theta].Fill(x - 1.);
+        histos[Histo_Impulse].Fill(0.01 * i, 1. / (1 + i % 7));
+        for(int h = Histo_InvariantMass; h < NumHistograms; h += 2) { histos[h].Fill(0.0037 * i, 0.5 + 0.25 * h); }
+    }
+    return histos;
+}
+
+void CheckRoundTrip(GenerationHistograms const& written)
+{
+    CHECK(WriteHistograms(HistogramFile, written));
+
+    GenerationHistograms read;
+    CHECK(ReadHistograms(HistogramFile, read));
+    CheckIdentical(read, written);
+}
+
+void CheckAtomicWrite(GenerationHistograms const& written)
+{
+    CHECK(WriteHistogramsAtomically(HistogramFile, written));
+    CHECK(!std::ifstream{HistogramFile + ".tmp"});
+
+    GenerationHistograms read;
+    CHECK(ReadHistograms(HistogramFile, read));
+    CheckIdentical(read, written);
+}
+
+void CheckRefused(GenerationHistograms const& written)
+{
+    GenerationHistograms const previous = MakeHistograms();
+    GenerationHistograms read = previous;
+
+    CHECK(!ReadHistograms("test_HistogramIO_missing.hist", read));
+
+    // The file cut in half
+    CHECK(WriteHistograms(HistogramFile, written));
+    std::ifstream file{HistogramFile, std::ios::binary};
+    std::string const bytes{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    std::ofstream{TruncatedFile, std::ios::binary}.write(bytes.data(), bytes.size() / 2);
+    CHECK(!ReadHistograms(TruncatedFile, read));
+
+    // The same histograms with another binning
+    std::vector<HistogramDefinition> definitions = GetHistogramDefinitions();
+    std::vector<FastHistogram> rebinned;
+    for(HistogramDefinition& definition : definitions)
+    {
+        definition.nbins *= 2;
+        rebinned.emplace_back(definition.nbins, definition.xmin, definition.xmax);
+    }
+    CHECK(!ReadHistograms(HistogramFile, definitions, rebinned));
+
+    CheckIdentical(read, previous);
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+
+    GenerationHistograms const written = MakeHistograms();
+    CHECK(written[Histo_Impulse].hasSumw2() && !written[Histo_Theta].hasSumw2());
+
+    CheckRoundTrip(written);
+    CheckRoundTrip(GenerationHistograms{}); //empty histograms
+    CheckAtomicWrite(written);
+    CheckRefused(written);
+
+    std::remove(HistogramFile.c_str());
+    std::remove(TruncatedFile.c_str());
+
+    return TestResult("test_HistogramIO");
+}
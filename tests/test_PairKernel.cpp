@@ -0,0 +1,156 @@
+// Daniel Michelin
+
+// Pair kernel: every implementation this CPU can run (see setPairKernel()) gives the invariant masses of Particle::InvMass,
+// and those of the scalar implementation, within the tolerance stated in PairKernel.hpp, on random events and on the
+// edge cases: particles at rest, back-to-back pairs and pairs just above threshold (same velocity, different masses).
+
+#include "TestCheck.hpp"
+#include "../generation/PairKernel.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/EventBuffer.hpp"
+#include "../generation/Particle.hpp"
+#include "../generation/RandomStream.hpp"
+#include <string>
+#include <vector>
+
+double const KernelTolerance = 1e-12; //relative, as stated in PairKernel.hpp
+
+
+// Masses of every pair i < j of 'particles' with the current implementation, a whole row per call, so that both the
+// vector loops and the scalar tails run
+std::vector<double> KernelMasses(std::vector<Particle> const& particles)
+{
+    EventBuffer buffer{(int)particles.size()};
+    for(Particle const& particle : particles) { buffer.Add(particle); }
+    FourMomentumColumns const columns = GetFourMomentumColumns(buffer);
+
+    int const size = particles.size();
+    std::vector<double> masses;
+    std::vector<double> invMasses(size);
+    std::vector<int> pairCodes(size);
+    for(int i = 0; i < size; ++i)
+    {
+        InvMassBlock(columns, i, i+1, size, Particle::getNumParticleType(), invMasses.data(), pairCodes.data());
+        for(int j = i+1; j < size; ++j)
+        {
+            masses.push_back(invMasses[j-i-1]);
+            CHECK(pairCodes[j-i-1] == particles[i].getIndex() * Particle::getNumParticleType() + particles[j].getIndex());
+        }
+    }
+    return masses;
+}
+
+std::vector<double> ReferenceMasses(std::vector<Particle> const& particles)
+{
+    std::vector<double> masses;
+    for(unsigned i = 0; i < particles.size(); ++i)
+    {
+        for(unsigned j = i+1; j < particles.size(); ++j) { masses.push_back(particles[i].InvMass(particles[j])); }
+    }
+    return masses;
+}
+
+void CheckEvent(std::string const& kernel, char const* eventName, std::vector<Particle> const& particles, std::vector<double> const& scalarMasses)
+{
+    std::vector<double> const masses = KernelMasses(particles);
+    std::vector<double> const reference = ReferenceMasses(particles);
+
+    int const failuresBefore = testFailuresNum;
+    CHECK(masses.size() == reference.size());
+    for(unsigned k = 0; k < masses.size() && k < reference.size(); ++k)
+    {
+        CHECK_CLOSE(masses[k], reference[k], KernelTolerance);
+        CHECK_CLOSE(masses[k], scalarMasses[k], KernelTolerance);
+        if(testFailuresNum > failuresBefore + 10) { break; } //one broken kernel is enough to tell
+    }
+    if(testFailuresNum > failuresBefore) { std::cout << "  in the " << eventName << " event, " << kernel << " kernel\n"; }
+}
+
+
+std::vector<Particle> RandomEvent(int size, RandomStream& rng)
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i < size; ++i)
+    {
+        int const type = (int)(rng.Rndm() * 6); //the stable types
+        particles.push_back(Particle{type, rng.Gaus(0., 2.), rng.Gaus(0., 2.), rng.Gaus(0., 2.)});
+    }
+    return particles;
+}
+
+std::vector<Particle> EventAtRest(int size)
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i < size; ++i) { particles.push_back(Particle{i % 7, 0., 0., 0.}); }
+    return particles;
+}
+
+// Pairs (2k, 2k+1) back to back; the other pairs are at all sorts of angles
+std::vector<Particle> BackToBackEvent(int size, RandomStream& rng)
+{
+    std::vector<Particle> particles;
+    for(int i = 0; i + 1 < size; i += 2)
+    {
+        double const px = rng.Gaus(0., 3.);
+        double const py = rng.Gaus(0., 3.);
+        double const pz = rng.Gaus(0., 3.);
+        particles.push_back(Particle{i % 6, px, py, pz});
+        particles.push_back(Particle{(i+1) % 6, -px, -py, -pz});
+    }
+    return particles;
+}
+
+// Every particle moves with (almost) the same velocity: every pair is just above its threshold m1 + m2, where
+// E^2 - P^2 cancels the most
+std::vector<Particle> ThresholdEvent(int size, RandomStream& rng)
+{
+    double const bx = 0.3;
+    double const by = -0.5;
+    double const bz = 0.6;
+    std::vector<Particle> particles;
+    for(int i = 0; i < size; ++i)
+    {
+        int const type = i % 6;
+        double const mass = Particle::getParticleTypeMass(type);
+        double const gammaMass = mass / sqrt(1. - (bx*bx + by*by + bz*bz)) * (1. + 1e-6 * rng.Rndm()); //p = gamma*m*v
+        particles.push_back(Particle{type, gammaMass * bx, gammaMass * by, gammaMass * bz});
+    }
+    return particles;
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+    std::string const defaultKernel = getPairKernelName();
+
+    RandomStream rng{2024, 0};
+    std::vector<std::pair<char const*, std::vector<Particle>>> const events{
+        {"random", RandomEvent(37, rng)}, //not a multiple of the vector width: tails of every length
+        {"big random", RandomEvent(300, rng)},
+        {"at rest", EventAtRest(21)},
+        {"back-to-back", BackToBackEvent(40, rng)},
+        {"threshold", ThresholdEvent(29, rng)}};
+
+    CHECK(setPairKernel("scalar"));
+    std::vector<std::vector<double>> scalarMasses;
+    for(auto const& event : events) { scalarMasses.push_back(KernelMasses(event.second)); }
+
+    for(std::string const kernel : {"scalar", "avx2", "avx512"})
+    {
+        if(!setPairKernel(kernel))
+        {
+            std::cout << kernel << " kernel: not supported by this CPU, skipped\n";
+            continue;
+        }
+        CHECK(getPairKernelName() == kernel);
+
+        for(unsigned e = 0; e < events.size(); ++e) { CheckEvent(kernel, events[e].first, events[e].second, scalarMasses[e]); }
+        std::cout << kernel << " kernel: checked\n";
+    }
+
+    CHECK(!setPairKernel("unknown"));
+    CHECK(setPairKernel(defaultKernel));
+
+    return TestResult("test_PairKernel");
+}
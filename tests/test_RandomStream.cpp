@@ -0,0 +1,112 @@
+// Daniel Michelin
+
+// RandomStream: the uniform numbers stay in (0,1) up to the extreme values of their random bits, and the alias sampler,
+// which turns them into a column of its table, never reads past it. The Poisson numbers have the right mean and variance
+// on both of their algorithms, and streams drawn by several threads at once give what they give alone.
+
+#include "TestCheck.hpp"
+#include "../generation/RandomStream.hpp"
+#include "../generation/AliasSampler.hpp"
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+void CheckUniformExtremes()
+{
+    std::uint64_t const maxBits = (1ULL << 53) - 1;
+
+    double const lowest = RandomStream::UniformFromBits(0);
+    double const highest = RandomStream::UniformFromBits(maxBits);
+    CHECK(lowest > 0.);
+    CHECK(lowest < 1.);
+    CHECK(highest > 0.);
+    CHECK(highest < 1.);
+    CHECK(highest >= RandomStream::UniformFromBits(maxBits - 1)); //still increasing at the top
+
+    RandomStream rng{12345, 0};
+    bool isInside = true;
+    for(int i = 0; i < 1000000; ++i)
+    {
+        double const u = rng.Rndm();
+        isInside = isInside && u > 0. && u < 1.;
+    }
+    CHECK(isInside);
+}
+
+// The largest uniform number must still pick the last column of the table, or its alias, for any size of the table
+void CheckSamplerAtTheTop()
+{
+    double const highest = RandomStream::UniformFromBits((1ULL << 53) - 1);
+
+    for(int n = 1; n <= 64; ++n)
+    {
+        std::vector<SpeciesAbundance> abundancies;
+        for(int i = 0; i < n; ++i) { abundancies.push_back(SpeciesAbundance{100 + i, 1. + i % 3}); }
+        AliasSampler const sampler{abundancies};
+
+        int const topID = sampler.Sample(highest);
+        CHECK(topID >= 100 && topID < 100 + n);
+        int const oneID = sampler.Sample(1.); //out of the contract, but must not read past the table either
+        CHECK(oneID >= 100 && oneID < 100 + n);
+    }
+}
+
+// Mean and variance of 'drawsNum' Poisson numbers within 5 standard errors of 'mean'
+void CheckPoissonMoments(double mean)
+{
+    int const drawsNum = 200000;
+    RandomStream rng{99, (std::uint64_t)mean};
+
+    double sum = 0.;
+    double sumOfSquares = 0.;
+    for(int i = 0; i < drawsNum; ++i)
+    {
+        double const n = rng.Poisson(mean);
+        sum += n;
+        sumOfSquares += n*n;
+    }
+    double const sampleMean = sum / drawsNum;
+    double const sampleVariance = sumOfSquares / drawsNum - sampleMean*sampleMean;
+
+    CHECK(std::fabs(sampleMean - mean) < 5. * std::sqrt(mean / drawsNum));
+    CHECK(std::fabs(sampleVariance - mean) < 5. * mean * std::sqrt(2. / drawsNum) + 5. * std::sqrt(mean / drawsNum));
+}
+
+// Sum of the Poisson and gamma numbers of stream 'streamID', as the multiplicities of the generation draw them
+double DrawMultiplicities(std::uint64_t streamID)
+{
+    RandomStream rng{2024, streamID};
+    double sum = 0.;
+    for(int i = 0; i < 20000; ++i) { sum += rng.Poisson(rng.Gamma(2., 150.)); } //mean 300: the rejection algorithm
+    return sum;
+}
+
+void CheckThreadedDraws()
+{
+    int const threadsNum = 4;
+    std::vector<double> alone(threadsNum);
+    for(int t = 0; t < threadsNum; ++t) { alone[t] = DrawMultiplicities(t); }
+
+    std::vector<double> together(threadsNum);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < threadsNum; ++t)
+    {
+        threads.emplace_back([&together, t]() { together[t] = DrawMultiplicities(t); });
+    }
+    for(std::thread& thread : threads) { thread.join(); }
+
+    for(int t = 0; t < threadsNum; ++t) { CHECK(together[t] == alone[t]); }
+}
+
+
+int main()
+{
+    CheckUniformExtremes();
+    CheckSamplerAtTheTop();
+    for(double const mean : {0.5, 4., 10., 100., 5000.}) { CheckPoissonMoments(mean); } //multiplications below 10, rejection above
+    CheckThreadedDraws();
+
+    return TestResult("test_RandomStream");
+}
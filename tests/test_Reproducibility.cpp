@@ -0,0 +1,100 @@
+// Daniel Michelin
+
+// The same seed gives the same histograms to the last bit whatever the threads: the generation with 1, 3 or 4 threads
+// and with the pipeline (one thread per stage, as the sequential run, or several), and the re-analysis of the stored
+// events with 1 or 4 threads.
+
+#include "TestHistograms.hpp"
+#include "../generation/EventGenerator.hpp"
+#include "../generation/EventStore.hpp"
+#include "../generation/Particle.hpp"
+#include "../analysis/EventReanalysis.hpp"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+std::string const StoreFile = "test_Reproducibility.evts";
+
+
+// Poisson multiplicity, for events of different costs, and weighted fills, whose sums are the most sensitive to the order
+GenerationConfig MakeConfig()
+{
+    GenerationConfig config;
+    config.eventsNum = 3000;
+    config.particlesPerEvent = 100;
+    config.multiplicity = Multiplicity_Poisson;
+    config.resonanceEnhancement = 5.;
+    config.seed = 42;
+    config.showProgress = false;
+    return config;
+}
+
+void CheckGeneration(AliasSampler const& sampler)
+{
+    GenerationHistograms const expected = EventGenerator{MakeConfig(), sampler}.Run();
+
+    for(int threadsNum : {3, 4})
+    {
+        GenerationConfig config = MakeConfig();
+        config.threadsNum = threadsNum;
+        if(threadsNum == 4) { config.eventStoreFile = StoreFile; } //every thread writes chunks of its own
+        CheckIdentical(EventGenerator{config, sampler}.Run(), expected);
+    }
+
+    GenerationConfig sequentialPipeline = MakeConfig(); //--pipeline 1,1,1
+    sequentialPipeline.pipelined = true;
+    CheckIdentical(EventGenerator{sequentialPipeline, sampler}.Run(), expected);
+
+    GenerationConfig config = MakeConfig();
+    config.pipelined = true;
+    config.samplingThreadsNum = 2;
+    config.decayThreadsNum = 3;
+    config.pairStageThreadsNum = 2;
+    config.queueDepth = 8;
+    CheckIdentical(EventGenerator{config, sampler}.Run(), expected);
+}
+
+void CheckReanalysis()
+{
+    EventStoreReader const store{StoreFile};
+    CHECK(store.isOpen());
+    CHECK(store.getNumChunks() >= 4); //a chunk for every thread at least
+
+    ReanalysisSet set;
+    set.name = "test";
+    ReanalysisSet cut;
+    cut.name = "cut";
+    cut.cuts.minImpulse = 0.5;
+
+    EventReanalysis single{store};
+    single.AddSet(set);
+    single.AddSet(cut);
+    CHECK(single.Run(1));
+
+    EventReanalysis multiple{store};
+    multiple.AddSet(set);
+    multiple.AddSet(cut);
+    CHECK(multiple.Run(4));
+
+    for(int s = 0; s < 2; ++s)
+    {
+        std::vector<FastHistogram> const& expected = single.getHistograms(s);
+        std::vector<FastHistogram> const& actual = multiple.getHistograms(s);
+        for(int h = 0; h < NumInvMassFamilies; ++h) { CHECK(AreIdentical(actual[h], expected[h])); }
+    }
+    CHECK(single.getHistograms(0)[Family_SameDecayProducts].getEntries() > 0.);
+}
+
+
+int main()
+{
+    FillDefaultParticleTable();
+    AliasSampler const sampler{DefaultAbundancies()};
+
+    CheckGeneration(sampler);
+    CheckReanalysis();
+
+    std::remove(StoreFile.c_str());
+
+    return TestResult("test_Reproducibility");
+}